@@ -0,0 +1,84 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark the padded bucketing storage mode: the memory overhead
+of padding each row up to a multiple of the bucket size, against the
+throughput of the resulting tail free inner loops. A bucket size of 1
+is the exactly ragged layout.
+"""
+import argparse
+
+import numpy as np
+import tvm
+from tvm import te
+from tvm.testing import ragged_elementwise
+
+from ragged_util import sample_lengths, create_arguments, time_module
+
+
+def build_kernel(batch_size, max_len, hidden, bucket_size):
+    lens, A, O = ragged_elementwise(lambda x: 2 * x, batch_size, max_len, hidden,
+                                    bucket_size=bucket_size)
+    s = te.create_schedule([O.op])
+    b, l, h = O.op.axis
+    s[O].parallel(b)
+    if bucket_size > 1:
+        _, li = s[O].split(l, factor=bucket_size)
+        s[O].unroll(li)
+    s[O].vectorize(h)
+
+    mod, intermediate_buffers = tvm.build(s, [[lens], [A, O]], "llvm", name="kernel")
+    return mod, intermediate_buffers, [A, O]
+
+
+def evaluate(bucket_size, lens_np, args):
+    ctx = tvm.cpu(0)
+    padded = (lens_np + bucket_size - 1) // bucket_size * bucket_size
+    exact_bytes = int(np.sum(lens_np)) * args.hidden * 4
+    padded_bytes = int(np.sum(padded)) * args.hidden * 4
+
+    mod, intermediate_buffers, tensors = build_kernel(len(lens_np), args.max_len, args.hidden,
+                                                      bucket_size)
+    run_args = create_arguments(lens_np, tensors, intermediate_buffers, ctx)
+    mean, _ = time_module(mod, "kernel", run_args, ctx, repeat=args.repeat)
+    # Useful bytes read and written per second, ignoring the padding
+    throughput = 2 * exact_bytes / (mean / 1000) / 1e9
+    print("%-12d %-14.2f %-12.1f %-14.2f %-14.2f" %
+          (bucket_size, padded_bytes / 2**20, 100.0 * (padded_bytes - exact_bytes) / exact_bytes,
+           mean * 1000, throughput))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--bucket-sizes", type=int, nargs="+", default=[1, 2, 4, 8, 16, 32, 64])
+    parser.add_argument("--batch-size", type=int, default=256)
+    parser.add_argument("--max-len", type=int, default=512)
+    parser.add_argument("--hidden", type=int, default=256)
+    parser.add_argument("--distribution", type=str, choices=["uniform", "skewed"],
+                        default="uniform")
+    parser.add_argument("--repeat", type=int, default=10)
+    args = parser.parse_args()
+
+    lens_np = sample_lengths(args.batch_size, args.max_len, args.distribution)
+    print("-----------------------------------------------------------------------")
+    print("%-12s %-14s %-12s %-14s %-14s" %
+          ("Bucket Size", "Storage (MB)", "Overhead %", "Time (us)", "Useful GB/s"))
+    print("-----------------------------------------------------------------------")
+    for bucket_size in args.bucket_sizes:
+        if args.max_len % bucket_size != 0:
+            print("Skipping bucket size %d, which does not divide the max length" % bucket_size)
+            continue
+        evaluate(bucket_size, lens_np, args)
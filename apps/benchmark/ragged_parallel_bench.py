@@ -0,0 +1,77 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark the partitioning of a parallel loop over the rows of a
+ragged tensor between threads: equal row counts (parallel), chunks
+claimed on demand (the parallel_dynamic pragma) and equal cumulative
+work (balanced_parallel), across batch sizes and length distributions.
+"""
+import argparse
+
+import tvm
+from tvm import te
+from tvm.testing import ragged_elementwise
+
+from ragged_util import sample_lengths, create_arguments, time_module
+
+SCHEDULES = ["parallel", "dynamic", "balanced"]
+
+
+def build_kernel(batch_size, max_len, hidden, schedule, chunk):
+    lens, A, O = ragged_elementwise(lambda x: 2 * x, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    b = O.op.axis[0]
+    if schedule == "balanced":
+        s[O].balanced_parallel(b)
+    else:
+        s[O].parallel(b)
+        if schedule == "dynamic":
+            s[O].pragma(b, "parallel_dynamic", chunk)
+    s[O].vectorize(O.op.axis[2])
+
+    mod, intermediate_buffers = tvm.build(s, [[lens], [A, O]], "llvm", name="kernel")
+    return mod, intermediate_buffers, [A, O]
+
+
+def evaluate(batch_size, args):
+    ctx = tvm.cpu(0)
+    lens_np = sample_lengths(batch_size, args.max_len, args.distribution)
+    row = []
+    for schedule in SCHEDULES:
+        mod, intermediate_buffers, tensors = build_kernel(batch_size, args.max_len, args.hidden,
+                                                          schedule, args.chunk)
+        run_args = create_arguments(lens_np, tensors, intermediate_buffers, ctx)
+        mean, _ = time_module(mod, "kernel", run_args, ctx, repeat=args.repeat)
+        row.append(mean * 1000)
+    print("%-12d %-14s %-14s %-14s" % ((batch_size,) + tuple("%.2f us" % t for t in row)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--batch-sizes", type=int, nargs="+", default=[16, 64, 256, 1024])
+    parser.add_argument("--max-len", type=int, default=512)
+    parser.add_argument("--hidden", type=int, default=256)
+    parser.add_argument("--chunk", type=int, default=1)
+    parser.add_argument("--distribution", type=str, choices=["uniform", "skewed"],
+                        default="skewed")
+    parser.add_argument("--repeat", type=int, default=10)
+    args = parser.parse_args()
+
+    print("--------------------------------------------------------")
+    print("%-12s %-14s %-14s %-14s" % ("Batch Size", "Equal rows", "Dynamic", "Balanced"))
+    print("--------------------------------------------------------")
+    for batch_size in args.batch_sizes:
+        evaluate(batch_size, args)
@@ -0,0 +1,72 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark the prep code (prelude) of a ragged kernel, comparing
+the serial prefix sums against the parallel blocked scans enabled by
+Schedule.parallel_prep_code, across batch sizes.
+"""
+import argparse
+
+import tvm
+from tvm import te
+from tvm.testing import ragged_elementwise
+
+from ragged_util import sample_lengths, create_arguments, time_module
+
+
+def build_prelude(batch_size, max_len, hidden, num_blocks):
+    lens, A, O = ragged_elementwise(lambda x: 2 * x, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    s[O].parallel(O.op.axis[0])
+    if num_blocks > 0:
+        s.parallel_prep_code(num_blocks)
+
+    with tvm.target.build_config(prep_code_mode="only_prep_code"):
+        mod, intermediate_buffers = tvm.build(s, [[lens], [A, O]], "llvm", name="prelude")
+    return mod, intermediate_buffers, [A, O]
+
+
+def evaluate(batch_size, args):
+    ctx = tvm.cpu(0)
+    lens_np = sample_lengths(batch_size, args.max_len, args.distribution)
+    row = []
+    for num_blocks in [0, args.num_blocks]:
+        mod, intermediate_buffers, tensors = build_prelude(batch_size, args.max_len,
+                                                           args.hidden, num_blocks)
+        run_args = create_arguments(lens_np, tensors, intermediate_buffers, ctx)
+        mean, _ = time_module(mod, "prelude", run_args, ctx, repeat=args.repeat)
+        row.append(mean * 1000)
+    print("%-12d %-16s %-16s %.2fx" % (batch_size, "%.2f us" % row[0], "%.2f us" % row[1],
+                                      row[0] / row[1]))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--batch-sizes", type=int, nargs="+",
+                        default=[16, 64, 256, 1024, 4096, 16384])
+    parser.add_argument("--max-len", type=int, default=128)
+    parser.add_argument("--hidden", type=int, default=64)
+    parser.add_argument("--num-blocks", type=int, default=64)
+    parser.add_argument("--distribution", type=str, choices=["uniform", "skewed"],
+                        default="uniform")
+    parser.add_argument("--repeat", type=int, default=10)
+    args = parser.parse_args()
+
+    print("--------------------------------------------------------")
+    print("%-12s %-16s %-16s %s" % ("Batch Size", "Serial", "Parallel", "Speedup"))
+    print("--------------------------------------------------------")
+    for batch_size in args.batch_sizes:
+        evaluate(batch_size, args)
@@ -0,0 +1,74 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Utility for the ragged tensor benchmark scripts"""
+import numpy as np
+
+import tvm
+import tvm.testing
+
+
+def sample_lengths(batch_size, max_len, distribution="uniform", seed=0):
+    """Sample a batch of sequence lengths in [1, max_len].
+
+    Parameters
+    ----------
+    batch_size : int
+        The number of lengths to sample.
+
+    max_len : int
+        The maximum sequence length.
+
+    distribution : str
+        "uniform" samples uniformly. "skewed" mostly samples short
+        lengths with a few rows close to max_len, which is the worst
+        case for an equal row count partitioning of the batch.
+
+    Returns
+    -------
+    lens : numpy.ndarray
+        The sampled lengths as int32.
+    """
+    rng = np.random.RandomState(seed)
+    if distribution == "uniform":
+        lens = rng.randint(1, max_len + 1, size=batch_size)
+    elif distribution == "skewed":
+        lens = np.minimum(rng.zipf(1.5, size=batch_size), max_len)
+        lens[rng.randint(0, batch_size, size=max(1, batch_size // 64))] = max_len
+    else:
+        raise ValueError("Unknown length distribution " + distribution)
+    return lens.astype("int32")
+
+
+def create_arguments(lens_np, tensors, intermediate_buffers, ctx):
+    """Create the runtime arguments for a module built from a ragged
+    schedule, in the order expected by MakeAPI: tensors, lengths,
+    host intermediate buffers and device intermediate buffers.
+    """
+    args = []
+    for t in tensors:
+        shape = [int(s) for s in t.shape]
+        args.append(tvm.nd.array(np.zeros(shape, dtype=t.dtype), ctx))
+    args.append(tvm.nd.array(lens_np, tvm.cpu(0)))
+    args.extend(tvm.testing.ragged_aux_args(intermediate_buffers, ctx=ctx))
+    return args
+
+
+def time_module(module, func_name, args, ctx, number=10, repeat=5):
+    """Return the mean and std dev of the run time of func_name in ms"""
+    ftimer = module.time_evaluator(func_name, ctx, number=number, repeat=repeat)
+    prof_res = np.array(ftimer(*args).results) * 1000
+    return np.mean(prof_res), np.std(prof_res)
@@ -458,6 +458,18 @@ class Analyzer {
    * \note Analyzer will call into sub-analyzers to get the result.
    */
   bool CanProve(const PrimExpr& cond);
+  /*!
+   * \brief Whether we can prove condition from the constant integer
+   *  bounds and modular sets of the sides of its comparisons only.
+   *
+   *  This is the fast path CanProve falls back to when Z3 gives up on
+   *  a query, either on a timeout or because the time budget of the
+   *  current pass is exhausted.
+   *
+   * \param cond The expression to be proved.
+   * \return The result.
+   */
+  bool CanProveFromBounds(const PrimExpr& cond);
   /*!
    * \brief Simplify expr.
    *
@@ -9,6 +9,7 @@
 
 #include <limits>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -65,12 +66,15 @@ class Z3Converter : public tir::ExprFunctor<z3expr(const PrimExpr&)> {
     // std::cout << "[Z3] -----" << std::endl;
   }
 
+  /*! \brief The number of expressions and functions converted so far,
+   *  all of which are kept alive by the converter. */
+  size_t NumConverted() const { return z3_exprs.size() + z3_funs.size() + z3_ufuns.size(); }
+
+  /*! \brief Structural hash of the body of an uninterpreted function,
+   *  consistent with UninterpFun::CheckEquality. */
   class UfHasher {
    public:
-    size_t operator()(UninterpFun uf) const {
-      size_t hash = 0;
-      return hash;
-    }
+    size_t operator()(UninterpFun uf) const;
   };
 
   class UfEquality {
@@ -98,13 +102,54 @@ class Z3Converter : public tir::ExprFunctor<z3expr(const PrimExpr&)> {
   int index = 0;
 };
 
+/*! \brief Counters of the Z3 queries made by a pass. */
+struct Z3PassStats {
+  /*! \brief Number of CanProve calls that reached Z3. */
+  int64_t queries{0};
+  /*! \brief Number of solver queries answered from the cache. */
+  int64_t cache_hits{0};
+  /*! \brief Number of queries actually solved. */
+  int64_t solver_checks{0};
+  /*! \brief Number of CanProve calls that succeeded. */
+  int64_t proved{0};
+  /*! \brief Number of queries Z3 gave up on, mostly timeouts. */
+  int64_t timeouts{0};
+  /*! \brief Number of queries not sent to Z3 as the time budget of
+   *  the pass was exhausted. */
+  int64_t skipped{0};
+  /*! \brief Time spent in the solver, in milliseconds. */
+  double solver_ms{0};
+};
+
+/*!
+ * \brief Attribute the Z3 queries made by the current thread while
+ *  in scope to a pass, for the statistics returned by
+ *  arith.Z3GetStats. Scopes nest. The queries made in scope share the
+ *  z3_pass_timeout_ms and z3_pass_max_solver_checks budgets of the
+ *  current build config.
+ */
+class Z3PassScope {
+ public:
+  explicit Z3PassScope(const std::string& pass);
+  ~Z3PassScope();
+
+ private:
+  std::string prev_pass_;
+  double prev_spent_ms_;
+  int64_t prev_solver_checks_;
+  bool prev_in_scope_;
+};
+
+/*!
+ * \brief Z3 state shared by the analyzers of a thread: the context,
+ *  the converter, an incremental solver for linear queries and a
+ *  cache of query results.
+ */
+class Z3Context;
+
 class Z3Analyzer {
  public:
-  Z3Analyzer() {
-    this->converter = std::unique_ptr<Z3Converter>(new Z3Converter(ctx));
-    this->general_constraints = std::make_shared<z3::expr_vector>(ctx);
-    InitCall_();
-  }
+  Z3Analyzer();
 
   void Bind(const Var& var, const Range& range);
   void Update(const Var& var, const Range& range, bool overwrite);
@@ -114,15 +159,25 @@ class Z3Analyzer {
   void AddForallConstraint(const Array<Var>& forall_vars, const PrimExpr& constraint_body);
   void RemoveLastConstraint();
   z3::expr ConvertToZ3(const PrimExpr& expr);
-  bool CanProve(const PrimExpr& cond);
+  /*!
+   * \brief Try to prove cond.
+   * \param cond The condition.
+   * \param gave_up If not null, set to whether Z3 gave up, on a
+   *  timeout or an exhausted pass budget, rather than failed to prove
+   *  cond.
+   */
+  bool CanProve(const PrimExpr& cond, bool* gave_up = nullptr);
 
  private:
-  bool CanProveInternal_(z3::expr& antecedent, z3::expr& consequent, bool print);
-  void InitCall_();
+  std::vector<z3::expr> CollectConstraints_();
 
-  z3::context ctx;
-  std::unique_ptr<Z3Converter> converter;
-  std::unordered_map<const Object*, z3exprvec> var_constraints;
+  std::shared_ptr<Z3Context> shared;
+  z3::context& ctx;
+  // Bounds of the variables, in the order they were first bound, so
+  // that analyzers binding the same variables assert the same
+  // constraints in the same order.
+  std::unordered_map<const Object*, size_t> var_constraint_index;
+  std::vector<z3exprvec> var_constraints;
   z3exprvec general_constraints;
 };
 }  // namespace arith
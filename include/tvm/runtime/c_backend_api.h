@@ -156,6 +156,20 @@ TVM_DLL int TVMBackendParallelLaunch(FTVMParallelLambda flambda, void* cdata, in
  */
 TVM_DLL int TVMBackendParallelBarrier(int task_id, TVMParallelGroupEnv* penv);
 
+/*!
+ * \brief Claim the next chunk of a dynamically scheduled parallel
+ *  loop. All the tasks of the loop share counter, which holds the
+ *  first iteration not claimed yet and should be zero before launch.
+ *  Tasks keep claiming chunks until the returned begin reaches the
+ *  loop extent, so that tasks that get cheap iterations (for example
+ *  short rows of a ragged tensor) go on to take more of them.
+ *
+ * \param counter The shared chunk counter, an int64_t.
+ * \param chunk_size The number of iterations claimed at once.
+ * \return The first iteration of the claimed chunk.
+ */
+TVM_DLL int64_t TVMBackendParallelNextChunk(void* counter, int64_t chunk_size);
+
 /*!
  * \brief Simple static initialization function.
  *  Run f once and set handle to be not null.
@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file tvm/runtime/ragged_ndarray.h
+ * \brief A ragged tensor container carrying its layout.
+ */
+#ifndef TVM_RUNTIME_RAGGED_NDARRAY_H_
+#define TVM_RUNTIME_RAGGED_NDARRAY_H_
+
+#include <tvm/runtime/ndarray.h>
+#include <tvm/runtime/object.h>
+
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief A tensor of dense shape (batch, max_len, d_0, ..., d_k)
+ *  whose second dimension is ragged: row i only has lengths[i]
+ *  entries. Rows are stored back to back in a flat array, as
+ *  expected by kernels operating on ragged layouts.
+ */
+class RaggedNDArrayObj : public Object {
+ public:
+  /*! \brief The flat storage, created with NDArray::RaggedEmpty. */
+  NDArray data;
+  /*! \brief The int32 length of each row, on the CPU. A copy of the
+   *  lengths the array was created with, not to be modified. */
+  NDArray lengths;
+  /*! \brief The dense shape of the tensor. */
+  std::vector<int64_t> shape;
+  /*! \brief Offset, in inner slices, of the start of each row,
+   *  followed by the total number of inner slices. */
+  std::vector<int64_t> row_offsets;
+  /*! \brief Number of elements in an inner slice, ie. d_0 * ... * d_k. */
+  int64_t inner_size;
+
+  static constexpr const char* _type_key = "runtime.RaggedNDArray";
+  TVM_DECLARE_FINAL_OBJECT_INFO(RaggedNDArrayObj, Object);
+};
+
+/*! \brief Reference to RaggedNDArrayObj. */
+class RaggedNDArray : public ObjectRef {
+ public:
+  /*!
+   * \brief Create an uninitialized ragged array.
+   * \param shape The dense shape of the array.
+   * \param lengths The int32 row lengths, of shape (shape[0],),
+   *  copied into the array.
+   * \param dtype The data type of the array.
+   * \param ctx The context the data is allocated on.
+   */
+  TVM_DLL static RaggedNDArray Empty(std::vector<int64_t> shape, NDArray lengths,
+                                     DLDataType dtype, DLContext ctx);
+  /*!
+   * \brief Pack a padded array of the dense shape into a ragged
+   *  array on ctx.
+   */
+  TVM_DLL static RaggedNDArray FromPadded(NDArray padded, NDArray lengths, DLContext ctx);
+  /*! \brief Unpack into a zero padded array of the dense shape, on the CPU. */
+  TVM_DLL NDArray ToPadded() const;
+  /*!
+   * \brief A view, sharing memory with this array, of row i, of
+   *  shape (lengths[i], d_0, ..., d_k).
+   */
+  TVM_DLL NDArray Row(int64_t i) const;
+
+  TVM_DEFINE_OBJECT_REF_METHODS(RaggedNDArray, ObjectRef, RaggedNDArrayObj);
+};
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_RAGGED_NDARRAY_H_
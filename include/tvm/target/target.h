@@ -238,6 +238,60 @@ class BuildConfigNode : public Object {
    * for debugging. */
   bool fill_in_function_bodies = true;
 
+  /*! \brief Whether to peel the tails of loops split over ragged
+   * extents, see tir::RaggedLoopPartition. */
+  bool partition_ragged_loops = true;
+
+  /*! \brief Whether to skip the prep code when it was last run on
+   * the same length arguments and its aux buffers are untouched. */
+  bool cache_prep_code = false;
+
+  /*! \brief Time limit, in ms, of a single Z3 query. Zero or less
+   * means no limit. */
+  int z3_query_timeout_ms = 500;
+
+  /*! \brief Total time, in ms, that a pass may spend in Z3 queries
+   * before the rest of its queries fall back to bound analysis. Zero
+   * or less means no limit. */
+  int z3_pass_timeout_ms = 0;
+
+  /*! \brief Number of queries a pass may send to the Z3 solver
+   * before the rest of its queries fall back to bound analysis, a
+   * budget that unlike z3_pass_timeout_ms does not depend on the
+   * speed of the machine. Zero or less means no limit. */
+  int z3_pass_max_solver_checks = 0;
+
+  /*! \brief Number of lanes vectorized loops of variable extent are
+   * strip-mined into, with predicated loads and stores for the last
+   * partial vector. Zero or one means such loops are an error. */
+  int ragged_vector_lanes = 0;
+
+  /*! \brief Whether serial loops over consecutive fused positions of
+   * a ragged fused loop keep a running (outer, inner) pair instead of
+   * looking both up in the fusion buffers at every iteration. */
+  bool incremental_fused_lookups = false;
+
+  /*! \brief Whether the fused to outer buffers of ragged fused loops
+   * are stored in 8 or 16 bits when the outer values allow it. */
+  bool compact_fusion_buffers = false;
+
+  /*! \brief Whether the aux buffers of ragged layouts (a_funs,
+   * fusion functions and permutations) use the narrowest unsigned
+   * type their constant bounds allow, instead of int32. */
+  bool narrow_aux_buffers = false;
+
+  /*! \brief Directory of the on-disk cache of the modules compiled
+   * by build, keyed on the lowered functions, the targets and this
+   * config. Empty to disable the cache. */
+  std::string build_cache_dir = "";
+
+  /*! \brief Number of threads build processes the functions of a
+   * module on, -1 for one per hardware thread, 0 for the calling
+   * thread only. LLVM generates each function in its own module, then
+   * links and optimizes them once, so the module is the same whatever
+   * the number of threads. */
+  int parallel_build_threads = 0;
+
   void VisitAttrs(AttrVisitor* v) {
     v->Visit("data_alignment", &data_alignment);
     v->Visit("offset_factor", &offset_factor);
@@ -257,6 +311,17 @@ class BuildConfigNode : public Object {
     v->Visit("prep_code_mode", &prep_code_mode);
     v->Visit("hoist_loads", &hoist_loads);
     v->Visit("fill_in_function_bodies", &fill_in_function_bodies);
+    v->Visit("partition_ragged_loops", &partition_ragged_loops);
+    v->Visit("cache_prep_code", &cache_prep_code);
+    v->Visit("z3_query_timeout_ms", &z3_query_timeout_ms);
+    v->Visit("z3_pass_timeout_ms", &z3_pass_timeout_ms);
+    v->Visit("z3_pass_max_solver_checks", &z3_pass_max_solver_checks);
+    v->Visit("ragged_vector_lanes", &ragged_vector_lanes);
+    v->Visit("incremental_fused_lookups", &incremental_fused_lookups);
+    v->Visit("compact_fusion_buffers", &compact_fusion_buffers);
+    v->Visit("narrow_aux_buffers", &narrow_aux_buffers);
+    v->Visit("build_cache_dir", &build_cache_dir);
+    v->Visit("parallel_build_threads", &parallel_build_threads);
   }
 
   static constexpr const char* _type_key = "BuildConfig";
@@ -267,6 +267,24 @@ class Stage : public ObjectRef {
    * \return reference to self.
    */
   TVM_DLL Stage& parallel(IterVar var);  // NOLINT(*)
+  /*!
+   * \brief Parallelize a ragged outer loop, splitting its iterations
+   *  between the threads by equal cumulative work instead of equal
+   *  iteration count. The work of the iterations is read off the
+   *  prefix sum (a_fun) of the dimensions depending on the loop.
+   * \param var The root axis to be parallelized.
+   * \return reference to self.
+   */
+  TVM_DLL Stage& balanced_parallel(IterVar var);  // NOLINT(*)
+  /*!
+   * \brief Iterate a ragged outer loop in decreasing order of the
+   *  extent of the first ragged dimension depending on it, through a
+   *  permutation computed by the prep code. Storage keeps its order.
+   * \param var The root axis to be sorted. It should be a leaf and its
+   *  extent should be constant.
+   * \return reference to self.
+   */
+  TVM_DLL Stage& sort_by_length(IterVar var);  // NOLINT(*)
   /*!
    * \brief Annotate the iteration with pragma
    *
@@ -474,6 +492,22 @@ class Schedule : public ObjectRef {
    */
   TVM_DLL void hfuse(const Array<Operation>& ops, const Array<IterVar>& ivs);
 
+  /*!
+   * \brief Generate the prefix sums in the prep code (a_funs and
+   * fusion functions) as parallel blocked scans.
+   * \param num_blocks The number of blocks each scan is split
+   * into. Zero restores the serial lowering.
+   */
+  TVM_DLL void parallel_prep_code(int num_blocks);
+
+  /*!
+   * \brief Generate the a_funs and fusion functions of this schedule
+   * into a prelude shared with the other schedules using the same
+   * shared_prep_code object, instead of into its own prep code.
+   * \param shared_prep_code The te.SharedPrepCode object to share.
+   */
+  TVM_DLL void share_prep_code(ObjectRef shared_prep_code);
+
   /*!
    * \brief Split a dimension of a tensor. This can be used to change
    * the layout of the tensor
@@ -515,10 +549,19 @@ class Schedule : public ObjectRef {
   TVM_DLL Operation unify(std::string name, std::string tag, Map<std::string, ObjectRef> attrs,
                           const Array<Tensor>& tensors,
                           const Array<Dimension>& explicit_dimensions);
-  TVM_DLL Array<Array<Operation>> split_for_bin_packing(Array<Tensor> input_tensors,
-                                                        Tensor output_tensor,
-                                                        Map<IterVar, tir::UninterpFun> to_split,
-                                                        bool include_inputs);
+  /*!
+   * \brief Split the loops of the subgraph computing output_tensor
+   *  into tiers, each computed by its own copy of the subgraph.
+   * \param input_tensors The inputs of the subgraph.
+   * \param output_tensor The output of the subgraph.
+   * \param to_split For each axis of output_tensor to split, the
+   *  increasing split points. K split points make K + 1 tiers.
+   * \param include_inputs Whether to include the inputs in the subgraph.
+   * \return The ops of each tier.
+   */
+  TVM_DLL Array<Array<Operation>> split_for_bin_packing(
+      Array<Tensor> input_tensors, Tensor output_tensor,
+      Map<IterVar, Array<tir::UninterpFun>> to_split, bool include_inputs);
   /*!
    * \brief Normalize the schedule.
    *  This is needed before bound inference.
@@ -720,12 +763,22 @@ class ScheduleNode : public Object {
   /*! \brief number of hfuse groups. */
   int num_hfuse_groups;
 
+  /*! \brief number of blocks the prefix sums in the prep code are
+      split into and scanned in parallel. Zero means serial scans. */
+  int prep_code_scan_blocks{0};
+
+  /*! \brief te.SharedPrepCode object the prep code of this schedule
+      is generated into, if any. */
+  ObjectRef shared_prep_code;
+
   void VisitAttrs(AttrVisitor* v) {
     v->Visit("outputs", &outputs);
     v->Visit("stages", &stages);
     v->Visit("groups", &groups);
     v->Visit("stage_map", &stage_map);
     v->Visit("num_hfuse_groups", &num_hfuse_groups);
+    v->Visit("prep_code_scan_blocks", &prep_code_scan_blocks);
+    v->Visit("shared_prep_code", &shared_prep_code);
   }
 
   /*! \brief Initialize temp cache. */
@@ -767,6 +820,18 @@ class ScheduleNode : public Object {
  */
 inline Schedule create_schedule(Array<Operation> ops) { return ScheduleNode::make(ops); }
 
+/*!
+ * \brief Make split points for Schedule::split_for_bin_packing that split
+ *  a loop of extent l_fun into tiers of whole tiles of each of the tile
+ *  factors, followed by a remainder tier. The split loops of all but
+ *  the last tier then need no tail.
+ * \param l_fun The extent of the loop to split.
+ * \param tile_factors Decreasing tile factors, each dividing the previous one.
+ * \return The split points.
+ */
+TVM_DLL Array<tir::UninterpFun> MakeBinPackSplitPoints(tir::UninterpFun l_fun,
+                                                       Array<Integer> tile_factors);
+
 /*! \brief node container for IterVar attr */
 class IterVarAttrNode : public Object {
  public:
@@ -791,6 +856,19 @@ class IterVarAttrNode : public Object {
   Array<PrimExpr> pragma_keys;
   /*! \brief Additional values of pragma, if any */
   Array<PrimExpr> pragma_values;
+  /*!
+   * \brief Cumulative cost of the iterations before the current
+   *  one, in terms of the iter var, if the loop is parallelized by
+   *  balanced_parallel
+   */
+  PrimExpr balanced_cost;
+  /*!
+   * \brief If defined, the loop runs over the positions of the iter
+   *  var in the order given by this function, set by sort_by_length
+   */
+  tir::UninterpFun permutation;
+  /*! \brief The key, in terms of the iter var, permutation sorts by */
+  PrimExpr permutation_key;
   /*! \brief hfusion group id, if any */
   int hfuse_group_id = -1;
   /*! \brief whether to unroll, if bound to a vthread/cthread */
@@ -806,6 +884,9 @@ class IterVarAttrNode : public Object {
     v->Visit("dim_align_offset", &dim_align_offset);
     v->Visit("pragma_keys", &pragma_keys);
     v->Visit("pragma_values", &pragma_values);
+    v->Visit("balanced_cost", &balanced_cost);
+    v->Visit("permutation", &permutation);
+    v->Visit("permutation_key", &permutation_key);
     v->Visit("hfuse_group_id", &hfuse_group_id);
     v->Visit("unroll_vthread", &unroll_vthread);
   }
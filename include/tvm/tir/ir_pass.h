@@ -352,6 +352,17 @@ Stmt StorageRewrite(Stmt stmt);
  * \return Transformed stmt.
  */
 Stmt LoopPartition(Stmt stmt, bool split_const_loop);
+
+/*!
+ * \brief Peel the tails of loops split over ragged extents. A loop
+ *  whose body checks likely(F * i + r < L), with L invariant in the
+ *  loop, is split into a main loop without the check and a tail loop
+ *  keeping it, which runs at most once when the loop is a split of L
+ *  by F.
+ * \param stmt The stmt to do loop partition
+ * \return Transformed stmt.
+ */
+Stmt RaggedLoopPartition(Stmt stmt);
 Stmt RemoveLikelyTags(Stmt stmt);
 
 /*!
@@ -523,7 +534,7 @@ enum class PrepCodeMode {
 };
 MakeAPIResult MakeAPI(Stmt body, std::string name, Array<ObjectRef> length_api_args,
                       Array<ObjectRef> tensor_api_args, int num_unpacked_args, bool is_restricted,
-                      PrepCodeMode prep_code_mode);
+                      PrepCodeMode prep_code_mode, bool cache_prep_code = false);
 
 /*!
  * \brief Bind the device type of host function to be device_type.
@@ -45,14 +45,17 @@ class ModesNode : public runtime::Object {
   mutable Map<Dimension, Array<Dimension>> transitive_dependent_dims;
   /*! \brief Map from a dimension to all dimensions that immediately depend on it wrt l_funs */
   mutable Map<Dimension, Array<Dimension>> immediate_dependent_dims;
+  /*! \brief Cached number of bits of the index type, 0 if not computed yet */
+  mutable int index_bits{0};
 
   void VisitAttrs(AttrVisitor* v) {
     v->Visit("dimensions", &dimensions);
     v->Visit("l_funs", &l_funs);
     v->Visit("l_fun_mins", &l_fun_mins);
     v->Visit("a_funs", &a_funs);
-    v->Visit("transitive_dependent_dims", &transitive_dependent_dims);
-    v->Visit("immediate_dependent_dims", &immediate_dependent_dims);
+    // The dependent dims are recomputed on demand. They are not
+    // visited, as Maps keyed on Dimensions serialize in the order of
+    // their addresses, which would make save_json nondeterministic.
     v->Visit("loop_layout", &loop_layout);
   }
 
@@ -76,6 +79,32 @@ class ModesNode : public runtime::Object {
                                            Array<PrimExpr> l_maxes, Array<UninterpFun> l_funs,
                                            Map<Dimension, UninterpFun> user_a_funs);
 
+  /*!
+   * \brief Make a storage layout in which the length of each ragged
+   *  dimension is padded up to a multiple of its bucket size, so that
+   *  loops split by (a divisor of) the bucket size have no tails. The
+   *  a_funs are computed on the padded lengths.
+   *
+   * \param bucket_sizes The bucket size of each dimension. A bucket
+   *  size of 1 keeps the exact length of the dimension.
+   */
+  TVM_DLL static Modes make_padded_storage_layout(Array<tvm::te::Dimension> dimensions,
+                                                  Array<PrimExpr> l_maxes,
+                                                  Array<UninterpFun> l_funs,
+                                                  Array<Integer> bucket_sizes,
+                                                  Map<Dimension, UninterpFun> user_a_funs);
+
+  /*!
+   * \brief Make a copy of a storage layout in which each row of the
+   *  ragged dimension at dim_idx, ie. its slice for a fixed value of
+   *  the outer dimension it depends on, starts at a multiple of
+   *  factor elements. The length of the dimension is padded such
+   *  that the size of a row, including the dense dimensions inside
+   *  it, is a multiple of factor. The a_funs are computed on the
+   *  padded lengths.
+   */
+  TVM_DLL static Modes make_row_aligned_storage_layout(Modes layout, int dim_idx, int factor);
+
   TVM_DLL static Modes make(std::string name, Array<PrimExpr> dense_shape, bool is_loop_layout);
 
   /*! \brief Get dense overapproximated shape. */
@@ -103,7 +132,11 @@ class ModesNode : public runtime::Object {
 
   const PrimExpr GetAllocationSize() const;
 
-  const DataType get_dtype() const { return DataType::Int(32); };
+  /*! \brief The index type of positions in this layout. int64 if
+   * the product of the constant bounds of the dense extents, which
+   * bound GetAllocationSize, overflows int32, or if an extent without
+   * a constant bound is of an int64 type. int32 otherwise. */
+  const DataType get_dtype() const;
 
   static constexpr const char* _type_key = "tir.Modes";
   TVM_DECLARE_FINAL_OBJECT_INFO(ModesNode, Object);
@@ -671,6 +671,12 @@ constexpr const char* pragma_tensor_core = "pragma_tensor_core";
  *  run prefetch of Tensor on the current loop scope
  */
 constexpr const char* prefetch_scope = "prefetch_scope";
+/*!
+ * \brief Mark of the cumulative cost of a parallel loop, placed
+ *  among the attributes at the head of the body of the loop,
+ *  value=the total cost of the iterations before the current one.
+ */
+constexpr const char* parallel_balanced_cost = "parallel_balanced_cost";
 /*!
  * \brief Marks production of double buffer data
  */
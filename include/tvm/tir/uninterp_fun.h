@@ -195,6 +195,22 @@ class UninterpFun : public FunctionRef {
   static ArgMappingAndEquality CheckEquality(UninterpFun f1, UninterpFun f2);
 
   static PrimExpr RelaxUninterpCallsMaxInclusive(PrimExpr expr, bool complex_only = true);
+
+  /*!
+   * \brief Closed form of the exclusive prefix sum sum_{var < n}
+   *  weight(var), if there is one. This is the case when weight, after
+   *  inlining uninterpreted function calls, is of the form a * var + c
+   *  * floordiv(var, k) + b for integer constants a, b, c and k, which
+   *  covers triangular and uniformly bucketed raggedness.
+   * \return The sum as an expression of n, or an undefined expression.
+   */
+  static PrimExpr ClosedFormPrefixSum(Var var, PrimExpr weight, PrimExpr n);
+
+  /*!
+   * \brief Make an l_fun returning the value of l_fun rounded up to a
+   *  multiple of bucket_size.
+   */
+  static UninterpFun MakePaddedLFun(UninterpFun l_fun, int bucket_size);
 };
 
 inline const UninterpFunNode* UninterpFun::operator->() const {
@@ -18,6 +18,6 @@
 
 from .int_set import IntSet, IntervalSet
 # from .uninterp_fun import UninterpFun
-from .analyzer import ModularSet, ConstIntBound, Analyzer
+from .analyzer import ModularSet, ConstIntBound, Analyzer, z3_stats, z3_timeouts, reset_z3_stats
 from .bound import deduce_bound
 from .pattern import detect_linear_equation, detect_clip_bound
@@ -243,3 +243,36 @@ class Analyzer:
         else:
             raise TypeError(
                 "Do not know how to handle type {}".format(type(info)))
+
+
+def z3_stats():
+    """Get the statistics of the Z3 queries made so far, per pass.
+
+    Returns
+    -------
+    stats : dict of str to dict
+        For each pass, the number of queries that reached Z3, of
+        queries answered from the cache, of queries solved, of
+        queries proved, of queries Z3 gave up on (timeouts) and of
+        queries skipped once the z3_pass_timeout_ms or
+        z3_pass_max_solver_checks budget of the pass was exhausted, and the time spent in the solver in ms.
+    """
+    return {str(k): {str(name): v.value for name, v in pass_stats.items()}
+            for k, pass_stats in _ffi_api.Z3GetStats().items()}
+
+
+def z3_timeouts():
+    """Get the first queries Z3 gave up on, which fell back to bound
+    analysis.
+
+    Returns
+    -------
+    timeouts : list of tuple
+        (pass, query, reason) for each query.
+    """
+    return [tuple(field.value for field in entry) for entry in _ffi_api.Z3GetTimeouts()]
+
+
+def reset_z3_stats():
+    """Reset the statistics of the Z3 queries."""
+    _ffi_api.Z3ResetStats()
@@ -39,9 +39,9 @@ from . import tophub
 
 # some shortcuts
 from .measure import measure_option, MeasureInput, MeasureResult, MeasureErrorNo, \
-    LocalBuilder, LocalRunner, RPCRunner
+    LocalBuilder, LocalRunner, RPCRunner, RaggedLocalBuilder, RaggedLocalRunner
 from .tuner import callback
-from .task import template, get_config, create, ConfigSpace, ConfigEntity, \
+from .task import template, get_config, create, create_ragged, ConfigSpace, ConfigEntity, \
     register_topi_compute, register_topi_schedule, \
     DispatchContext, FallbackContext, ApplyHistoryBest as apply_history_best, \
     ApplyGraphBest as apply_graph_best
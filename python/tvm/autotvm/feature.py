@@ -37,12 +37,17 @@ def ana_lower(sch, args,
               simple_mode=True):
     """Do lower while keeping all axes in IR
     i.e. Do not eliminate loop with extent of 1, do not vectorize, unroll or inject virtual threads
+
+    args is either a list of tensors, or the argument lists of a
+    ragged build, ie. [length_args, tensor_args]
     """
-    binds, _ = build_module.get_binds(args, binds)
+    if args and not isinstance(args[0], (list, tuple)):
+        args = [args]
     sch = sch.normalize()
     # Phase 0
     bounds = schedule.InferBound(sch)
-    stmt = schedule.ScheduleOps(sch, bounds, True)
+    stmt = schedule.ScheduleOps(sch, bounds, True, False, True, [])
+    binds, _ = build_module.get_binds(sch, args, binds=binds)
     stmt = ir_pass.StorageFlatten(stmt, binds, 64)
     stmt = ir_pass.CanonicalSimplify(stmt)
     assert simple_mode
@@ -59,7 +64,48 @@ except ValueError as e:
     _get_buffer_curve_sample_flatten = _get_itervar_feature = _get_itervar_feature_flatten = \
         raise_error
 
-def get_itervar_feature(sch, args, take_log=False):
+def length_distributions(length_samples, max_points=32):
+    """Convert the length samples of ragged loops into the
+    distributions expected by the feature extraction functions
+
+    Parameters
+    ----------
+    length_samples: dict of str to list of int or dict of int to float
+        Map from the name of a buffer holding lengths, or of the
+        uninterpreted function computing them, to either samples of
+        the lengths or a histogram mapping lengths to frequencies.
+    max_points: int
+        Maximum number of values kept per distribution. Neighbouring
+        values are merged into groups of about equal weight beyond it.
+
+    Returns
+    -------
+    distributions: dict of str to [values, weights], or None
+    """
+    if not length_samples:
+        return None
+    ret = {}
+    for name, samples in length_samples.items():
+        if isinstance(samples, dict):
+            values = np.array(list(samples.keys()), dtype="int64")
+            weights = np.array(list(samples.values()), dtype="float64")
+        else:
+            values, counts = np.unique(np.asarray(samples, dtype="int64"), return_counts=True)
+            weights = counts.astype("float64")
+        order = np.argsort(values)
+        values, weights = values[order], weights[order] / np.sum(weights)
+        if len(values) > max_points:
+            groups = ((np.cumsum(weights) - weights / 2) * max_points).astype("int64")
+            groups = np.minimum(groups, max_points - 1)
+            group_weights = np.bincount(groups, weights=weights, minlength=max_points)
+            group_sums = np.bincount(groups, weights=weights * values, minlength=max_points)
+            keep = group_weights > 0
+            values = np.rint(group_sums[keep] / group_weights[keep]).astype("int64")
+            weights = group_weights[keep]
+        ret[name] = [[int(v) for v in values], [float(w) for w in weights]]
+    return ret
+
+def get_itervar_feature(sch, args, take_log=False, length_samples=None):
     """get features of iter vars
 
     Parameters
@@ -69,13 +115,16 @@ def get_itervar_feature(sch, args, take_log=False):
         the buffer args for lower
     take_log: bool
         whether take log of numerical statics
+    length_samples: dict, optional
+        the lengths of ragged loops, see length_distributions. The
+        extents of ragged loops are replaced by their expected value.
 
     Returns
     -------
     features of every axis in the IR, see doc/features.md for detail
     """
     stmt = ana_lower(sch, args, simple_mode=True)
-    feas = _get_itervar_feature(stmt, take_log)
+    feas = _get_itervar_feature(stmt, take_log, length_distributions(length_samples))
 
     # convert tvm node to python type
     ret = []
@@ -106,7 +155,7 @@ def flatten_itervar_feature(fea):
             flatten.append(pair[1:])
     return np.concatenate(flatten)
 
-def get_itervar_feature_flatten(sch, args, take_log=True):
+def get_itervar_feature_flatten(sch, args, take_log=True, length_samples=None):
     """get flatten features of iter vars
     this is equivalent to get_itervar_feature + flatten_itervar_feature, but much faster.
 
@@ -117,6 +166,8 @@ def get_itervar_feature_flatten(sch, args, take_log=True):
         the buffer args for lower
     take_log: bool
         whether take log of numerical statics
+    length_samples: dict, optional
+        the lengths of ragged loops, see length_distributions
 
     Returns
     -------
@@ -124,7 +175,7 @@ def get_itervar_feature_flatten(sch, args, take_log=True):
         one-dimensional vector
     """
     stmt = ana_lower(sch, args, simple_mode=True)
-    feas = _get_itervar_feature_flatten(stmt, take_log)
+    feas = _get_itervar_feature_flatten(stmt, take_log, length_distributions(length_samples))
     feas = struct.unpack('%df' % (len(feas)//4), feas)
     return feas
 
@@ -176,7 +227,7 @@ def get_flatten_name(fea):
     return names
 
 
-def get_buffer_curve_sample_flatten(sch, args, sample_n=30):
+def get_buffer_curve_sample_flatten(sch, args, sample_n=30, length_samples=None):
     """
     Get flatten curve sample feature (relation feature)
 
@@ -187,6 +238,8 @@ def get_buffer_curve_sample_flatten(sch, args, sample_n=30):
         the buffer args for lower
     sample_n: int
         number of sample points along one dimension
+    length_samples: dict, optional
+        the lengths of ragged loops, see length_distributions
 
     Returns
     -------
@@ -194,6 +247,7 @@ def get_buffer_curve_sample_flatten(sch, args, sample_n=30):
         one-dimensional vector
     """
     stmt = ana_lower(sch, args, simple_mode=True)
-    feas = _get_buffer_curve_sample_flatten(stmt, sample_n, False)
+    feas = _get_buffer_curve_sample_flatten(stmt, sample_n,
+                                            length_distributions(length_samples))
     feas = struct.unpack('%df' % (len(feas)//4), feas)
     return feas
@@ -18,6 +18,7 @@
 
 from .measure import MeasureInput, MeasureResult, MeasureErrorNo, measure_option, \
     create_measure_batch
-from .measure_methods import LocalBuilder, LocalRunner, RPCRunner, request_remote
+from .measure_methods import LocalBuilder, LocalRunner, RPCRunner, request_remote, \
+    RaggedLocalBuilder, RaggedLocalRunner
 from .executor import Executor
 from .local_executor import LocalExecutor
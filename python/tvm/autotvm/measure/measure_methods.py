@@ -35,7 +35,8 @@ import numpy as np
 
 from ... import ir_pass, build, build_config, nd, TVMError, register_func, \
     rpc as _rpc, target as _target
-from ...contrib import nvcc, ndk, tar
+from ...contrib import cc, nvcc, ndk, tar
+from ...runtime import load_module
 
 from ..util import get_const_tuple
 from ..env import AutotvmGlobalScope
@@ -343,6 +344,85 @@ class LocalRunner(RPCRunner):
         return server, tracker
 
 
+class RaggedLocalBuilder(LocalBuilder):
+    """Compile ragged templates, see :any:`autotvm.task.create_ragged`,
+    into shared libraries on the local machine, to be measured with
+    :any:`RaggedLocalRunner`.
+
+    Parameters
+    ----------
+    timeout: float
+        The timeout of a compilation
+    n_parallel: int
+        The number of tasks run in parallel. "None" will use all cpu cores
+    """
+    def __init__(self, timeout=10, n_parallel=None):
+        super(RaggedLocalBuilder, self).__init__(timeout, n_parallel, cc.create_shared)
+        self.build_func = _wrap_ragged_build_func(cc.create_shared)
+
+
+class RaggedLocalRunner(Runner):
+    """Run ragged templates built by :any:`RaggedLocalBuilder` on the
+    local CPU, over the length batches of their task.
+
+    Each batch is measured with `number` x `repeat` runs and its cost
+    is the median of the repeats. The cost of a config is the
+    objective of the task, the mean or the p99 of the costs of the
+    batches.
+
+    Parameters
+    ----------
+    timeout: float
+        The timeout of the measurement of a config over all the batches
+    number: int
+        The number of times to run the generated code for taking average.
+        We call these runs as one `repeat` of measurement.
+    repeat : int, optional
+        The number of times to repeat the measurement of a batch.
+    min_repeat_ms: int, optional
+        The minimum duration of one `repeat` in milliseconds.
+    cooldown_interval: float, optional
+        The cool down interval between two measurements.
+    """
+    def __init__(self, timeout=10, number=4, repeat=3, min_repeat_ms=0, cooldown_interval=0.1):
+        super(RaggedLocalRunner, self).__init__(timeout, 1)
+
+        self.number = number
+        self.repeat = repeat
+        self.min_repeat_ms = min_repeat_ms
+        self.cooldown_interval = cooldown_interval
+
+        self.executor = LocalExecutor(timeout=timeout)
+
+    def set_task(self, task):
+        if not task.length_batches:
+            raise ValueError("Ragged tasks should be created with autotvm.task.create_ragged")
+        if 'cpu' not in task.target.keys:
+            raise ValueError("RaggedLocalRunner only measures on the local CPU")
+        self.task = task
+
+    def get_build_kwargs(self):
+        return {}
+
+    def run(self, measure_inputs, build_results):
+        results = []
+        for measure_inp, build_res in zip(measure_inputs, build_results):
+            res = self.executor.submit(run_ragged_local,
+                                       measure_inp,
+                                       build_res,
+                                       self.number,
+                                       self.repeat,
+                                       self.min_repeat_ms,
+                                       self.cooldown_interval).get()
+            if isinstance(res, Exception):   # executor error or timeout
+                results.append(MeasureResult((str(res),), MeasureErrorNo.RUN_TIMEOUT,
+                                             self.timeout, time.time()))
+            else:
+                results.append(res)
+
+        return results
+
+
 def _build_func_common(measure_input, check_gpu=None, cuda_arch=None, build_option=None):
     """Common part for building a configuration"""
     target, task, config = measure_input
@@ -414,6 +494,118 @@ def _wrap_build_func(build_func):
     return _wrapped
 
 
+def _build_ragged_func_common(measure_input, build_option=None):
+    """Build a configuration of a ragged template. The returned
+    argument information holds the names of the length arguments,
+    followed by the shapes and dtypes of the tensors, the host
+    intermediate buffers and the device intermediate buffers, None
+    for the ones shared with the host."""
+    target, task, config = measure_input
+    with target:
+        s, args = task.instantiate(config)
+
+        if not config.valid():
+            raise InstantiationError(config.errors)
+
+        with build_config(**(build_option or {})):
+            func, intermediate_buffers = build(s, args, str(target),
+                                               target_host=task.target_host)
+
+    def _buffer_info(buf):
+        shape = tuple(int(ir_pass.Simplify(e)) for e in buf.shape.dense_shape())
+        return shape, buf.dtype
+
+    length_args, tensor_args = args
+    host_bufs, dev_bufs = intermediate_buffers
+    arg_info = (tuple(x.name for x in length_args),
+                tuple((get_const_tuple(x.shape), x.dtype) for x in tensor_args),
+                tuple(_buffer_info(b) for b in host_bufs),
+                tuple(None if d.same_as(h) else _buffer_info(d)
+                      for h, d in zip(host_bufs, dev_bufs)))
+    return func, arg_info
+
+
+def _wrap_ragged_build_func(build_func):
+    """Wrap build_func to a function building ragged templates, see
+    _wrap_build_func"""
+    output_format = build_func.output_format
+
+    def _wrapped(measure_input, tmp_dir, **kwargs):
+        tic = time.time()
+        try:
+            filename = os.path.join(tmp_dir, "tmp_func_%0x.%s" % (
+                getrandbits(64), output_format))
+            func, arg_info = _build_ragged_func_common(measure_input, **kwargs)
+            func.export_library(filename, build_func)
+        except Exception as e:  # pylint: disable=broad-except
+            return BuildResult(None, None, e, time.time() - tic)
+        return BuildResult(filename, arg_info, None, time.time() - tic)
+    return _wrapped
+
+
+def run_ragged_local(measure_input, build_result,
+                     number, repeat, min_repeat_ms, cooldown_interval):
+    """Run a library built by RaggedLocalBuilder on the local CPU, on
+    each length batch of its task
+
+    Parameters
+    ----------
+    measure_input: MeasureInput
+        The raw measure input
+    build_result: BuildResult
+        The result returned from RaggedLocalBuilder
+    number: int
+        The number of times to run the generated code for taking average.
+    repeat : int
+        The number of times to repeat the measurement of a batch.
+    min_repeat_ms: int
+        The minimum duration of one `repeat` in milliseconds.
+    cooldown_interval: float
+        The cool down interval between two measurements
+    """
+    if isinstance(build_result, MeasureResult):
+        return build_result
+
+    tic = time.time()
+    errno = MeasureErrorNo.NO_ERROR
+    task = measure_input.task
+    try:
+        func = load_module(build_result.filename)
+        ctx = nd.cpu(0)
+        time_f = func.time_evaluator(
+            func.entry_name, ctx, number=number, repeat=repeat, min_repeat_ms=min_repeat_ms)
+
+        length_names, tensor_info, host_info, dev_info = build_result.arg_info
+        tensors = [nd.array(np.zeros(shape, dtype=dtype), ctx) for shape, dtype in tensor_info]
+        host_bufs = [nd.empty(shape, dtype, ctx) for shape, dtype in host_info]
+        dev_bufs = [h if d is None else nd.empty(d[0], d[1], ctx)
+                    for h, d in zip(host_bufs, dev_info)]
+
+        batch_costs = []
+        num_batches = len(task.length_batches[length_names[0]]) if length_names else 1
+        for i in range(num_batches):
+            lengths = [nd.array(task.length_batches[name][i], ctx) for name in length_names]
+            costs = time_f(*(tensors + lengths + host_bufs + dev_bufs)).results
+            batch_costs.append(np.median(costs))
+
+        if task.objective == "p99":
+            costs = (float(np.percentile(batch_costs, 99)),)
+        else:
+            costs = (float(np.mean(batch_costs)),)
+    except TVMError as exc:
+        msg = str(exc)
+        if "Stack trace returned" in msg:
+            msg = msg[:msg.index("Stack trace returned")]
+        costs = (RuntimeError(msg[:1024]),)
+        errno = MeasureErrorNo.RUNTIME_DEVICE
+    except Exception as exc:  # pylint: disable=broad-except
+        costs = (exc,)
+        errno = MeasureErrorNo.UNKNOWN_ERROR
+    tstamp = time.time()
+    time.sleep(cooldown_interval)
+    return MeasureResult(costs, errno, tstamp - tic + build_result.time_cost, tstamp)
+
+
 def run_through_rpc(measure_input, build_result,
                     number, repeat, min_repeat_ms, cooldown_interval,
                     remote_args, ref_input=None, ref_output=None):
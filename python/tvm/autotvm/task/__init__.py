@@ -23,6 +23,7 @@ of typical tasks of interest.
 """
 
 from .task import Task, create, register, template, get_config, args_to_workload
+from .ragged import create_ragged
 from .space import ConfigSpace, ConfigEntity
 from .code_hash import attach_code_hash, attach_code_hash_to_arg
 from .dispatcher import dispatcher, DispatchContext, ApplyConfig, ApplyHistoryBest, \
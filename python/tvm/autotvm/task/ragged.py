@@ -0,0 +1,170 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Tuning tasks for ragged tensor operators.
+
+A ragged template is a template function that returns a schedule
+and the argument lists of a ragged build, ie. ``(s, [length_args,
+tensor_args])`` where length_args are the placeholders holding the
+lengths. Its search space typically covers the transformations
+specific to ragged operators, which the helpers below define as
+knobs: the tile factors of bin packing splits, the bucket sizes
+ragged dimensions are padded to, whether to fuse ragged dimensions
+and the groups of loops to horizontally fuse.
+
+As the number of floating point operations of a ragged operator
+depends on the lengths, templates should count them with
+``cfg.add_flop``.
+
+Configs are measured over batches of lengths with
+:any:`RaggedLocalRunner`, and scored by the mean or the p99 of their
+run times on the batches.
+"""
+import numpy as np
+
+from ... import te
+from .task import create
+
+OBJECTIVES = ("mean", "p99")
+
+
+def create_ragged(func_name, args, length_batches, target="llvm", target_host=None,
+                  objective="mean", template_key=None):
+    """Create a tuning task for a ragged template
+
+    Parameters
+    ----------
+    func_name : str or callable
+        The template function
+    args : List
+        Positional arguments of the template
+    length_batches : dict of str to list of array of int
+        Map from the name of each length argument of the template to
+        the batches of lengths to measure configs on. Every length
+        argument should have the same number of batches, measurement
+        i uses the i-th batch of each argument.
+    target : Target
+        The compilation target, a CPU target
+    target_host: Target, optional
+        The compilation target for host side
+    objective : str
+        "mean" or "p99", the statistic of the run times on the
+        batches configs are scored by.
+
+    Returns
+    -------
+    tsk: Task
+        a task object
+    """
+    if objective not in OBJECTIVES:
+        raise ValueError("Invalid objective " + objective)
+    batches = {name: [np.asarray(b, dtype="int32") for b in bs]
+               for name, bs in length_batches.items()}
+    if len({len(bs) for bs in batches.values()}) != 1:
+        raise ValueError("All length arguments should have the same number of batches")
+
+    tsk = create(func_name, args, target, target_host, template_key)
+    tsk.length_batches = batches
+    tsk.objective = objective
+    tsk.length_samples = {name: np.concatenate(bs) for name, bs in batches.items()}
+    return tsk
+
+
+def define_bin_pack_split(cfg, name, tile_factor_candidates):
+    """Define a knob choosing the tile factors of a bin packing split,
+    see :any:`tvm.te.bin_pack_split_points`
+
+    Parameters
+    ----------
+    cfg : ConfigSpace
+    name : str
+        name key of the knob
+    tile_factor_candidates : list of list of int
+        the candidate tile factors. Empty factors mean no split.
+    """
+    cfg.define_knob(name, [tuple(factors) for factors in tile_factor_candidates])
+
+
+def get_bin_pack_split_points(cfg, name, l_fun):
+    """Get the split points chosen for a loop of extent l_fun
+
+    Returns
+    -------
+    split_points : list of UninterpFun
+        the split points for :any:`Schedule.split_for_bin_packing`,
+        empty if the loop should not be split
+    """
+    factors = cfg[name].val
+    return te.bin_pack_split_points(l_fun, list(factors)) if factors else []
+
+
+def define_bucket_size(cfg, name, candidates=(1, 2, 4, 8, 16, 32)):
+    """Define a knob choosing the bucket size the lengths of a ragged
+    dimension are padded to, passed as bucket_sizes to
+    :any:`tvm.te.ragged_compute` and :any:`tvm.te.ragged_placeholder`"""
+    cfg.define_knob(name, list(candidates))
+
+
+def define_fuse_ragged(cfg, name):
+    """Define a knob choosing whether to fuse a ragged dimension with
+    its outer dimension, see :any:`tvm.te.fuse_ragged_axis`"""
+    cfg.define_knob(name, [False, True])
+
+
+def _set_partitions(items):
+    if not items:
+        yield ()
+        return
+    first, rest = items[0], items[1:]
+    for partition in _set_partitions(rest):
+        yield ((first,),) + partition
+        for i, group in enumerate(partition):
+            yield partition[:i] + ((first,) + group,) + partition[i + 1:]
+
+
+def define_hfuse_groups(cfg, name, num_loops):
+    """Define a knob choosing how to group num_loops independent loops
+    for horizontal fusion, among all the partitions of the loops
+
+    Parameters
+    ----------
+    cfg : ConfigSpace
+    name : str
+        name key of the knob
+    num_loops : int
+        the number of loops that can be fused. The number of
+        partitions grows quickly, so at most 8 loops are supported.
+    """
+    if num_loops > 8:
+        raise ValueError("Too many loops to enumerate their groupings")
+    cfg.define_knob(name, list(_set_partitions(tuple(range(num_loops)))))
+
+
+def apply_hfuse_groups(cfg, name, s, fuse_tuples):
+    """Horizontally fuse the loops in the groups chosen for the knob
+
+    Parameters
+    ----------
+    cfg : ConfigEntity
+    name : str
+        name key of the knob
+    s : Schedule
+    fuse_tuples : list of (Operation, IterVar)
+        the loops, as passed to :any:`Schedule.hfuse`
+    """
+    for group in cfg[name].val:
+        if len(group) > 1:
+            s.hfuse([fuse_tuples[i] for i in group])
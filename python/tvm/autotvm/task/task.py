@@ -60,6 +60,14 @@ class Task(object):
         self.target = None
         self.target_host = None
 
+        # lengths of the ragged loops of the task, used by the cost
+        # model features, see feature.length_distributions
+        self.length_samples = None
+        # batches of lengths configs are measured on, and the
+        # statistic they are scored by, see ragged.create_ragged
+        self.length_batches = None
+        self.objective = "mean"
+
     def instantiate(self, config):
         """Instantiate this task function (template) with a config.
         Returns corresponding schedule.
@@ -97,7 +105,10 @@ class Task(object):
             "workload": self.workload,
             "flop": self.flop,
             "target": self.target,
-            "target_host": self.target_host
+            "target_host": self.target_host,
+            "length_samples": self.length_samples,
+            "length_batches": self.length_batches,
+            "objective": self.objective
         }
 
     def __setstate__(self, state):
@@ -110,6 +121,9 @@ class Task(object):
         self.flop = state["flop"]
         self.target = state["target"]
         self.target_host = state["target_host"]
+        self.length_samples = state.get("length_samples", None)
+        self.length_batches = state.get("length_batches", None)
+        self.objective = state.get("objective", "mean")
 
     def __repr__(self):
         return "Task(func_name=%s, args=%s, kwargs=%s, workload=%s)" % (
@@ -338,7 +338,8 @@ def _extract_itervar_feature_index(index):
         config = _extract_space.get(index)
         with _extract_target:
             sch, args = _extract_task.instantiate(config)
-        fea = feature.get_itervar_feature_flatten(sch, args, take_log=True)
+        fea = feature.get_itervar_feature_flatten(sch, args, take_log=True,
+                                                  length_samples=_extract_task.length_samples)
         fea = np.concatenate((fea, list(config.get_other_option().values())))
         return fea
     except Exception:  # pylint: disable=broad-except
@@ -351,7 +352,8 @@ def _extract_itervar_feature_log(arg):
         config = inp.config
         with inp.target:
             sch, args = inp.task.instantiate(config)
-        fea = feature.get_itervar_feature_flatten(sch, args, take_log=True)
+        fea = feature.get_itervar_feature_flatten(sch, args, take_log=True,
+                                                  length_samples=inp.task.length_samples)
         x = np.concatenate((fea, list(config.get_other_option().values())))
 
         if res.error_no == 0:
@@ -393,7 +395,8 @@ def _extract_curve_feature_index(index):
         config = _extract_space.get(index)
         with _extract_target:
             sch, args = _extract_task.instantiate(config)
-        fea = feature.get_buffer_curve_sample_flatten(sch, args, sample_n=20)
+        fea = feature.get_buffer_curve_sample_flatten(sch, args, sample_n=20,
+                                                      length_samples=_extract_task.length_samples)
         fea = np.concatenate((fea, list(config.get_other_option().values())))
         return np.array(fea)
     except Exception:  # pylint: disable=broad-except
@@ -406,7 +409,8 @@ def _extract_curve_feature_log(arg):
         config = inp.config
         with inp.target:
             sch, args = inp.task.instantiate(config)
-        fea = feature.get_buffer_curve_sample_flatten(sch, args, sample_n=20)
+        fea = feature.get_buffer_curve_sample_flatten(sch, args, sample_n=20,
+                                                      length_samples=inp.task.length_samples)
         x = np.concatenate((fea, list(config.get_other_option().values())))
 
         if res.error_no == 0:
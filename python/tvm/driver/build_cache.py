@@ -0,0 +1,154 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""On-disk cache of the modules compiled by build.
+
+With the build config option build_cache_dir set, build looks the
+lowered functions up in the cache before generating code for them.
+The cache is content addressed: the key of a build is the sha256 of
+
+- the lowered functions of each target, serialized with save_json,
+  which covers the prep code that MakeAPIWithPrepCode and
+  MakeAPIOnlyPrepCode emit,
+- the targets and the host target,
+- the build config options, including prep_code_mode,
+- the arguments of build that only apply after lowering, such as
+  constraints, cuda_syncs, substitutes and substitute_after_hfuse,
+- the path, size and modification time of the TVM library, so that
+  a rebuilt compiler does not reuse stale code.
+
+Entries are shared libraries written with export_library, which packs
+the device modules, and are loaded with load_module.
+"""
+import hashlib
+import json
+import os
+import warnings
+
+import tvm._ffi
+from tvm.ir import save_json
+from tvm.runtime import convert, load_module
+from tvm.target import BuildConfig
+from tvm import target as _target
+from . import compile_profiler
+
+
+def _func_key(func):
+    # handle_data_type is a Map keyed on Vars whose serialization order
+    # depends on addresses, so it is keyed on the argument positions.
+    hdt = func.handle_data_type
+    handle_types = [str(hdt[arg].dtype) if arg in hdt else "" for arg in func.args]
+    return {
+        "name": func.name,
+        "func_type": func.func_type,
+        "is_packed_func": func.is_packed_func,
+        "is_restricted": func.is_restricted,
+        "handle_types": handle_types,
+        "ir": save_json(convert([func.args, func.thread_axis, func.body])),
+    }
+
+
+def _build_args_key(build_args):
+    key = {}
+    for name, value in build_args.items():
+        if value is None or isinstance(value, (bool, int, str)):
+            key[name] = value
+        else:
+            key[name] = save_json(convert(value))
+    return key
+
+
+def _lib_key():
+    path = tvm._ffi.base._LIB._name
+    stat = os.stat(path)
+    return [path, stat.st_size, stat.st_mtime_ns]
+
+
+def cache_key(target_flist, target_host, build_args=None):
+    """Compute the key of a build.
+
+    Parameters
+    ----------
+    target_flist : dict of Target to list of LoweredFunc
+        The lowered functions of each target.
+
+    target_host : str or Target
+        The host compilation target.
+
+    build_args : dict of str to object, optional
+        The other arguments of build the compiled module depends on.
+
+    Returns
+    -------
+    key : str or None
+        The hex digest of the key, None if the functions cannot be
+        serialized.
+    """
+    cfg = BuildConfig.current()
+    # The code does not depend on the number of threads it is built on
+    options = {k: getattr(cfg, k) for k in sorted(BuildConfig._object_defaults)
+               if k not in ("build_cache_dir", "parallel_build_threads")}
+    try:
+        funcs = sorted(([str(_target.create(tar)), [_func_key(f) for f in flist]]
+                        for tar, flist in target_flist.items()), key=lambda x: x[0])
+        args = _build_args_key(build_args or {})
+    except (tvm.TVMError, ValueError) as err:
+        warnings.warn("Not caching a build whose functions cannot be serialized: %s" % err)
+        return None
+    key = {
+        "funcs": funcs,
+        "target_host": str(_target.create(target_host)),
+        "options": options,
+        "args": args,
+        "lib": _lib_key(),
+    }
+    return hashlib.sha256(json.dumps(key, sort_keys=True).encode("utf-8")).hexdigest()
+
+
+def _path(cache_dir, key):
+    return os.path.join(cache_dir, key[:2], key + ".so")
+
+
+def load(cache_dir, key):
+    """Load the module cached under key, None on a miss."""
+    path = _path(cache_dir, key)
+    if not os.path.exists(path):
+        return None
+    try:
+        return compile_profiler.run("build_cache.load", "cache", load_module, path)
+    except tvm.TVMError as err:
+        warnings.warn("Removing the unloadable build cache entry %s: %s" % (path, err))
+        os.remove(path)
+        return None
+
+
+def save(cache_dir, key, module):
+    """Save module under key. Modules that cannot be exported as a
+    shared library, such as stackvm ones, are not cached."""
+    if not module._dso_exportable():
+        return
+    path = _path(cache_dir, key)
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    # Write to a temporary file first so that concurrent builds never
+    # load a partial library.
+    tmp_path = "%s.%d.tmp.so" % (path[:-3], os.getpid())
+    try:
+        compile_profiler.run("build_cache.save", "cache", module.export_library, tmp_path)
+        os.replace(tmp_path, path)
+    except (tvm.TVMError, RuntimeError, OSError) as err:
+        warnings.warn("Could not save the build cache entry %s: %s" % (path, err))
+        if os.path.exists(tmp_path):
+            os.remove(tmp_path)
@@ -20,18 +20,25 @@ This module provides the functions to transform schedule to
 LoweredFunc and compiled Module.
 """
 import warnings
+from concurrent.futures import ThreadPoolExecutor
 
 import tvm.tir
 
 from tvm.runtime import ndarray
 from tvm.ir import container
 from tvm.target import codegen, BuildConfig
-from tvm.tir import ir_pass
+from tvm.tir import ir_pass as _ir_pass
 from tvm.tir import Modes
 from tvm.tir.stmt import LoweredFunc
 from tvm.te import tensor
 from tvm.te import schedule
 from tvm import target as _target
+from . import build_cache
+from . import compile_profiler
+
+# The passes called through ir_pass are recorded by the compile
+# profiler in scope.
+ir_pass = compile_profiler.ProfiledPasses(_ir_pass, "pass")
 
 
 def get_binds(sch, args, compact=False, binds=None):
@@ -121,11 +128,12 @@ def form_body(sch, distinct_device, afuns_for):
     """
     cfg = BuildConfig.current()
     # normalize schedule first
-    sch = sch.normalize()
+    sch = compile_profiler.run("normalize", "schedule", sch.normalize)
     # print("[TVM] Made schedule")
-    bounds = schedule.InferBound(sch)
+    bounds = compile_profiler.run("InferBound", "schedule", schedule.InferBound, sch)
     # print("[TVM] Inferred bounds")
-    stmt = schedule.ScheduleOps(sch, bounds, False, distinct_device,
+    stmt = compile_profiler.run("ScheduleOps", "schedule", schedule.ScheduleOps,
+                                sch, bounds, False, distinct_device,
                                 cfg.fill_in_function_bodies, afuns_for)
     # print("[TVM] Lowered code")
     stmt = ir_pass.InjectPrefetch(stmt)
@@ -145,8 +153,9 @@ def lower(sch,
 
     Parameters
     ----------
-    sch : tvm.schedule.Schedule
-        The schedule to be built
+    sch : tvm.schedule.Schedule or tvm.te.SharedPrepCode
+        The schedule to be built, or the shared prep code whose
+        prelude is to be built
 
     args : list of Buffer or Tensor or Var
         The argument lists to the function.
@@ -195,22 +204,25 @@ def lower(sch,
     # Phase 0
     if isinstance(sch, schedule.Schedule):
         stmt = form_body(sch, target != "c" and target != "llvm", afuns_for)
+    elif isinstance(sch, schedule.SharedPrepCode):
+        stmt = sch.prelude()
     # exit(0)
 
     for f in lower_phase0:
-        stmt = f(stmt)
+        stmt = compile_profiler.run(None, "custom_pass", f, stmt)
 
     compact = ir_pass.VerifyCompactBuffer(stmt)
     binds, arg_list = get_binds(sch, args, compact, binds)
 
     # Phase 1
-    stmt = ir_pass.RewriteForTensorCore(stmt, sch, binds)
+    if isinstance(sch, schedule.Schedule):
+        stmt = ir_pass.RewriteForTensorCore(stmt, sch, binds)
     # if simple_mode: print(stmt)
     # exit(0)
     stmt = ir_pass.StorageFlatten(stmt, binds, 64, cfg.instrument_bound_checkers)
     # stmt = ir_pass.CanonicalSimplify(stmt)
     for f in lower_phase1:
-        stmt = f(stmt)
+        stmt = compile_profiler.run(None, "custom_pass", f, stmt)
 
     # print("[TVM] Phase 2")
 
@@ -218,6 +230,8 @@ def lower(sch,
     stmt = ir_pass.RemoveRedundantIfs(stmt, constraints)
     # if not simple_mode:
         # stmt = ir_pass.LoopPartition(stmt, cfg.partition_const_loop)
+    if not simple_mode and cfg.partition_ragged_loops:
+        stmt = ir_pass.RaggedLoopPartition(stmt)
 
     stmt = ir_pass.RemoveLikelyTags(stmt)
 
@@ -240,7 +254,7 @@ def lower(sch,
         cfg.auto_unroll_max_extent,
         cfg.unroll_explicit)
     for f in lower_phase2:
-        stmt = f(stmt)
+        stmt = compile_profiler.run(None, "custom_pass", f, stmt)
 
     # Phase 3
     stmt = ir_pass.Simplify(stmt)
@@ -248,7 +262,7 @@ def lower(sch,
     if not cfg.disable_select_rewriting:
         stmt = ir_pass.RewriteUnsafeSelect(stmt)
     for f in lower_phase3:
-        stmt = f(stmt)
+        stmt = compile_profiler.run(None, "custom_pass", f, stmt)
 
     # Instrument BoundCheckers
     if cfg.instrument_bound_checkers:
@@ -278,17 +292,46 @@ def lower(sch,
 
     # Remove duplicates
     arg_list = [list(dict.fromkeys(l)) for l in arg_list]
-    if cfg.prep_code_mode == "with_prep_code":
-        make_api_result = ir_pass.MakeAPIWithPrepCode(stmt, name, arg_list[0], arg_list[1], 0, cfg.restricted_func)
-    elif cfg.prep_code_mode == "no_prep_code":
-        make_api_result = ir_pass.MakeAPINoPrepCode(stmt, name, arg_list[0], arg_list[1], 0, cfg.restricted_func)
-    elif cfg.prep_code_mode == "only_prep_code":
-        make_api_result = ir_pass.MakeAPIOnlyPrepCode(stmt, name, arg_list[0], arg_list[1], 0, cfg.restricted_func)
+    prep_code_mode = cfg.prep_code_mode
+    if isinstance(sch, schedule.SharedPrepCode):
+        prep_code_mode = "only_prep_code"
+    if prep_code_mode == "with_prep_code":
+        make_api_result = ir_pass.MakeAPIWithPrepCode(stmt, name, arg_list[0], arg_list[1], 0, cfg.restricted_func,
+                                                      cfg.cache_prep_code)
+    elif prep_code_mode == "no_prep_code":
+        make_api_result = ir_pass.MakeAPINoPrepCode(stmt, name, arg_list[0], arg_list[1], 0, cfg.restricted_func,
+                                                    cfg.cache_prep_code)
+    elif prep_code_mode == "only_prep_code":
+        make_api_result = ir_pass.MakeAPIOnlyPrepCode(stmt, name, arg_list[0], arg_list[1], 0, cfg.restricted_func,
+                                                      cfg.cache_prep_code)
     else:
         raise ValueError("No such prep_code_mode: " + prep_code_mode)
 
     return make_api_result
 
+
+def _map_funcs(fmap, funcs):
+    """Apply fmap to each of funcs, on the parallel_build_threads threads
+    of the current build config. The results are in the order of funcs,
+    and do not depend on the number of threads."""
+    cfg = BuildConfig.current()
+    funcs = list(funcs)
+    if cfg.parallel_build_threads == 0 or len(funcs) <= 1 or cfg.dump_pass_ir:
+        return [fmap(func) for func in funcs]
+    # The build config and the target are thread local, the worker
+    # threads enter them again.
+    tgt = _target.Target.current(allow_none=True)
+    def run(func):
+        with cfg:
+            if tgt is None:
+                return fmap(func)
+            with tgt:
+                return fmap(func)
+    num_threads = cfg.parallel_build_threads if cfg.parallel_build_threads > 0 else None
+    with ThreadPoolExecutor(max_workers=num_threads) as pool:
+        return list(pool.map(run, funcs))
+
+
 def _build_for_device(flist, target, target_host, constraints=[],
                       cuda_syncs=None, substitute_after_hfuse=False,
                       substitutes=None):
@@ -316,16 +359,17 @@ def _build_for_device(flist, target, target_host, constraints=[],
     """
     target = _target.create(target)
     device_type = ndarray.context(target.target_name, 0).device_type
-    fhost = []
-    fdevice = []
-    for func in flist:
+    cfg = BuildConfig.current()
+    cuda_syncs = "" if cuda_syncs == None else cuda_syncs
+
+    def split_func(func):
         if not ir_pass.VerifyMemory(func, device_type):
             raise ValueError(
                 "Direct host side access to device memory is detected in %s. "
                 "Did you forget to bind?" % func.name)
 
         if func.func_type == LoweredFunc.MixedFunc:
-            if BuildConfig.current().detect_global_barrier:
+            if cfg.detect_global_barrier:
                 func = ir_pass.ThreadSync(func, "global", target.target_name)
                 # print(func.body)
             func = ir_pass.ThreadSync(func, "shared", target.target_name)
@@ -335,7 +379,6 @@ def _build_for_device(flist, target, target_host, constraints=[],
             warp_size = target.thread_warp_size
             func = ir_pass.LowerThreadAllreduce(func, warp_size, target.target_name)
             func = ir_pass.PeelLoop(func)
-            cuda_syncs = "" if cuda_syncs == None else cuda_syncs
             ############################################################
             func = ir_pass.RemoveProducerConsumerNodes(func)
             func = ir_pass.BetterHoistIfThenElse(func, target.target_name, constraints)
@@ -349,54 +392,54 @@ def _build_for_device(flist, target, target_host, constraints=[],
             # exit(0)
             ############################################################
             fsplits = list(ir_pass.SplitHostDevice(func, cuda_syncs))
-            fhost.append(fsplits[0])
-            for x in fsplits[1:]:
-                fdevice.append(x)
-        elif func.func_type == LoweredFunc.HostFunc:
-            fhost.append(func)
-        elif func.func_type == LoweredFunc.DeviceFunc:
-            fdevice.append(func)
-        else:
-            raise ValueError("unknown function type %d" % func.func_type)
+            return fsplits[:1], fsplits[1:]
+        if func.func_type == LoweredFunc.HostFunc:
+            return [func], []
+        if func.func_type == LoweredFunc.DeviceFunc:
+            return [], [func]
+        raise ValueError("unknown function type %d" % func.func_type)
 
-    for i, func in enumerate(fdevice):
-        warp_size = target.thread_warp_size
-        fdevice[i] = ir_pass.LowerWarpMemory(func, warp_size)
+    fhost = []
+    fdevice = []
+    for fsplit_host, fsplit_device in _map_funcs(split_func, flist):
+        fhost += fsplit_host
+        fdevice += fsplit_device
 
     if "gpu" in target.keys and not fdevice:
         warnings.warn(
             "Specified target %s, but cannot find device code, did you do "
             "bind?" % target)
 
-    fhost = [ir_pass.BindDeviceType(x, device_type) for x in fhost]
-    fhost = [ir_pass.LowerTVMBuiltin(x) for x in fhost]
-
     if device_type == ndarray.cpu(0).device_type and target_host == target:
         assert not fdevice
 
     target_host = _target.create(target_host)
-    fdevice = [ir_pass.LowerDeviceStorageAccessInfo(x) for x in fdevice]
-    fhost = [ir_pass.LowerDeviceStorageAccessInfo(x) for x in fhost]
-    # print("# DEVICE ##############################\n", fdevice[0].body)
-    fdevice = [ir_pass.LowerIntrin(x, target.target_name) for x in fdevice]
-    # print("# DEVICE ##############################\n", fdevice[0].body)
-    # exit(0)
-    fhost = [ir_pass.LowerIntrin(x, target_host.target_name) for x in fhost]
-    fhost = [ir_pass.CombineContextCall(x) for x in fhost]
 
-    # fdevice = [ir_pass.BetterHoistIfThenElse(x, target.target_name, constraints) for x in fdevice]
-    # if len(fdevice) == 0:
-        # fhost = [ir_pass.BetterHoistIfThenElse(x, target.target_name, constraints) for x in fhost]
-    # print("# DEVICE ##############################\n", fdevice[0].body)
-    # exit(0)
-    cfg = BuildConfig.current()
-    if cfg.hoist_loads:
-        # print('Hoisting')
-        fdevice = [ir_pass.HoistLoads(x) for x in fdevice]
+    def lower_host_func(func):
+        func = ir_pass.BindDeviceType(func, device_type)
+        func = ir_pass.LowerTVMBuiltin(func)
+        func = ir_pass.LowerDeviceStorageAccessInfo(func)
+        func = ir_pass.LowerIntrin(func, target_host.target_name)
+        return ir_pass.CombineContextCall(func)
+
+    def lower_device_func(func):
+        func = ir_pass.LowerWarpMemory(func, target.thread_warp_size)
+        func = ir_pass.LowerDeviceStorageAccessInfo(func)
+        # print("# DEVICE ##############################\n", func.body)
+        func = ir_pass.LowerIntrin(func, target.target_name)
+        # func = ir_pass.BetterHoistIfThenElse(func, target.target_name, constraints)
+        if cfg.hoist_loads:
+            # print('Hoisting')
+            func = ir_pass.HoistLoads(func)
+        return func
+
+    fhost = _map_funcs(lower_host_func, fhost)
+    fdevice = _map_funcs(lower_device_func, fdevice)
     # print("# HOST ##############################\n", fhost[0].body)
     # print("# DEVICE ##############################\n", fdevice[0].body)
     # exit(0)
-    mdev = codegen.build_module(fdevice, str(target)) if fdevice else None
+    mdev = compile_profiler.run("codegen.device", "codegen", codegen.build_module,
+                                fdevice, str(target)) if fdevice else None
 
     return fhost, mdev
 
@@ -480,9 +523,12 @@ def build(inputs,
     Note
     ----
     See the note on :any:`tvm.target` on target string format.
+
+    With the build config option build_cache_dir set, the compiled
+    module is cached on disk, see :any:`tvm.driver.build_cache`.
     """
     intermediate_buffers = None
-    if isinstance(inputs, schedule.Schedule):
+    if isinstance(inputs, (schedule.Schedule, schedule.SharedPrepCode)):
         if args is None:
             raise ValueError("args must be given for build from schedule")
         make_api_result = lower(inputs, args, target,
@@ -540,6 +586,18 @@ def build(inputs,
     if not target_host:
         target_host = "llvm" if tvm.runtime.enabled("llvm") else "stackvm"
 
+    cache_dir = BuildConfig.current().build_cache_dir
+    cache_key = None
+    if cache_dir:
+        build_args = {"constraints": constraints, "cuda_syncs": cuda_syncs,
+                      "substitutes": substitutes,
+                      "substitute_after_hfuse": substitute_after_hfuse}
+        cache_key = build_cache.cache_key(target_flist, target_host, build_args)
+    if cache_key:
+        mhost = build_cache.load(cache_dir, cache_key)
+        if mhost is not None:
+            return mhost, intermediate_buffers
+
     fhost_all = []
     device_modules = []
     for tar, flist in target_flist.items():
@@ -553,10 +611,14 @@ def build(inputs,
         device_modules.append(mdev)
 
     # Generate a unified host module.
-    mhost = codegen.build_module(fhost_all, str(target_host))
+    mhost = compile_profiler.run("codegen.host", "codegen", codegen.build_module,
+                                 fhost_all, str(target_host))
 
     # Import all modules.
     for mdev in device_modules:
         if mdev:
             mhost.import_module(mdev)
+
+    if cache_key:
+        build_cache.save(cache_dir, cache_key, mhost)
     return mhost, intermediate_buffers
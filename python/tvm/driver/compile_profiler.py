@@ -0,0 +1,200 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Profiling of the compile time of lower and build.
+
+How to use:
+
+.. code-block:: python
+
+    with tvm.driver.CompileProfiler() as prof:
+        tvm.build(s, args, "llvm")
+    print(prof.summary())
+    prof.export_chrome_trace("compile.json")
+
+Every pass run by lower and build, and the phases of forming the
+body of a schedule (InferBound, ScheduleOps and its steps such as
+the generation of the A functions), is recorded with its wall time,
+the number of rewrite and canonical simplifier calls and Z3 queries
+it made and, for passes, the number of IR nodes before and after it.
+The trace can be opened in chrome://tracing or Perfetto.
+
+The counters are per thread, so that the phases run concurrently by
+a parallel build, see the parallel_build_threads build config
+option, only count their own calls.
+"""
+import json
+import os
+
+from tvm.ir import container
+from tvm.tir import Stmt
+from tvm.tir import ir_pass as _ir_pass
+from tvm.tir.stmt import LoweredFunc
+from . import _ffi_api
+
+# In the order of support::CompileCounter
+COUNTERS = ("rewrite_simplify", "canonical_simplify", "z3_queries", "z3_solver_checks")
+
+
+def _count_nodes(obj):
+    if isinstance(obj, Stmt):
+        return _ir_pass.CountNodes(obj)
+    if isinstance(obj, LoweredFunc):
+        return _ir_pass.CountNodes(obj.body)
+    if isinstance(obj, (list, tuple, container.Array)):
+        counts = [_count_nodes(x) for x in obj]
+        if counts and all(c is not None for c in counts):
+            return sum(counts)
+    return None
+
+
+class CompileProfiler(object):
+    """Record the phases of the compilations run in its scope.
+
+    Parameters
+    ----------
+    count_nodes : bool
+        Whether to count the IR nodes before and after each pass.
+        Counting walks the whole IR, which is not included in the
+        recorded times but slows down the compilation.
+    """
+    _stack = []
+
+    def __init__(self, count_nodes=True):
+        self.count_nodes = count_nodes
+        self.events = []
+        self._start_us = None
+
+    @staticmethod
+    def current():
+        """The innermost profiler in scope, None if there is none."""
+        return CompileProfiler._stack[-1] if CompileProfiler._stack else None
+
+    def __enter__(self):
+        if not CompileProfiler._stack:
+            _ffi_api.CompileProfilerTakeEvents()
+            _ffi_api.CompileProfilerSetEnabled(True)
+        self._start_us = _ffi_api.CompileProfilerSnapshot()[0].value
+        CompileProfiler._stack.append(self)
+        return self
+
+    def __exit__(self, ptype, value, trace):
+        _take_native_events()
+        CompileProfiler._stack.pop()
+        if not CompileProfiler._stack:
+            _ffi_api.CompileProfilerSetEnabled(False)
+
+    def summary(self):
+        """Tabulate the total time and counters of the phases per
+        name, by decreasing total time.
+
+        Returns
+        -------
+        summary : str
+        """
+        rows = {}
+        for ev in self.events:
+            row = rows.setdefault(ev["name"], [0, 0] + [0] * len(COUNTERS))
+            row[0] += 1
+            row[1] += ev["dur"]
+            for i, name in enumerate(COUNTERS):
+                row[2 + i] += ev["args"][name]
+        header = "%-48s %6s %12s" % ("phase", "calls", "time (ms)")
+        header += "".join(" %18s" % name for name in COUNTERS)
+        lines = [header, "-" * len(header)]
+        for name, row in sorted(rows.items(), key=lambda kv: -kv[1][1]):
+            line = "%-48s %6d %12.3f" % (name, row[0], row[1] / 1000.0)
+            line += "".join(" %18d" % c for c in row[2:])
+            lines.append(line)
+        return "\n".join(lines)
+
+    def chrome_trace(self):
+        """The recorded phases in the Chrome trace event format.
+
+        Returns
+        -------
+        trace : dict
+        """
+        pid = os.getpid()
+        events = []
+        for ev in sorted(self.events, key=lambda e: (e["ts"], -e["dur"])):
+            ev = dict(ev, ph="X", pid=pid)
+            ev["ts"] -= self._start_us
+            events.append(ev)
+        return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+    def export_chrome_trace(self, path):
+        """Write the recorded phases to path as a Chrome trace JSON."""
+        with open(path, "w") as f:
+            json.dump(self.chrome_trace(), f)
+
+
+def _make_event(name, category, start, end, args):
+    args = dict(args)
+    for i, counter in enumerate(COUNTERS):
+        args[counter] = end[2 + i].value - start[2 + i].value
+    return {"name": name, "cat": category, "ts": start[0].value,
+            "dur": end[0].value - start[0].value, "tid": start[1].value, "args": args}
+
+
+def _record(event):
+    for prof in CompileProfiler._stack:
+        prof.events.append(event)
+
+
+def _take_native_events():
+    for entry in _ffi_api.CompileProfilerTakeEvents():
+        counters = {name: entry[4 + i].value for i, name in enumerate(COUNTERS)}
+        _record({"name": entry[0].value, "cat": "native", "ts": entry[1].value,
+                 "dur": entry[2].value, "tid": entry[3].value, "args": counters})
+
+
+def run(name, category, func, *args):
+    """Call func(*args), recording the call as a phase named name, or
+    after func if name is None, if a profiler is in scope."""
+    prof = CompileProfiler.current()
+    if prof is None:
+        return func(*args)
+    if name is None:
+        name = getattr(func, "__name__", type(func).__name__)
+    extra = {}
+    if prof.count_nodes and args:
+        nodes = _count_nodes(args[0])
+        if nodes is not None:
+            extra["nodes_before"] = nodes
+    start = _ffi_api.CompileProfilerSnapshot()
+    ret = func(*args)
+    end = _ffi_api.CompileProfilerSnapshot()
+    if prof.count_nodes:
+        nodes = _count_nodes(ret)
+        if nodes is not None:
+            extra["nodes_after"] = nodes
+    _record(_make_event(name, category, start, end, extra))
+    return ret
+
+
+class ProfiledPasses(object):
+    """View of a namespace of passes, such as tvm.tir.ir_pass, whose
+    calls are recorded by the profiler in scope."""
+    def __init__(self, namespace, category):
+        self._namespace = namespace
+        self._category = category
+
+    def __getattr__(self, name):
+        func = getattr(self._namespace, name)
+        if CompileProfiler.current() is None or not callable(func):
+            return func
+        return lambda *args: run(name, self._category, func, *args)
@@ -21,6 +21,7 @@ from .packed_func import PackedFunc
 from .object import Object
 from .object_generic import ObjectGeneric, ObjectTypes
 from .ndarray import NDArray, DataType, TypeCode, TVMContext
+from .ragged_ndarray import RaggedNDArray
 from .module import Module, set_cuda_grid_sync_on, get_max_mem_consumption
 
 # function exposures
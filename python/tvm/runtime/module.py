@@ -37,6 +37,14 @@ def get_max_mem_consumption():
 def set_mem_prof(value):
     return _ffi_api.SetMemProfiling(value)
 
+def get_prep_code_cache_stats():
+    """Return the (hits, misses) of the prep code cache used by
+    functions built with cache_prep_code"""
+    return _ffi_api.PrepCodeCacheHits(), _ffi_api.PrepCodeCacheMisses()
+
+def clear_prep_code_cache():
+    _ffi_api.PrepCodeCacheClear()
+
 # profile result of time evaluator
 ProfileResult = namedtuple("ProfileResult", ["mean", "results"])
 
@@ -0,0 +1,168 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Ragged tensor container of TVM runtime."""
+import numpy as np
+import tvm._ffi
+
+from tvm.runtime import Object
+from . import _ffi_api
+from . import ndarray as _nd
+
+
+@tvm._ffi.register_object("runtime.RaggedNDArray")
+class RaggedNDArray(Object):
+    """A tensor of dense shape (batch, max_len, ...) whose second
+    dimension is ragged, stored row after row in a flat array.
+
+    Use :any:`ragged_ndarray_empty` or :any:`from_padded` to
+    create one.
+    """
+    @property
+    def data(self):
+        """The flat storage, to be passed to kernels as the tensor."""
+        return _ffi_api.RaggedNDArrayData(self)
+
+    @property
+    def lengths(self):
+        """The int32 row lengths, to be passed to kernels as the
+        length argument. This is a copy of the lengths the array was
+        created with, and should not be modified."""
+        return _ffi_api.RaggedNDArrayLengths(self)
+
+    @property
+    def shape(self):
+        """The dense shape of the array."""
+        return tuple(_ffi_api.RaggedNDArrayShape(self, i)
+                     for i in range(_ffi_api.RaggedNDArrayNDim(self)))
+
+    @property
+    def dtype(self):
+        return self.data.dtype
+
+    def row_offset(self, i):
+        """Offset, in inner slices, of the start of row i."""
+        return _ffi_api.RaggedNDArrayRowOffset(self, i)
+
+    def row(self, i):
+        """A view of row i, sharing memory with this array.
+
+        Returns
+        -------
+        row : tvm.nd.NDArray
+            The array of shape (lengths[i], ...).
+        """
+        return _ffi_api.RaggedNDArrayRow(self, i)
+
+    def to_padded(self):
+        """Unpack into a zero padded array of the dense shape on the CPU.
+
+        Returns
+        -------
+        padded : tvm.nd.NDArray
+        """
+        return _ffi_api.RaggedNDArrayToPadded(self)
+
+    def asnumpy(self):
+        return self.to_padded().asnumpy()
+
+
+def _to_lengths(lengths):
+    if isinstance(lengths, _nd.NDArray):
+        return lengths
+    return _nd.array(np.asarray(lengths, dtype="int32"), _nd.cpu(0))
+
+
+def ragged_ndarray_empty(shape, lengths, dtype="float32", ctx=_nd.cpu(0)):
+    """Create an uninitialized ragged array.
+
+    Parameters
+    ----------
+    shape : tuple of int
+        The dense shape of the array.
+
+    lengths : list of int, numpy.ndarray or tvm.nd.NDArray
+        The length of each row.
+
+    dtype : str
+        The data type of the array.
+
+    ctx : TVMContext
+        The context the data is allocated on.
+
+    Returns
+    -------
+    arr : RaggedNDArray
+    """
+    return _ffi_api.RaggedNDArrayEmpty(_to_lengths(lengths), dtype, ctx.device_type,
+                                       ctx.device_id, *shape)
+
+
+def from_padded(padded, lengths, ctx=_nd.cpu(0)):
+    """Pack a padded array into a ragged array.
+
+    Parameters
+    ----------
+    padded : numpy.ndarray or tvm.nd.NDArray
+        The padded array, of the dense shape.
+
+    lengths : list of int, numpy.ndarray or tvm.nd.NDArray
+        The length of each row.
+
+    ctx : TVMContext
+        The context the packed data is allocated on.
+
+    Returns
+    -------
+    arr : RaggedNDArray
+    """
+    if not isinstance(padded, _nd.NDArray):
+        padded = _nd.array(np.ascontiguousarray(padded), _nd.cpu(0))
+    return _ffi_api.RaggedNDArrayFromPadded(padded, _to_lengths(lengths),
+                                            ctx.device_type, ctx.device_id)
+
+
+def kernel_args(tensors, intermediate_args=()):
+    """Create the argument list of a kernel built from a ragged
+    schedule: the tensors, followed by the lengths of the ragged
+    tensors and the intermediate buffers. Ragged tensors with equal
+    lengths share a single length argument.
+
+    Parameters
+    ----------
+    tensors : list of RaggedNDArray or tvm.nd.NDArray
+        The tensor arguments, in the order of the kernel.
+
+    intermediate_args : list of tvm.nd.NDArray
+        The host and device intermediate buffers.
+
+    Returns
+    -------
+    args : list of tvm.nd.NDArray
+    """
+    args = []
+    lengths = []
+    for t in tensors:
+        if isinstance(t, RaggedNDArray):
+            args.append(t.data)
+            # Each array holds its own copy of the lengths, so compare
+            # them by value.
+            lens_np = t.lengths.asnumpy()
+            if not any(np.array_equal(lens_np, l_np) for _, l_np in lengths):
+                lengths.append((t.lengths, lens_np))
+        else:
+            args.append(t)
+    return args + [l for l, _ in lengths] + list(intermediate_args)
@@ -138,7 +138,18 @@ class BuildConfig(Object):
         # Ragged options
         "prep_code_mode": "with_prep_code",
         "fill_in_function_bodies": True,
-        "hoist_loads": False
+        "hoist_loads": False,
+        "partition_ragged_loops": True,
+        "cache_prep_code": False,
+        "z3_query_timeout_ms": 500,
+        "z3_pass_timeout_ms": 0,
+        "z3_pass_max_solver_checks": 0,
+        "ragged_vector_lanes": 0,
+        "incremental_fused_lookups": False,
+        "compact_fusion_buffers": False,
+        "narrow_aux_buffers": False,
+        "build_cache_dir": "",
+        "parallel_build_threads": 0
     }
     _dump_ir = DumpIR()
 
@@ -23,7 +23,8 @@ from tvm.tir import trunc, abs, round, nearbyint, isnan, power, popcount, fmod,
 from tvm.tir import div, indexdiv, indexmod, truncdiv, truncmod, floordiv, floormod
 from tvm.tir import comm_reducer, min, max, sum
 
-from .schedule import Schedule, create_schedule, fuse_ragged_axis
+from .schedule import Schedule, SharedPrepCode, create_schedule, fuse_ragged_axis
+from .schedule import bin_pack_split_points
 from .tensor import Tensor
 from .tensor_intrin import decl_tensor_intrin
 from .tag import tag_scope
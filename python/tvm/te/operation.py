@@ -111,10 +111,14 @@ def create_or_return_uf(expr):
 
 
 def ragged_placeholder(dense_shape, dimensions, loop_extent_ufs, dtype=None,
-                       name="placeholder", width_ufs=None, aggregate_ufs={}):
+                       name="placeholder", width_ufs=None, aggregate_ufs={}, bucket_sizes=None):
     layout = None
     if width_ufs is not None:
-        layout = Modes.storage_layout(dimensions, dense_shape, width_ufs, aggregate_ufs)
+        if bucket_sizes is not None:
+            layout = Modes.padded_storage_layout(dimensions, dense_shape, width_ufs,
+                                                 bucket_sizes, aggregate_ufs)
+        else:
+            layout = Modes.storage_layout(dimensions, dense_shape, width_ufs, aggregate_ufs)
 
     if isinstance(loop_extent_ufs, LFunsWrapper): loop_extent_ufs = loop_extent_ufs.get_ufs()
     ret = indirect_placeholder_integrated(dense_shape, dimensions, list(zip(dimensions, loop_extent_ufs)),
@@ -235,14 +239,20 @@ def compute(shape, fcompute, name="compute", tag="", attrs=None):
 
 
 def ragged_compute(dense_shape, dimensions, loop_extent_ufs, fcompute, reduce_axis_ufs=None, fpred=None, name="compute",
-                   tag="", attrs=None, loop_aggregate_ufs=None, width_uf_lists=None, aggregate_uf_lists=None, num_outputs=1):
+                   tag="", attrs=None, loop_aggregate_ufs=None, width_uf_lists=None, aggregate_uf_lists=None, num_outputs=1,
+                   bucket_sizes=None):
     storage_layouts = None
     if width_uf_lists is not None:
         if width_uf_lists is None: width_uf_lists = [[]] * num_outputs
         if aggregate_uf_lists is None: aggregate_uf_lists = [{}] * num_outputs
         # storage_layouts = [Modes(dimensions, dense_shape, width_ufs, aggregate_ufs) for width_ufs,
-        storage_layouts = [Modes.storage_layout(dimensions, dense_shape, width_ufs, aggregate_ufs) for width_ufs,
-                   aggregate_ufs in zip(width_uf_lists, aggregate_uf_lists)]
+        if bucket_sizes is not None:
+            storage_layouts = [Modes.padded_storage_layout(dimensions, dense_shape, width_ufs,
+                                                           bucket_sizes, aggregate_ufs)
+                               for width_ufs, aggregate_ufs in zip(width_uf_lists, aggregate_uf_lists)]
+        else:
+            storage_layouts = [Modes.storage_layout(dimensions, dense_shape, width_ufs, aggregate_ufs) for width_ufs,
+                       aggregate_ufs in zip(width_uf_lists, aggregate_uf_lists)]
 
     mode_loop_extent_ufs = []
     mode_loop_min_ufs = []
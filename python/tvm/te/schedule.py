@@ -46,6 +46,28 @@ def fuse_ragged_axis(input_tensors, output_tensor, outer_dim, inner_dim, fused_d
     # output_tensor = output_tensor.op
     return _ffi_api.FuseRaggedAxis(input_tensors, output_tensor, outer_dim, inner_dim, fused_dim, fused_extent)
 
+def bin_pack_split_points(l_fun, tile_factors):
+    """Create split points for :any:`Schedule.split_for_bin_packing`
+    that split a loop of extent l_fun into tiers of whole tiles of each
+    tile factor, followed by a remainder tier. For instance, tile
+    factors (64, 32) make a tier of full 64 wide tiles, one of a 32
+    wide tile and one for the remainder. Loops split by the tile factor
+    of their tier then need no tail.
+
+    Parameters
+    ----------
+    l_fun : UninterpFun
+        The extent of the loop to split.
+
+    tile_factors : list of int
+        Decreasing tile factors, each dividing the previous one.
+
+    Returns
+    -------
+    split_points : list of UninterpFun
+    """
+    return list(_ffi_api.BinPackSplitPoints(l_fun, tile_factors))
+
 def create_schedule(ops):
     """Create a schedule for list of ops
 
@@ -226,12 +248,57 @@ class Schedule(Object):
         return _ffi_api.ScheduleCacheRead(self, tensor, scope, readers, suffix, vanilla,
                                           layouts, loop_layout, axis_mirror_loop_layout)
 
-    def single_kernel(self, inputs, outputs, threads, name, tag="", attrs=None, include_inputs=False):
+    def single_kernel(self, inputs, outputs, threads, name, tag="", attrs=None, include_inputs=False,
+                      persistent=False, chunk=1):
+        """Merge the ops computing outputs from inputs into one kernel
+        over the env threads threads.
+
+        Parameters
+        ----------
+        persistent : bool
+            On CPU targets, run the outermost thread range with
+            persistent workers: the threads of the pool claim chunks
+            of it from a shared counter until it is exhausted, so that
+            the load balance does not depend on the launch geometry.
+            Inner thread ranges are run serially by the worker of the
+            enclosing chunk. Ignored, with a warning, on other targets.
+
+        chunk : int
+            The number of indices of the outermost thread range a
+            persistent worker claims at a time. Must be positive.
+        """
         op = _ffi_api.ScheduleSingleKernel(self, name, tag, attrs, inputs, outputs, include_inputs, threads)
+        if persistent:
+            self[op].pragma(threads[0], "parallel_dynamic", chunk)
         res = [op.output(i) for i in range(len(outputs))]
         return res[0] if len(res) == 1 else res
 
     def split_for_bin_packing(self, inputs, output, to_split, include_inputs=True):
+        """Split loops of the subgraph computing output into tiers.
+
+        Parameters
+        ----------
+        inputs : list of Tensor
+            The inputs of the subgraph.
+
+        output : Tensor
+            The output of the subgraph.
+
+        to_split : dict of IterVar to UninterpFun or list of UninterpFun
+            The split point, or increasing split points, of each axis of
+            output to split. K split points make K + 1 tiers. See
+            :any:`bin_pack_split_points`.
+
+        include_inputs : bool
+            Whether to include the inputs in the subgraph.
+
+        Returns
+        -------
+        tiers : list of list of Tensor
+            The outputs of the ops of each tier.
+        """
+        to_split = {iv: [p] if isinstance(p, UninterpFun) else list(p)
+                    for iv, p in to_split.items()}
         graphs = _ffi_api.SplitForBinPacking(self, inputs, output, to_split, include_inputs)
         return [[o.output(0) for o in ops] for ops in graphs]
 
@@ -404,10 +471,64 @@ class Schedule(Object):
 
 
     def hfuse(self, fuse_tuples):
+        """Horizontally fuse the outermost loops of independent
+        operations into one loop over their concatenated extents.
+
+        The loops should either all be bound to the same thread axis,
+        or, on CPU targets, all be parallel loops. In the latter case,
+        the operations share a single parallel launch.
+
+        Parameters
+        ----------
+        fuse_tuples : list of (Operation, IterVar)
+            The operations and their outermost leaf iter vars.
+        """
         ops, ivs = list(zip(*fuse_tuples))
-        print(ops, ivs)
         _ffi_api.ScheduleHFuse(self, list(ops), list(ivs))
 
+    def parallel_prep_code(self, num_blocks=64):
+        """Generate the prefix sums in the prep code as parallel
+        blocked scans.
+
+        Parameters
+        ----------
+        num_blocks : int
+            The number of blocks each scan is split into. Zero
+            restores the serial lowering.
+        """
+        _ffi_api.ScheduleParallelPrepCode(self, num_blocks)
+
+    def share_prep_code(self, shared_prep_code):
+        """Generate the a_funs and fusion functions of this schedule
+        into the prelude of shared_prep_code instead of into its own
+        prep code.
+
+        Parameters
+        ----------
+        shared_prep_code : SharedPrepCode
+            The prep code shared by all the kernels of the model.
+        """
+        _ffi_api.ScheduleSharePrepCode(self, shared_prep_code)
+
+
+@tvm._ffi.register_object("te.SharedPrepCode")
+class SharedPrepCode(Object):
+    """Prep code shared between all the kernels of a model.
+
+    Identical a_funs and fusion functions of the schedules sharing it
+    are only computed once, by a single prelude. Build the prelude
+    with tvm.build(shared_prep_code, [lengths, []], ...) after all
+    the kernels have been lowered, and pass the aux buffers it fills
+    to each of the kernels.
+    """
+    def __init__(self):
+        self.__init_handle_by_constructor__(_ffi_api.SharedPrepCode)
+
+    def prelude(self):
+        """Return the prep code filling the shared aux buffers for
+        all the kernels lowered so far."""
+        return _ffi_api.SharedPrepCodePrelude(self)
+
 @tvm._ffi.register_object
 class Stage(Object):
     """A Stage represents schedule for one operation."""
@@ -704,6 +825,44 @@ class Stage(Object):
         """
         _ffi_api.StageParallel(self, var)
 
+    def balanced_parallel(self, var):
+        """Parallelize a ragged outer loop, splitting its iterations
+        between the threads by equal cumulative work instead of equal
+        iteration count.
+
+        The work of each iteration is read off the prefix sum (a_fun)
+        of the ragged dimensions depending on the loop, with a binary
+        search at launch time, so that rows of uneven lengths are
+        balanced without the synchronization of the parallel_dynamic
+        pragma.
+
+        Parameters
+        ----------
+        var : IterVar
+            The root iteration to be parallelized. A ragged dimension
+            of the output should depend on it.
+        """
+        _ffi_api.StageBalancedParallel(self, var)
+
+    def sort_by_length(self, var):
+        """Iterate a ragged outer loop in decreasing order of the
+        lengths of the rows it indexes, the longest processing time
+        first order. The length of a row is the extent of the first
+        ragged dimension depending on the loop. Neighbouring threads
+        and vector lanes then get rows of similar lengths.
+
+        The permutation is computed by a counting sort in the prep
+        code, next to the a_funs. The storage order is unchanged.
+
+        Parameters
+        ----------
+        var : IterVar
+            The root iteration to be sorted. It should not have been
+            split or fused, its extent should be constant and a ragged
+            dimension should depend on it.
+        """
+        _ffi_api.StageSortByLength(self, var)
+
     def pragma(self, var, pragma_type, pragma_value=None):
         """Annotate the iteration with pragma
 
@@ -751,6 +910,14 @@ class Stage(Object):
           Hint parallel loop to execute in strided pattern.
           :code:`for (int i = task_id; i < end; i += num_task)`
 
+        - **parallel_dynamic**
+
+          Schedule the parallel loop dynamically on the CPU: the
+          working threads claim chunks of pragma_value iterations
+          from a shared counter until the loop is exhausted. This
+          balances loops whose iterations have uneven costs, such as
+          loops over the rows of a ragged tensor.
+
         """
         if isinstance(pragma_value, string_types):
             pragma_value = convert(pragma_value)
@@ -791,18 +958,24 @@ class Stage(Object):
         _ffi_api.StageStorageAlign(self, axis, factor, offset)
 
     def storage_align_dim(self, dim_idx, factor, offset):
-        """Set alignment requirement for specific axis
+        """Set alignment requirement for specific tensor dimension
 
-        This ensures that stride[axis] == k * factor + offset for some k.
-        This is useful to set memory layout to for more friendly memory
-        access pattern. For example, we can set alignment to be
-        factor=2, offset=1 to avoid bank conflict for thread access on
-        higher dimension in GPU shared memory.
+        For a dense dimension, this ensures that stride[dim_idx] == k *
+        factor + offset for some k, as storage_align does for an axis.
+
+        For a ragged dimension, this instead ensures that each row of
+        the dimension, ie. its slice for a fixed value of the outer
+        dimension its length depends on, starts at a multiple of
+        factor elements. The length of the dimension is padded in the
+        storage layout, so that aligned vector loads of the rows are
+        legal, while the loops still iterate over the exact lengths.
+        The dimensions inside the row should be dense and offset
+        should be 0.
 
         Parameters
         ----------
-        axis : IterVar
-            The axis dimension to be aligned.
+        dim_idx : int
+            The index of the leaf tensor dimension to be aligned.
         factor : int
             The factor in alignment specification.
         offset : int
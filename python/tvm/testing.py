@@ -18,6 +18,9 @@
 import logging
 import numpy as np
 import tvm._ffi
+from tvm import te
+from tvm.runtime import ndarray as nd
+from tvm.tir import UninterpFun as Uf
 
 
 def assert_allclose(actual, desired, rtol=1e-7, atol=1e-7):
@@ -165,4 +168,103 @@ def check_numerical_grads(function, input_values, grad_values, function_value=No
                      x_name, grad.shape, dist, max_diff, avg_diff)
 
 
+def ragged_elementwise(fcompute, batch_size, max_len, hidden, lens=None, name="O",
+                       bucket_size=1):
+    """Declare O[b, s, h] = fcompute(A[b, s, h]) over a ragged sequence
+    dimension s of lengths lens[b], the usual operator of the tests and
+    benchmarks of ragged schedules.
+
+    Parameters
+    ----------
+    fcompute : function
+        The function of an element of A computing the element of O.
+
+    batch_size : int
+        The extent of the batch dimension.
+
+    max_len : int
+        The dense extent of the ragged dimension.
+
+    hidden : int
+        The extent of the innermost dimension.
+
+    lens : Tensor, optional
+        The int32 placeholder of the lengths, created if None.
+
+    name : str, optional
+        The name of O.
+
+    bucket_size : int, optional
+        With a bucket_size larger than 1, the loops iterate over the
+        lengths padded up to a multiple of bucket_size, and the tensors
+        are stored padded the same way.
+
+    Returns
+    -------
+    lens, A, O : tuple of Tensor
+    """
+    bd = te.RangeDimension("bd")
+    s1 = te.RangeDimension("s1")
+    md = te.RangeDimension("md")
+    if lens is None:
+        lens = te.placeholder((batch_size,), name="lens", dtype="int32")
+    ufs = [Uf.from_constant("bd", batch_size, "l"),
+           Uf("s1", "l", (1, max_len), [bd], lambda b: lens[b]),
+           Uf.from_constant("md", hidden, "l")]
+    # The padded storage layouts pad the width ufs themselves
+    loop_ufs = list(ufs)
+    bucket_sizes = None
+    if bucket_size > 1:
+        loop_ufs[1] = Uf.padded(ufs[1], bucket_size)
+        bucket_sizes = [1, bucket_size, 1]
+    shape = (batch_size, max_len, hidden)
+    A = te.ragged_placeholder(shape, [bd, s1, md], loop_ufs, name="A", width_ufs=ufs,
+                              bucket_sizes=bucket_sizes)
+    O = te.ragged_compute(shape, [bd, s1, md], loop_ufs,
+                          lambda ds: fcompute(A[ds[bd], ds[s1], ds[md]]),
+                          name=name, width_uf_lists=[ufs], bucket_sizes=bucket_sizes)
+    return lens, A, O
+
+
+def ragged_buffer_shape(buf):
+    """The constant dense shape of an intermediate buffer of a module
+    built from a ragged schedule."""
+    return [int(tvm.tir.ir_pass.Simplify(e)) for e in buf.shape.dense_shape()]
+
+
+def ragged_aux_args(intermediate_buffers, known=(), ctx=None):
+    """Allocate the intermediate (aux) buffer arguments of a module
+    built from a ragged schedule.
+
+    Parameters
+    ----------
+    intermediate_buffers : tuple of list of Buffer
+        The host and device intermediate buffers returned by build.
+
+    known : list of (Buffer, NDArray), optional
+        Arrays to reuse for the buffers with the same data.
+
+    ctx : TVMContext, optional
+        The context of the device buffers, the CPU by default. Host
+        buffers are always allocated on the CPU.
+
+    Returns
+    -------
+    args : list of NDArray
+        The host arguments followed by the device ones. Buffers with
+        the same data share an array.
+    """
+    ctx = ctx or nd.cpu(0)
+    host_bufs, dev_bufs = intermediate_buffers
+    known = list(known)
+    args = []
+    for buf, buf_ctx in ([(b, nd.cpu(0)) for b in host_bufs] + [(b, ctx) for b in dev_bufs]):
+        same = [arr for b, arr in known if b.data.same_as(buf.data)]
+        if not same:
+            same = [nd.empty(ragged_buffer_shape(buf), buf.dtype, buf_ctx)]
+            known.append((buf, same[0]))
+        args.append(same[0])
+    return args
+
+
 tvm._ffi._init_api("testing", __name__)
@@ -381,6 +381,16 @@ class UninterpFun(Object):
     def from_constant(name, const, typ):
         return UninterpFun(name, typ, (const, const), [], lambda: const)
 
+    @staticmethod
+    def padded(uf, bucket_size):
+        """An l_fun rounding the value of uf up to a multiple of bucket_size."""
+        return _ffi_api.UninterpFunPadded(uf, bucket_size)
+
+    @staticmethod
+    def closed_form_prefix_sum(var, weight, n):
+        """The closed form of sum_{var < n} weight, or None if there is none."""
+        return _ffi_api.UninterpFunClosedFormPrefixSum(var, weight, n)
+
     AFun = 0
     LFun = 1
     FOFun = 2
@@ -61,6 +61,15 @@ class Modes(tvm.runtime.Object):
         if isinstance(width_ufs, LFunsWrapper): width_ufs = width_ufs.get_ufs()
         return _ffi_api.StorageModes(dims, dense_shape, width_ufs, position_ufs)
 
+    def padded_storage_layout(dims, dense_shape, width_ufs, bucket_sizes, position_ufs={}):
+        """A storage layout padding the width of each dimension up to a
+        multiple of its bucket size. Splitting a loop over a dimension
+        by its bucket size, or vectorizing it with a width dividing
+        the bucket size, then needs no tail."""
+        if isinstance(width_ufs, LFunsWrapper): width_ufs = width_ufs.get_ufs()
+        return _ffi_api.PaddedStorageModes(dims, dense_shape, width_ufs, bucket_sizes,
+                                           position_ufs)
+
     def loop_layout(dims, dense_shape, min_ufs, max_ufs):
         return _ffi_api.LoopModes(dims, dense_shape, min_ufs, max_ufs)
 
@@ -76,3 +85,7 @@ class Modes(tvm.runtime.Object):
 
     def is_ragged(self):
         return _ffi_api.ModesIsRagged(self)
+
+    def index_dtype(self):
+        """The type of the positions in this layout."""
+        return "int%d" % _ffi_api.ModesIndexBits(self)
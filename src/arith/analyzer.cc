@@ -112,6 +112,8 @@ bool Analyzer::CanProveGreaterEqual(const PrimExpr& expr, int64_t lower_bound) {
   // std::cout << "[CPGE]  Rewritten: " << rewritten << std::endl;
   auto bd = this->const_int_bound(rewritten);
   if (bd->min_value >= lower_bound) return true;
+  // The bound of expr was just tried, so there is no other fast path
+  // to fall back to if Z3 gives up.
   return z3_analyzer.CanProve(expr >= IntImm(DataType::Int(64), lower_bound));
 }
 
@@ -132,7 +134,59 @@ bool Analyzer::CanProve(const PrimExpr& expr) {
     return ptr->value != 0;
   }
   // std::cout << "[ANA] TPT4: " << std::endl;
-  return z3_analyzer.CanProve(expr);
+  bool gave_up = false;
+  if (z3_analyzer.CanProve(expr, &gave_up)) return true;
+  return gave_up && CanProveFromBounds(res);
+}
+
+bool Analyzer::CanProveFromBounds(const PrimExpr& cond) {
+  if (const auto* op = cond.as<AndNode>()) {
+    return CanProveFromBounds(op->a) && CanProveFromBounds(op->b);
+  } else if (const auto* op = cond.as<OrNode>()) {
+    return CanProveFromBounds(op->a) || CanProveFromBounds(op->b);
+  } else if (const auto* op = cond.as<NotNode>()) {
+    const PrimExpr& a = op->a;
+    if (const auto* n = a.as<EQNode>()) return CanProveFromBounds(NENode::make(n->a, n->b));
+    if (const auto* n = a.as<NENode>()) return CanProveFromBounds(EQNode::make(n->a, n->b));
+    if (const auto* n = a.as<LTNode>()) return CanProveFromBounds(GENode::make(n->a, n->b));
+    if (const auto* n = a.as<LENode>()) return CanProveFromBounds(GTNode::make(n->a, n->b));
+    if (const auto* n = a.as<GTNode>()) return CanProveFromBounds(LENode::make(n->a, n->b));
+    if (const auto* n = a.as<GENode>()) return CanProveFromBounds(LTNode::make(n->a, n->b));
+    if (const auto* n = a.as<NotNode>()) return CanProveFromBounds(n->a);
+    if (const auto* n = a.as<AndNode>()) {
+      return CanProveFromBounds(NotNode::make(n->a)) || CanProveFromBounds(NotNode::make(n->b));
+    }
+    if (const auto* n = a.as<OrNode>()) {
+      return CanProveFromBounds(NotNode::make(n->a)) && CanProveFromBounds(NotNode::make(n->b));
+    }
+    return false;
+  }
+
+  // Compare both sides through the bounds of their difference.
+  auto diff_bound = [this](const PrimExpr& a, const PrimExpr& b) {
+    return this->const_int_bound(this->canonical_simplify(a - b));
+  };
+  if (const auto* op = cond.as<LTNode>()) {
+    return diff_bound(op->a, op->b)->max_value < 0;
+  } else if (const auto* op = cond.as<LENode>()) {
+    return diff_bound(op->a, op->b)->max_value <= 0;
+  } else if (const auto* op = cond.as<GTNode>()) {
+    return diff_bound(op->a, op->b)->min_value > 0;
+  } else if (const auto* op = cond.as<GENode>()) {
+    return diff_bound(op->a, op->b)->min_value >= 0;
+  } else if (const auto* op = cond.as<EQNode>()) {
+    auto bd = diff_bound(op->a, op->b);
+    return bd->min_value == 0 && bd->max_value == 0;
+  } else if (const auto* op = cond.as<NENode>()) {
+    PrimExpr diff = this->canonical_simplify(op->a - op->b);
+    auto bd = this->const_int_bound(diff);
+    if (bd->min_value > 0 || bd->max_value < 0) return true;
+    // diff = coeff * x + base is never zero if base is not a multiple
+    // of coeff.
+    ModularSet mod = this->modular_set(diff);
+    return mod->coeff != 0 && mod->base % mod->coeff != 0;
+  }
+  return false;
 }
 
 PrimExpr Analyzer::Simplify(const PrimExpr& expr) {
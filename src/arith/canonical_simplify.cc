@@ -24,6 +24,7 @@
 #include <tvm/arith/analyzer.h>
 #include <tvm/tir/op.h>
 
+#include "../support/compile_profiler.h"
 #include "const_fold.h"
 #include "pattern_match.h"
 #include "rewrite_simplify.h"
@@ -1111,6 +1112,7 @@ PrimExpr CanonicalSimplifier::Impl::VisitExpr_(const ReduceNode* op) {
 }
 
 PrimExpr CanonicalSimplifier::operator()(const PrimExpr& expr) {
+  support::CompileProfiler::Count(support::kCanonicalSimplify);
   return impl_->CanonicalSimplify(expr);
 }
 
@@ -30,6 +30,7 @@
 
 #include <algorithm>
 
+#include "../support/compile_profiler.h"
 #include "const_fold.h"
 #include "pattern_match.h"
 namespace tvm {
@@ -1569,6 +1570,16 @@ PrimExpr RewriteSimplifier::Impl::VisitExpr_(const OrNode* op) {
   return ret;
 }
 
+bool RewriteSimplifier::Impl::CanProveSelectFalse(const SelectNode* op) {
+  // Going through analyzer_->CanProve would simplify the select again.
+  bool gave_up = false;
+  PrimExpr select = GetRef<PrimExpr>(op);
+  if (analyzer_->z3_analyzer.CanProve(EQNode::make(select, op->false_value), &gave_up)) {
+    return true;
+  }
+  return gave_up && analyzer_->CanProveFromBounds(NotNode::make(op->condition));
+}
+
 PrimExpr RewriteSimplifier::Impl::VisitExpr_(const SelectNode* op) {
   PrimExpr ret = IRMutatorWithAnalyzer::VisitExpr_(op);
   op = ret.as<SelectNode>();
@@ -1579,9 +1590,7 @@ PrimExpr RewriteSimplifier::Impl::VisitExpr_(const SelectNode* op) {
   PVar<PrimExpr> pe;
   TVM_TRY_REWRITE(select(x, y, y, pf, pe), y);
 
-  Z3Analyzer analyzer;
-  // analyzer.AddConstraint(op->condition);
-  if (analyzer.CanProve(EQNode::make(ret, op->false_value))) {
+  if (CanProveSelectFalse(op)) {
     return op->false_value;
   }
 
@@ -1602,9 +1611,7 @@ PrimExpr RewriteSimplifier::Impl::VisitExpr_(const FuseSelectNode* op) {
   PVar<PrimExpr> x, y;
   TVM_TRY_REWRITE(select(x, y, y, pf, pe), y);
 
-  Z3Analyzer analyzer;
-  // analyzer.AddConstraint(op->condition);
-  if (analyzer.CanProve(EQNode::make(ret, op->false_value))) {
+  if (CanProveSelectFalse(op)) {
     return op->false_value;
   }
 
@@ -1732,6 +1739,7 @@ PrimExpr RewriteSimplifier::Impl::VisitExpr_(const LetNode* op) {
 }
 
 PrimExpr RewriteSimplifier::operator()(const PrimExpr& expr) {
+  support::CompileProfiler::Count(support::kRewriteSimplify);
   // std::cout << "Operator() " << expr << std::endl;
   // Run simplification in post order
   PrimExpr res = expr;
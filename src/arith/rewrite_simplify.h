@@ -98,6 +98,15 @@ class RewriteSimplifier::Impl : public IRMutatorWithAnalyzer {
    * \return comparison result.
    */
   CompareResult TryCompare(const PrimExpr& x, int64_t val);
+  /*!
+   * \brief Whether a select always takes its false value. Z3 is asked
+   *  with the constraints and under the pass budget of the parent
+   *  analyzer, and when it gives up, the condition is checked against
+   *  the bounds of its sides only.
+   * \param op The select, after simplification of its operands.
+   * \return Whether the select can be replaced by its false value.
+   */
+  bool CanProveSelectFalse(const SelectNode* op);
 
  private:
   // Whether x >= val
@@ -197,6 +197,7 @@ class StmtSimplifier : public IRMutatorWithAnalyzer {
 namespace tir {
 
 Stmt CanonicalSimplify(Stmt stmt, Map<Var, Range> vrange) {
+  arith::Z3PassScope z3_scope("Simplify");
   arith::Analyzer analyzer;
   for (auto kv : vrange) {
     analyzer.Bind(kv.first, kv.second);
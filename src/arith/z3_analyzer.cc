@@ -1,9 +1,21 @@
+#include <dmlc/common.h>
 #include <tvm/arith/z3_analyzer.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/target/target.h>
 #include <tvm/tir/op.h>
 
+#include <chrono>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <unordered_set>
 #include <utility>
 
+#include "../support/compile_profiler.h"
+
 namespace tvm {
 namespace arith {
 using namespace tir;
@@ -11,6 +23,34 @@ using namespace tir;
 #define PRINT_CONSTRAINTS false
 
 /*************************************************************************/
+size_t Z3Converter::UfHasher::operator()(UninterpFun uf) const {
+  // CheckEquality compares bodies up to a renaming of their variables,
+  // and may equate calls to different functions, so only the shape of
+  // the body outside of calls is hashed.
+  class ShapeHasher : public ExprVisitor {
+   public:
+    void VisitExpr(const PrimExpr& e) final {
+      Combine(e->type_index());
+      if (auto imm = e.as<IntImmNode>()) {
+        Combine(std::hash<int64_t>()(imm->value));
+      } else if (auto call = e.as<CallNode>()) {
+        Combine(call->args.size());
+        return;
+      }
+      ExprVisitor::VisitExpr(e);
+    }
+
+    size_t hash{0};
+
+   private:
+    void Combine(size_t value) { hash = dmlc::HashCombine(hash, value); }
+  };
+  if (!uf->body.defined()) return 0;
+  ShapeHasher hasher;
+  hasher(uf->body);
+  return hasher.hash;
+}
+
 z3fun Z3Converter::GetOrCreateZ3Fun(const Var& v) {
   auto it = z3_funs.find(v);
   if (it != z3_funs.end()) return it->second;
@@ -197,8 +237,321 @@ z3expr Z3Converter::VisitExprDefault_(const Object* op) {
 
 /*************************************************************************/
 
+namespace {
+
+/*! \brief The per pass Z3 statistics of the process. */
+class Z3StatsRegistry {
+ public:
+  static Z3StatsRegistry* Global() {
+    static Z3StatsRegistry* inst = new Z3StatsRegistry();
+    return inst;
+  }
+
+  template <typename FUpdate>
+  void Update(FUpdate fupdate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fupdate(&stats_[CurrentPass()]);
+  }
+
+  std::map<std::string, Z3PassStats> Get() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+  /*! \brief Remember a query Z3 gave up on, for arith.Z3GetTimeouts. */
+  void RecordTimeout(const PrimExpr& query, const std::string& reason) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_[CurrentPass()].timeouts++;
+    if (timeouts_.size() < kMaxReportedTimeouts) {
+      std::ostringstream os;
+      os << query;
+      timeouts_.push_back({CurrentPass(), os.str(), reason});
+    }
+  }
+
+  std::vector<std::vector<std::string>> GetTimeouts() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timeouts_;
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.clear();
+    timeouts_.clear();
+  }
+
+  static std::string& CurrentPass() {
+    static thread_local std::string pass = "other";
+    return pass;
+  }
+
+ private:
+  static constexpr size_t kMaxReportedTimeouts = 256;
+
+  std::mutex mutex_;
+  std::map<std::string, Z3PassStats> stats_;
+  // (pass, query, reason) of the first queries Z3 gave up on.
+  std::vector<std::vector<std::string>> timeouts_;
+};
+
+/*! \brief Solver time and checks spent by the current pass of the thread. */
+struct PassBudget {
+  double spent_ms{0};
+  int64_t solver_checks{0};
+  bool in_scope{false};
+
+  static PassBudget& Current() {
+    static thread_local PassBudget budget;
+    return budget;
+  }
+
+  bool Exhausted(const BuildConfig& cfg) const {
+    if (!in_scope) return false;
+    return (cfg->z3_pass_timeout_ms > 0 && spent_ms >= cfg->z3_pass_timeout_ms) ||
+           (cfg->z3_pass_max_solver_checks > 0 &&
+            solver_checks >= cfg->z3_pass_max_solver_checks);
+  }
+
+  void Spend(const BuildConfig& cfg, double ms) {
+    bool exhausted = Exhausted(cfg);
+    spent_ms += ms;
+    solver_checks++;
+    if (!exhausted && Exhausted(cfg)) {
+      LOG(WARNING) << "Z3 budget exhausted in pass " << Z3StatsRegistry::CurrentPass()
+                   << " after " << solver_checks << " solver checks and " << spent_ms
+                   << " ms, falling back to bound analysis for its remaining queries";
+    }
+  }
+};
+
+}  // namespace
+
+Z3PassScope::Z3PassScope(const std::string& pass) {
+  PassBudget& budget = PassBudget::Current();
+  prev_pass_ = Z3StatsRegistry::CurrentPass();
+  prev_spent_ms_ = budget.spent_ms;
+  prev_solver_checks_ = budget.solver_checks;
+  prev_in_scope_ = budget.in_scope;
+  Z3StatsRegistry::CurrentPass() = pass;
+  budget.spent_ms = 0;
+  budget.solver_checks = 0;
+  budget.in_scope = true;
+}
+
+Z3PassScope::~Z3PassScope() {
+  PassBudget& budget = PassBudget::Current();
+  Z3StatsRegistry::CurrentPass() = prev_pass_;
+  // The budget spent in a nested pass counts for the enclosing one too.
+  budget.spent_ms += prev_spent_ms_;
+  budget.solver_checks += prev_solver_checks_;
+  budget.in_scope = prev_in_scope_;
+}
+
+class Z3Context {
+ public:
+  Z3Context() : converter(ctx), solver(ctx) {}
+
+  /*!
+   * \brief The state of the current thread. Analyzers created after
+   *  the query cache or the converter, which keeps every expression it
+   *  converted alive, have grown too large get a fresh one, while
+   *  existing analyzers keep the old one alive.
+   */
+  static std::shared_ptr<Z3Context> ThreadLocal() {
+    static thread_local std::shared_ptr<Z3Context> inst;
+    if (inst == nullptr || inst->cache.size() > kMaxCachedQueries ||
+        inst->converter.NumConverted() > kMaxConverted) {
+      inst = std::make_shared<Z3Context>();
+    }
+    return inst;
+  }
+
+  /*!
+   * \brief Check if the constraints imply consequent.
+   * \param gave_up Set to whether Z3 gave up on the query.
+   * \param reason Set to the reason Z3 gave up, if it did.
+   */
+  bool Prove(const std::vector<z3::expr>& constraints, const z3::expr& consequent,
+             const BuildConfig& cfg, bool* gave_up, std::string* reason) {
+    unsigned timeout = cfg->z3_query_timeout_ms > 0
+                           ? static_cast<unsigned>(cfg->z3_query_timeout_ms)
+                           : std::numeric_limits<unsigned>::max();
+    z3::expr antecedent = ctx.bool_val(true);
+    for (const auto& c : constraints) {
+      antecedent = antecedent && c;
+    }
+    // Expressions are hash consed by Z3, so AST ids identify them
+    // structurally as long as they are alive.
+    std::pair<unsigned, unsigned> key(Z3_get_ast_id(ctx, antecedent),
+                                      Z3_get_ast_id(ctx, consequent));
+    auto it = cache.find(key);
+    // Queries given up on are retried with a larger timeout.
+    if (it != cache.end() && (!it->second.gave_up || it->second.timeout >= timeout)) {
+      Z3StatsRegistry::Global()->Update([](Z3PassStats* s) { s->cache_hits++; });
+      *gave_up = it->second.gave_up;
+      *reason = it->second.reason;
+      return it->second.result;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    bool result = false;
+    *gave_up = false;
+    try {
+      z3::check_result check;
+      if (IsNonlinear(constraints, consequent)) {
+        // Once push or pop has been called on it, a solver only uses
+        // its incremental core, without the nonlinear arithmetic
+        // tactics. Check these queries with a fresh solver instead.
+        z3::solver fresh(ctx);
+        z3::params p(ctx);
+        p.set(":timeout", timeout);
+        fresh.set(p);
+        for (const auto& c : constraints) {
+          fresh.add(c);
+        }
+        fresh.add(!consequent);
+        check = fresh.check();
+        if (check == z3::unknown) *reason = fresh.reason_unknown();
+      } else {
+        SetTimeout(timeout);
+        SyncConstraints(constraints);
+        solver.push();
+        solver.add(!consequent);
+        check = solver.check();
+        if (check == z3::unknown) *reason = solver.reason_unknown();
+        solver.pop();
+      }
+      result = (check == z3::unsat);
+      *gave_up = (check == z3::unknown);
+    } catch (const z3::exception& e) {
+      // Start from a clean solver for the next query.
+      solver.reset();
+      asserted.clear();
+      timeout_ = 0;
+    }
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - start)
+                    .count();
+    support::CompileProfiler::Count(support::kZ3SolverCheck);
+    Z3StatsRegistry::Global()->Update([ms](Z3PassStats* s) {
+      s->solver_checks++;
+      s->solver_ms += ms;
+    });
+    PassBudget::Current().Spend(cfg, ms);
+    CacheEntry entry{antecedent, consequent, result, *gave_up, timeout, *reason};
+    if (it != cache.end()) {
+      it->second = entry;
+    } else {
+      cache.emplace(key, entry);
+    }
+    return result;
+  }
+
+  z3::context ctx;
+  Z3Converter converter;
+
+ private:
+  struct CacheEntry {
+    // Keep the expressions, and hence their ids, alive.
+    z3::expr antecedent;
+    z3::expr consequent;
+    bool result;
+    bool gave_up;
+    unsigned timeout;
+    std::string reason;
+  };
+
+  void SetTimeout(unsigned timeout) {
+    if (timeout == timeout_) return;
+    z3::params p(ctx);
+    p.set(":timeout", timeout);
+    solver.set(p);
+    timeout_ = timeout;
+  }
+
+  /*! \brief Whether e multiplies, divides or takes the modulo of
+   *  non constant terms. */
+  static bool IsNonlinear(const z3::expr& e, std::unordered_set<unsigned>* visited) {
+    if (!visited->insert(e.id()).second) return false;
+    if (e.is_quantifier()) return IsNonlinear(e.body(), visited);
+    if (!e.is_app()) return false;
+    switch (e.decl().decl_kind()) {
+      case Z3_OP_MUL: {
+        int non_numerals = 0;
+        for (unsigned i = 0; i < e.num_args(); ++i) {
+          if (!e.arg(i).is_numeral()) non_numerals++;
+        }
+        if (non_numerals > 1) return true;
+        break;
+      }
+      case Z3_OP_DIV:
+      case Z3_OP_IDIV:
+      case Z3_OP_MOD:
+      case Z3_OP_REM:
+        if (!e.arg(1).is_numeral()) return true;
+        break;
+      default:
+        break;
+    }
+    for (unsigned i = 0; i < e.num_args(); ++i) {
+      if (IsNonlinear(e.arg(i), visited)) return true;
+    }
+    return false;
+  }
+
+  static bool IsNonlinear(const std::vector<z3::expr>& constraints, const z3::expr& consequent) {
+    std::unordered_set<unsigned> visited;
+    for (const auto& c : constraints) {
+      if (IsNonlinear(c, &visited)) return true;
+    }
+    return IsNonlinear(consequent, &visited);
+  }
+
+  struct PairHasher {
+    size_t operator()(const std::pair<unsigned, unsigned>& p) const {
+      return std::hash<uint64_t>()((static_cast<uint64_t>(p.first) << 32) | p.second);
+    }
+  };
+
+  /*!
+   * \brief Make the solver assert exactly constraints, with one scope
+   *  per constraint. Scopes of the common prefix with the previous
+   *  query are kept, which is most of them for the analyzers of
+   *  nested loops and conditions.
+   */
+  void SyncConstraints(const std::vector<z3::expr>& constraints) {
+    size_t common = 0;
+    while (common < asserted.size() && common < constraints.size() &&
+           Z3_get_ast_id(ctx, asserted[common]) == Z3_get_ast_id(ctx, constraints[common])) {
+      ++common;
+    }
+    if (common < asserted.size()) {
+      solver.pop(static_cast<unsigned>(asserted.size() - common));
+      asserted.erase(asserted.begin() + common, asserted.end());
+    }
+    for (size_t i = common; i < constraints.size(); ++i) {
+      solver.push();
+      solver.add(constraints[i]);
+      asserted.push_back(constraints[i]);
+    }
+  }
+
+  static constexpr size_t kMaxCachedQueries = 1 << 16;
+  static constexpr size_t kMaxConverted = 1 << 16;
+
+  z3::solver solver;
+  // The timeout the solver is set to, zero if not set.
+  unsigned timeout_{0};
+  std::vector<z3::expr> asserted;
+  std::unordered_map<std::pair<unsigned, unsigned>, CacheEntry, PairHasher> cache;
+};
+
+Z3Analyzer::Z3Analyzer() : shared(Z3Context::ThreadLocal()), ctx(shared->ctx) {
+  this->general_constraints = std::make_shared<z3::expr_vector>(ctx);
+}
+
 z3::expr Z3Analyzer::ConvertToZ3(const PrimExpr& expr) {
-  return (*this->converter)(expr)->simplify();
+  return shared->converter(expr)->simplify();
 }
 
 void Z3Analyzer::Bind(const Var& var, const Range& range) { this->Update(var, range, false); }
@@ -220,11 +573,15 @@ void Z3Analyzer::Update(const Var& var, const PrimExpr& min, const PrimExpr& max
     z3::expr z3max = ConvertToZ3(max);
     z3::expr z3var = ConvertToZ3(var);
 
-    if (!var_constraints.count(var.get()) || overwrite) {
-      var_constraints[var.get()] = std::make_shared<z3::expr_vector>(ctx);
+    auto it = var_constraint_index.find(var.get());
+    if (it == var_constraint_index.end()) {
+      it = var_constraint_index.emplace(var.get(), var_constraints.size()).first;
+      var_constraints.push_back(std::make_shared<z3::expr_vector>(ctx));
+    } else if (overwrite) {
+      var_constraints[it->second] = std::make_shared<z3::expr_vector>(ctx);
     }
-    var_constraints.at(var.get())->push_back(z3var >= z3min);
-    var_constraints.at(var.get())->push_back(z3var < z3max);
+    var_constraints[it->second]->push_back(z3var >= z3min);
+    var_constraints[it->second]->push_back(z3var < z3max);
   } catch (const std::invalid_argument& e) {
     return;
   } catch (const z3::exception& e) {
@@ -270,68 +627,50 @@ void Z3Analyzer::AddForallConstraint(const Array<Var>& forall_vars,
 
 void Z3Analyzer::RemoveLastConstraint() { this->general_constraints->pop_back(); }
 
-bool Z3Analyzer::CanProveInternal_(z3::expr& antecedent, z3::expr& consequent, bool print) {
-  z3::solver solver(ctx);
-
-  try {
-    z3::params p(ctx);
-    p.set(":timeout", 500u);
-    // p.set(":produce-proofs", true);
-    // p.set(":produce-models", true);
-    solver.set(p);
-
-    z3::expr to_prove = z3::implies(antecedent, consequent).simplify();
-
-    solver.add(!to_prove);
-    if (solver.check() == z3::unsat) {
-      // std::cout << "[Z3] Proof " << solver.proof() << std::endl;
-      return true;
-    } else {
-      if (print) {
-        // std::cout << "[Z3] " << antecedent << std::endl;
-        // std::cout << "[Z3] " << consequent << std::endl;
-        // std::cout << "[Z3] " << to_prove << std::endl;
-      }
-      // if (print) std::cout << "[Z3] Cannot prove. Have model.\n" << solver.get_model() <<
-      // std::endl;
-      // std::cout << "[Z3]  Return0.1" << std::endl;
-      return false;
-    }
-  } catch (const std::invalid_argument& e) {
-    // std::cout << "[Z3]  Return0.2" << std::endl;
-    return false;
-  } catch (const z3::exception& e) {
-    // std::cout << "[Z3]  Return0.3" << std::endl;
-    return false;
-  }
-}
-
-void Z3Analyzer::InitCall_() {
-  // std::cout << "[Z3] Z3 Analyzer created" << std::endl;
-}
-
-bool Z3Analyzer::CanProve(const PrimExpr& cond) {
-  z3::expr antecedent = ctx.bool_val(true);
-  for (auto it : var_constraints) {
-    for (auto expr : *it.second) {
-      antecedent = antecedent && expr;
+std::vector<z3::expr> Z3Analyzer::CollectConstraints_() {
+  std::vector<z3::expr> constraints;
+  for (const auto& vec : var_constraints) {
+    for (auto expr : *vec) {
+      constraints.push_back(expr);
     }
   }
-
   for (auto expr : *this->general_constraints) {
-    antecedent = antecedent && expr;
+    constraints.push_back(expr);
   }
+  return constraints;
+}
 
-  z3::expr false_expr = ctx.bool_val(false);
-  if (CanProveInternal_(antecedent, false_expr, false)) {
+bool Z3Analyzer::CanProve(const PrimExpr& cond, bool* gave_up) {
+  bool ignored;
+  if (gave_up == nullptr) gave_up = &ignored;
+  *gave_up = false;
+  Z3StatsRegistry::Global()->Update([](Z3PassStats* s) { s->queries++; });
+  support::CompileProfiler::Count(support::kZ3Query);
+  BuildConfig cfg = BuildConfig::Current();
+  if (PassBudget::Current().Exhausted(cfg)) {
+    Z3StatsRegistry::Global()->Update([](Z3PassStats* s) { s->skipped++; });
+    *gave_up = true;
+    return false;
+  }
+  std::vector<z3::expr> constraints = CollectConstraints_();
+
+  // Cached too, so only checked once per set of constraints.
+  bool inconsistent_gave_up;
+  std::string reason;
+  if (shared->Prove(constraints, ctx.bool_val(false), cfg, &inconsistent_gave_up, &reason)) {
+    z3::expr antecedent = ctx.bool_val(true);
+    for (const auto& c : constraints) {
+      antecedent = antecedent && c;
+    }
     std::cout << "[Z3] Antecedent\n" << antecedent << std::endl;
     CHECK(false) << "Invalid constraints added to the solver";
   }
 
+  bool proved = false;
   try {
     z3::expr consequent = ConvertToZ3(cond);
     // std::cout << "[Z3] TPT: " << cond << std::endl;
-    return CanProveInternal_(antecedent, consequent, true);
+    proved = shared->Prove(constraints, consequent, cfg, gave_up, &reason);
   } catch (const std::invalid_argument& e) {
     // std::cout << "[Z3]  Return1" << std::endl;
     return false;
@@ -339,7 +678,47 @@ bool Z3Analyzer::CanProve(const PrimExpr& cond) {
     // std::cout << "[Z3]  Return2" << std::endl;
     return false;
   }
-  return false;
+  if (proved) {
+    Z3StatsRegistry::Global()->Update([](Z3PassStats* s) { s->proved++; });
+  } else if (*gave_up) {
+    Z3StatsRegistry::Global()->RecordTimeout(cond, reason);
+  }
+  return proved;
 }
+
+TVM_REGISTER_GLOBAL("arith.Z3GetStats").set_body_typed([]() {
+  Map<std::string, Map<std::string, PrimExpr>> ret;
+  for (const auto& it : Z3StatsRegistry::Global()->Get()) {
+    const Z3PassStats& s = it.second;
+    Map<std::string, PrimExpr> pass_stats;
+    pass_stats.Set("queries", IntImm(DataType::Int(64), s.queries));
+    pass_stats.Set("cache_hits", IntImm(DataType::Int(64), s.cache_hits));
+    pass_stats.Set("solver_checks", IntImm(DataType::Int(64), s.solver_checks));
+    pass_stats.Set("proved", IntImm(DataType::Int(64), s.proved));
+    pass_stats.Set("timeouts", IntImm(DataType::Int(64), s.timeouts));
+    pass_stats.Set("skipped", IntImm(DataType::Int(64), s.skipped));
+    pass_stats.Set("solver_ms", FloatImm(DataType::Float(64), s.solver_ms));
+    ret.Set(it.first, pass_stats);
+  }
+  return ret;
+});
+
+// Returns (pass, query, reason) triples.
+TVM_REGISTER_GLOBAL("arith.Z3GetTimeouts").set_body_typed([]() {
+  Array<Array<PrimExpr>> ret;
+  for (const auto& timeout : Z3StatsRegistry::Global()->GetTimeouts()) {
+    Array<PrimExpr> entry;
+    for (const auto& field : timeout) {
+      entry.push_back(StringImmNode::make(field));
+    }
+    ret.push_back(entry);
+  }
+  return ret;
+});
+
+TVM_REGISTER_GLOBAL("arith.Z3ResetStats").set_body_typed([]() {
+  Z3StatsRegistry::Global()->Reset();
+});
+
 }  // namespace arith
 }  // namespace tvm
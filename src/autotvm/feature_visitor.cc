@@ -25,15 +25,114 @@
 
 #include "feature_visitor.h"
 
+#include <tvm/tir/ir_pass.h>
+#include <tvm/tir/op.h>
+#include <tvm/tir/uninterp_fun.h>
+
+#include <algorithm>
+#include <cmath>
+
 namespace tvm {
 namespace autotvm {
 
+namespace {
+
+double Mean(const ValueDistribution& dist) {
+  double sum = 0, total_weight = 0;
+  for (size_t i = 0; i < dist.values.size(); ++i) {
+    sum += dist.weights[i] * dist.values[i];
+    total_weight += dist.weights[i];
+  }
+  return total_weight > 0 ? sum / total_weight : 0;
+}
+
+// Replace the values in an expression that are only known in
+// expectation. Loads from buffers, or calls to uninterpreted
+// functions, with a distribution are replaced by sample if it is the
+// sampled one, and by their mean otherwise.
+class ExpectedValueMutator : public ExprMutator {
+ public:
+  ExpectedValueMutator(const ValueDistributionMap& dists,
+                       const std::unordered_map<const VarNode*, PrimExpr>& let_values,
+                       const std::unordered_map<const VarNode*, PrimExpr>& loop_var_values)
+      : dists_(dists), let_values_(let_values), loop_var_values_(loop_var_values) {}
+
+  PrimExpr VisitExpr_(const VarNode* op) final {
+    auto it = let_values_.find(op);
+    if (it != let_values_.end()) return VisitExpr(it->second);
+    it = loop_var_values_.find(op);
+    if (it != loop_var_values_.end()) return VisitExpr(it->second);
+    return GetRef<PrimExpr>(op);
+  }
+
+  PrimExpr VisitExpr_(const LoadNode* op) final {
+    PrimExpr value = Lookup(op->buffer_var->name_hint, op->dtype);
+    return value.defined() ? value : ExprMutator::VisitExpr_(op);
+  }
+
+  PrimExpr VisitExpr_(const CallNode* op) final {
+    if (auto ufun = op->func.as<UninterpFunNode>()) {
+      PrimExpr value = Lookup(ufun->fname, op->dtype);
+      if (value.defined()) return value;
+    }
+    return ExprMutator::VisitExpr_(op);
+  }
+
+  std::string sampled;
+  int64_t sample{0};
+  // the distributions the mutated expressions depend on
+  std::vector<std::string> used;
+
+ private:
+  PrimExpr Lookup(const std::string& name, DataType dtype) {
+    auto it = dists_.find(name);
+    if (it == dists_.end()) return PrimExpr();
+    if (std::find(used.begin(), used.end(), name) == used.end()) used.push_back(name);
+    if (name == sampled) return make_const(dtype, sample);
+    return make_const(dtype, std::llround(Mean(it->second)));
+  }
+
+  const ValueDistributionMap& dists_;
+  const std::unordered_map<const VarNode*, PrimExpr>& let_values_;
+  const std::unordered_map<const VarNode*, PrimExpr>& loop_var_values_;
+};
+
+}  // namespace
+
+int64_t FeatureVisitor::EstimateExtent(const PrimExpr& extent) {
+  if (const auto* imm = extent.as<IntImmNode>()) return imm->value;
+
+  ExpectedValueMutator mutator(length_distributions, let_values_, loop_var_values_);
+  PrimExpr mean_extent = Simplify(mutator(extent));
+  if (mutator.used.empty()) {
+    const auto* imm = mean_extent.as<IntImmNode>();
+    return imm != nullptr ? imm->value : -1;
+  }
+
+  // Take the expectation over the first distribution the extent
+  // depends on. The extent is not linear in general (padded or
+  // clamped lengths), so it is evaluated on every value.
+  mutator.sampled = mutator.used[0];
+  const ValueDistribution& dist = length_distributions.at(mutator.sampled);
+  double expected = 0, total_weight = 0;
+  for (size_t i = 0; i < dist.values.size(); ++i) {
+    mutator.sample = dist.values[i];
+    PrimExpr sample_extent = Simplify(mutator(extent));
+    const auto* imm = sample_extent.as<IntImmNode>();
+    if (imm == nullptr) return -1;
+    expected += dist.weights[i] * imm->value;
+    total_weight += dist.weights[i];
+  }
+  return total_weight > 0 ? std::llround(expected / total_weight) : -1;
+}
+
 // for loop
 void FeatureVisitor::VisitStmt_(const ForNode* op) {
-  const auto *extent = op->extent.as<IntImmNode>();
-  int64_t loop_extent = -1;
-  if (extent != nullptr)
-    loop_extent = extent->value;
+  // The bounds are evaluated once per entry in the loop, so accesses
+  // in them, such as loads of ragged lengths, belong to outer loops.
+  this->VisitExpr(op->min);
+  this->VisitExpr(op->extent);
+  int64_t loop_extent = EstimateExtent(op->extent);
   AnnotationType ann = kSerial;
   switch (op->for_type) {
     case ForType ::Parallel:
@@ -47,15 +146,23 @@ void FeatureVisitor::VisitStmt_(const ForNode* op) {
       break;
     case ForType::Serial:
       ann = kSerial;
+      break;
     case ForType::Peeled:
       LOG(FATAL) << "Peeled loops not supported yet";
       break;
   }
 
+  loop_var_values_[op->loop_var.get()] = op->min + indexdiv(op->extent - 1, 2);
   if (EnterItervar_(op->loop_var, loop_extent, ann)) {
-    StmtExprVisitor::VisitStmt_(op);
+    this->VisitStmt(op->body);
     ExitItervar_();
   }
+  loop_var_values_.erase(op->loop_var.get());
+}
+
+void FeatureVisitor::VisitStmt_(const LetStmtNode* op) {
+  let_values_[op->var.get()] = op->value;
+  StmtExprVisitor::VisitStmt_(op);
 }
 
 // parallel axis, virtual thread
@@ -63,8 +170,7 @@ void FeatureVisitor::VisitStmt_(const AttrStmtNode* op) {
   if (op->attr_key == attr::thread_extent ||
       op->attr_key == attr::virtual_thread) {
     Var var = op->node.as<tir::IterVarNode>()->var;
-    const auto *extent = op->value.as<IntImmNode>();
-    CHECK(extent);
+    int64_t extent = EstimateExtent(op->value);
 
     std::string name = var.get()->name_hint;
     AnnotationType ann = kParallel;
@@ -87,7 +193,7 @@ void FeatureVisitor::VisitStmt_(const AttrStmtNode* op) {
       ann = kVirtualThread;
     }
 
-    if (EnterItervar_(var, extent->value, ann)) {
+    if (EnterItervar_(var, extent, ann)) {
       StmtExprVisitor::VisitStmt_(op);
       ExitItervar_();
     }
@@ -30,6 +30,8 @@
 #include <tvm/tir/stmt.h>
 #include <tvm/tir/stmt_functor.h>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace tvm {
 namespace autotvm {
@@ -45,6 +47,19 @@ enum AnnotationType {
   kNum,
 };
 
+/*!
+ * \brief Distribution of the values read from a buffer or returned by
+ * an uninterpreted function, such as the lengths of a ragged dimension.
+ * The weights sum up to 1.
+ */
+struct ValueDistribution {
+  std::vector<int64_t> values;
+  std::vector<double> weights;
+};
+
+/*! \brief Map from a buffer or uninterpreted function name to its distribution */
+using ValueDistributionMap = std::unordered_map<std::string, ValueDistribution>;
+
 /*!
  * \brief A base class for feature extractor, used for processing
  * for loop and memory access in the IR
@@ -54,6 +69,7 @@ class FeatureVisitor : public StmtExprVisitor {
   // for loop
   void VisitStmt_(const ForNode* op) final;
   void VisitStmt_(const AttrStmtNode* op) final;
+  void VisitStmt_(const LetStmtNode* op) final;
 
   // memory access
   void VisitExpr_(const LoadNode* op) final;
@@ -62,7 +78,22 @@ class FeatureVisitor : public StmtExprVisitor {
   using StmtExprVisitor::VisitStmt_;
   using StmtExprVisitor::VisitExpr_;
 
+  /*!
+   * \brief Distributions of the lengths of ragged loops. Loop extents
+   *  reading from these buffers or functions are replaced by their
+   *  expected value.
+   */
+  ValueDistributionMap length_distributions;
+
  protected:
+  /*!
+   * \brief Estimate the trip count of a loop. Let bound variables are
+   *  inlined, outer loop variables are replaced by their expected value
+   *  and the expectation is taken over length_distributions.
+   * \return The expected trip count, or -1 if it is unknown
+   */
+  int64_t EstimateExtent(const PrimExpr& extent);
+
   /*!
  * \brief Enter a for loop node
  * \param var The expression to be printed.
@@ -81,6 +112,12 @@ class FeatureVisitor : public StmtExprVisitor {
   virtual void EnterMem_(tir::Var buffer_var, tvm::PrimExpr index) = 0;
   /*! \brief Exit a memory access node */
   virtual void ExitMem_() = 0;
+
+ private:
+  // values of let bound variables
+  std::unordered_map<const VarNode*, PrimExpr> let_values_;
+  // expected values of the enclosing loop variables
+  std::unordered_map<const VarNode*, PrimExpr> loop_var_values_;
 };
 
 }  // namespace autotvm
@@ -195,6 +195,7 @@ void TouchExtractor::ExitMem_() {
  * \brief Get axis-based feature for all axes
  * \param stmt The statement to be extracted
  * \param bool Whether take log for numerical feature
+ * \param length_distributions The distributions of the lengths of ragged loops
  * \param ret_feature The buffer where the return value is stored
  *
  * \note The format of return value is
@@ -219,9 +220,11 @@ void TouchExtractor::ExitMem_() {
  * \note If you want to flatten these features as the input of your model,
  * You can use the faster one GetItervarFeatureFlatten below.
  */
-void GetItervarFeature(Stmt stmt, bool take_log, Array<Array<Array<PrimExpr> > > *ret_feature) {
+void GetItervarFeature(Stmt stmt, bool take_log, const ValueDistributionMap& length_distributions,
+                       Array<Array<Array<PrimExpr> > > *ret_feature) {
   // extract
   TouchExtractor touch_analyzer;
+  touch_analyzer.length_distributions = length_distributions;
   touch_analyzer.Analyze(stmt);
 
   // sort according to order
@@ -300,14 +303,18 @@ void GetItervarFeature(Stmt stmt, bool take_log, Array<Array<Array<PrimExpr> > >
  * \brief Get axis-based feature for all axes and flatten them into a one-dimensional vector.
  * \param stmt The statement to be extracted
  * \param bool Whether take log for numerical feature
+ * \param length_distributions The distributions of the lengths of ragged loops
  * \param ret_feature The buffer where the return value is stored
  *
  * \note See GetItervarFeature for more details about the return value.
  *       This is an optimized version of GetItervarFeature + Flatten. This runs much faster.
  */
-void GetItervarFeatureFlatten(Stmt stmt, bool take_log, std::vector<float> *ret_feature) {
+void GetItervarFeatureFlatten(Stmt stmt, bool take_log,
+                              const ValueDistributionMap& length_distributions,
+                              std::vector<float> *ret_feature) {
   // extract touch feature
   TouchExtractor touch_analyzer;
+  touch_analyzer.length_distributions = length_distributions;
   touch_analyzer.Analyze(stmt);
 
   // sort according to order
@@ -375,11 +382,15 @@ void GetItervarFeatureFlatten(Stmt stmt, bool take_log, std::vector<float> *ret_
  * \brief Get curve sample feature (relation feature) and flatten them into a one-dimensional vector.
  * \param stmt The statement to be extracted
  * \param sample_n The number of points used for sampling a curve (along one dimension)
+ * \param length_distributions The distributions of the lengths of ragged loops
  * \param ret_feature The buffer where the return value is stored
  */
-void GetCurveSampleFeatureFlatten(Stmt stmt, int sample_n, std::vector<float> *ret_feature) {
+void GetCurveSampleFeatureFlatten(Stmt stmt, int sample_n,
+                                  const ValueDistributionMap& length_distributions,
+                                  std::vector<float> *ret_feature) {
   // extract touch feature
   TouchExtractor touch_ext;
+  touch_ext.length_distributions = length_distributions;
   touch_ext.Analyze(stmt);
 
   // sort according to order
@@ -484,6 +495,37 @@ void GetCurveSampleFeatureFlatten(Stmt stmt, int sample_n, std::vector<float> *r
   }
 }
 
+/*!
+ * \brief Unpack the optional length distributions passed by the front
+ *  end as a map from buffer or function names to (values, weights).
+ */
+ValueDistributionMap UnpackLengthDistributions(const TVMArgs& args, int idx) {
+  ValueDistributionMap ret;
+  if (args.size() <= idx || args[idx].type_code() == kTVMNullptr) {
+    return ret;
+  }
+  Map<std::string, Array<Array<PrimExpr> > > dists = args[idx];
+  for (auto kv : dists) {
+    CHECK_EQ(kv.second.size(), 2) << "Expected values and weights for " << kv.first;
+    Array<PrimExpr> values = kv.second[0];
+    Array<PrimExpr> weights = kv.second[1];
+    CHECK_EQ(values.size(), weights.size()) << "Expected one weight per value for " << kv.first;
+    ValueDistribution& dist = ret[kv.first];
+    for (size_t i = 0; i < values.size(); ++i) {
+      const auto* value = values[i].as<IntImmNode>();
+      CHECK(value) << "Values of " << kv.first << " should be integers";
+      dist.values.push_back(value->value);
+      if (const auto* weight = weights[i].as<FloatImmNode>()) {
+        dist.weights.push_back(weight->value);
+      } else {
+        const auto* int_weight = weights[i].as<IntImmNode>();
+        CHECK(int_weight) << "Weights of " << kv.first << " should be numbers";
+        dist.weights.push_back(static_cast<double>(int_weight->value));
+      }
+    }
+  }
+  return ret;
+}
 
 // register API for front end
 TVM_REGISTER_GLOBAL("autotvm.feature.GetItervarFeature")
@@ -492,7 +534,7 @@ TVM_REGISTER_GLOBAL("autotvm.feature.GetItervarFeature")
   bool take_log = args[1];
   Array<Array<Array<PrimExpr > > > ret_feature;
 
-  GetItervarFeature(stmt, take_log, &ret_feature);
+  GetItervarFeature(stmt, take_log, UnpackLengthDistributions(args, 2), &ret_feature);
 
   *ret = ret_feature;
 });
@@ -504,7 +546,7 @@ TVM_REGISTER_GLOBAL("autotvm.feature.GetItervarFeatureFlatten")
   bool take_log = args[1];
   std::vector<float> ret_feature;
 
-  GetItervarFeatureFlatten(stmt, take_log, &ret_feature);
+  GetItervarFeatureFlatten(stmt, take_log, UnpackLengthDistributions(args, 2), &ret_feature);
 
   TVMByteArray arr;
   arr.size = sizeof(float) * ret_feature.size();
@@ -519,7 +561,7 @@ TVM_REGISTER_GLOBAL("autotvm.feature.GetCurveSampleFeatureFlatten")
   int sample_n = args[1];
   std::vector<float> ret_feature;
 
-  GetCurveSampleFeatureFlatten(stmt, sample_n, &ret_feature);
+  GetCurveSampleFeatureFlatten(stmt, sample_n, UnpackLengthDistributions(args, 2), &ret_feature);
 
   TVMByteArray arr;
   arr.size = sizeof(float) * ret_feature.size();
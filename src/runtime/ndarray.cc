@@ -26,6 +26,7 @@
 #include <tvm/runtime/device_api.h>
 #include <tvm/runtime/ndarray.h>
 
+#include "prep_code_cache.h"
 #include "runtime_base.h"
 #include "workspace_pool.h"
 
@@ -70,6 +71,7 @@ struct NDArray::Internal {
       if (WorkspacePool::mem_prof_on_) {
         WorkspacePool::current_memory_usage_ -= size;
       }
+      PrepCodeCacheInvalidate(ptr->dl_tensor.data);
       tvm::runtime::DeviceAPI::Get(ptr->dl_tensor.ctx)
           ->FreeDataSpace(ptr->dl_tensor.ctx, ptr->dl_tensor.data);
     }
@@ -215,6 +217,7 @@ void NDArray::CopyFromTo(const DLTensor* from, DLTensor* to, TVMStreamHandle str
   // api manager.
   TVMContext ctx = from->ctx.device_type != kDLCPU ? from->ctx : to->ctx;
 
+  PrepCodeCacheInvalidate(to->data);
   DeviceAPI::Get(ctx)->CopyDataFromTo(from->data, static_cast<size_t>(from->byte_offset), to->data,
                                       static_cast<size_t>(to->byte_offset), from_size, from->ctx,
                                       to->ctx, from->dtype, stream);
@@ -320,6 +323,7 @@ int TVMArrayCopyFromBytes(TVMArrayHandle handle, void* data, size_t nbytes, bool
   } else {
     CHECK_EQ(arr_size, nbytes) << "TVMArrayCopyFromBytes: size mismatch";
   }
+  PrepCodeCacheInvalidate(handle->data);
   DeviceAPI::Get(handle->ctx)
       ->CopyDataFromTo(data, 0, handle->data, static_cast<size_t>(handle->byte_offset), nbytes,
                        cpu_ctx, handle->ctx, handle->dtype, nullptr);
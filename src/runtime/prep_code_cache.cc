@@ -0,0 +1,201 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file prep_code_cache.cc
+ * \brief Memo of prep code results, keyed on the length arrays the
+ *  prep code was last run on.
+ *
+ *  Generated functions built with cache_prep_code call
+ *  runtime.PrepCodeCacheLookup before their prep code, passing the
+ *  intermediate (aux) buffers the prep code fills and the length
+ *  arguments it reads. The prep code is skipped on a hit. After a
+ *  miss, the prep code is run and runtime.PrepCodeCacheCommit records
+ *  the hash of the lengths the aux buffers now hold the results for.
+ *
+ *  Entries are keyed on the aux buffers and the lengths only, not on
+ *  the function, so that kernels sharing a layout (and thus passed the
+ *  same aux buffers) reuse each other's prep code results.
+ *
+ *  The length arguments are hashed on every lookup, so they may be
+ *  modified in any way. The aux buffers are only tracked through the
+ *  NDArray API: freeing an aux buffer or copying into it drops its
+ *  entry, but raw writes to its memory (through a shared DLPack view,
+ *  say) bypass the cache, which has to be cleared after them with
+ *  runtime.PrepCodeCacheClear.
+ */
+#include "prep_code_cache.h"
+
+#include <tvm/runtime/registry.h>
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+class PrepCodeCache {
+ public:
+  static PrepCodeCache* Global() {
+    static PrepCodeCache* inst = new PrepCodeCache();
+    return inst;
+  }
+
+  /*!
+   * \brief Check if the aux buffers still hold the results of
+   *  running prep code on lengths hashing to hash. On a miss, the hash
+   *  is remembered until the corresponding Commit.
+   */
+  bool Lookup(const std::vector<void*>& aux_bufs, uint64_t hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool hit = !aux_bufs.empty();
+    for (void* buf : aux_bufs) {
+      auto it = owners_.find(buf);
+      if (it == owners_.end() || it->second != hash) {
+        hit = false;
+        break;
+      }
+    }
+    if (hit) {
+      hits_++;
+    } else {
+      misses_++;
+      has_entries_ = true;
+      for (void* buf : aux_bufs) {
+        owners_.erase(buf);
+        pending_[buf] = hash;
+      }
+    }
+    return hit;
+  }
+
+  /*! \brief Mark the aux buffers as filled for the hash of their last Lookup. */
+  void Commit(const std::vector<void*>& aux_bufs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (void* buf : aux_bufs) {
+      auto it = pending_.find(buf);
+      if (it != pending_.end()) {
+        owners_[buf] = it->second;
+        pending_.erase(it);
+      }
+    }
+  }
+
+  /*! \brief Drop the entries of the buffer at data. */
+  void Invalidate(const void* data) {
+    // Buffers are freed and copied to far more often than the cache is
+    // used, skip the lock until a function has used the cache.
+    if (!has_entries_.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    void* buf = const_cast<void*>(data);
+    owners_.erase(buf);
+    pending_.erase(buf);
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    owners_.clear();
+    pending_.clear();
+    hits_ = 0;
+    misses_ = 0;
+  }
+
+  int64_t hits() const { return hits_.load(); }
+  int64_t misses() const { return misses_.load(); }
+
+ private:
+  std::mutex mutex_;
+  /*! \brief The hash of the lengths each aux buffer holds the results for. */
+  std::unordered_map<void*, uint64_t> owners_;
+  std::unordered_map<void*, uint64_t> pending_;
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<bool> has_entries_{false};
+};
+
+void PrepCodeCacheInvalidate(const void* data) { PrepCodeCache::Global()->Invalidate(data); }
+
+// FNV-1a over the raw bytes of the length arrays.
+inline uint64_t HashBytes(const void* data, int64_t nbytes, uint64_t hash) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (int64_t i = 0; i < nbytes; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/*!
+ * \brief Unpack (num_aux_bufs, aux_buf_0, ..., aux_buf_n) from the
+ *  head of args.
+ * \return The index of the first argument after the aux buffers.
+ */
+int UnpackAuxBuffers(const TVMArgs& args, std::vector<void*>* aux_bufs) {
+  int num_aux_bufs = args[0];
+  for (int i = 0; i < num_aux_bufs; ++i) {
+    aux_bufs->push_back(args[1 + i].operator void*());
+  }
+  return 1 + num_aux_bufs;
+}
+
+/*
+ * Arguments: num_aux_bufs, aux_bufs..., followed by
+ * (data, nbytes) pairs for each length argument. Scalar length
+ * arguments are passed as (value, -1).
+ */
+TVM_REGISTER_GLOBAL("runtime.PrepCodeCacheLookup").set_body([](TVMArgs args, TVMRetValue* ret) {
+  std::vector<void*> aux_bufs;
+  int begin = UnpackAuxBuffers(args, &aux_bufs);
+  CHECK_EQ((args.size() - begin) % 2, 0) << "Length arguments should come in pairs";
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = begin; i < args.size(); i += 2) {
+    int64_t nbytes = args[i + 1];
+    if (nbytes < 0) {
+      int64_t value = args[i];
+      hash = HashBytes(&value, sizeof(value), hash);
+    } else {
+      hash = HashBytes(args[i].operator void*(), nbytes, hash);
+    }
+  }
+  *ret = static_cast<int>(PrepCodeCache::Global()->Lookup(aux_bufs, hash));
+});
+
+TVM_REGISTER_GLOBAL("runtime.PrepCodeCacheCommit").set_body([](TVMArgs args, TVMRetValue* ret) {
+  std::vector<void*> aux_bufs;
+  UnpackAuxBuffers(args, &aux_bufs);
+  PrepCodeCache::Global()->Commit(aux_bufs);
+  *ret = 0;
+});
+
+TVM_REGISTER_GLOBAL("runtime.PrepCodeCacheHits").set_body_typed([]() {
+  return PrepCodeCache::Global()->hits();
+});
+
+TVM_REGISTER_GLOBAL("runtime.PrepCodeCacheMisses").set_body_typed([]() {
+  return PrepCodeCache::Global()->misses();
+});
+
+TVM_REGISTER_GLOBAL("runtime.PrepCodeCacheClear").set_body_typed([]() {
+  PrepCodeCache::Global()->Clear();
+});
+
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,42 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file prep_code_cache.h
+ * \brief Invalidation hooks of the prep code cache.
+ */
+#ifndef TVM_RUNTIME_PREP_CODE_CACHE_H_
+#define TVM_RUNTIME_PREP_CODE_CACHE_H_
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief Forget the prep code results held in the buffer at data. To
+ *  be called when the buffer is freed or overwritten outside of the
+ *  prep code, so that a buffer reallocated at the same address or
+ *  filled with other data is never taken for a hit.
+ * \param data The data pointer of the buffer.
+ */
+void PrepCodeCacheInvalidate(const void* data);
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_PREP_CODE_CACHE_H_
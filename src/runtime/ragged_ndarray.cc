@@ -0,0 +1,230 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file ragged_ndarray.cc
+ * \brief Ragged tensor container.
+ */
+#include <dmlc/logging.h>
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/memory.h>
+#include <tvm/runtime/ragged_ndarray.h>
+#include <tvm/runtime/registry.h>
+
+#include <cstring>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+namespace {
+
+inline DLContext CPUContext() {
+  DLContext cpu_ctx;
+  cpu_ctx.device_type = kDLCPU;
+  cpu_ctx.device_id = 0;
+  return cpu_ctx;
+}
+
+// Copy the first nbytes of the flat storage of from into to. Unlike
+// NDArray::CopyFromTo, this does not assume dense sizes.
+void CopyFlat(const NDArray& from, const NDArray& to, size_t nbytes) {
+  TVMContext ctx = from->ctx.device_type != kDLCPU ? from->ctx : to->ctx;
+  DeviceAPI::Get(ctx)->CopyDataFromTo(from->data, static_cast<size_t>(from->byte_offset), to->data,
+                                      static_cast<size_t>(to->byte_offset), nbytes, from->ctx,
+                                      to->ctx, from->dtype, nullptr);
+}
+
+struct RowViewContext {
+  NDArray parent;
+  std::vector<int64_t> shape;
+  DLManagedTensor managed;
+};
+
+void RowViewDeleter(DLManagedTensor* tensor) {
+  delete static_cast<RowViewContext*>(tensor->manager_ctx);
+}
+
+}  // namespace
+
+RaggedNDArray RaggedNDArray::Empty(std::vector<int64_t> shape, NDArray lengths, DLDataType dtype,
+                                   DLContext ctx) {
+  CHECK_GE(shape.size(), 2) << "A ragged array needs at least a batch and a ragged dimension";
+  CHECK_EQ(lengths->ctx.device_type, kDLCPU) << "Row lengths should be on the CPU";
+  CHECK(lengths->dtype.code == kDLInt && lengths->dtype.bits == 32)
+      << "Row lengths should be int32";
+  CHECK_EQ(lengths->ndim, 1);
+  CHECK_EQ(lengths->shape[0], shape[0]) << "Expected one length per row";
+  CHECK(lengths->strides == nullptr || lengths->strides[0] == 1) << "Row lengths should be compact";
+
+  auto n = make_object<RaggedNDArrayObj>();
+  n->shape = shape;
+  // Keep a copy of the lengths, as the row offsets below would go
+  // stale if the caller modified its array.
+  n->lengths = NDArray::Empty({shape[0]}, lengths->dtype, CPUContext());
+  CopyFlat(lengths, n->lengths, shape[0] * sizeof(int32_t));
+  n->inner_size = 1;
+  for (size_t i = 2; i < shape.size(); ++i) {
+    n->inner_size *= shape[i];
+  }
+
+  const int32_t* lens = static_cast<const int32_t*>(n->lengths->data);
+  n->row_offsets.resize(shape[0] + 1);
+  n->row_offsets[0] = 0;
+  for (int64_t i = 0; i < shape[0]; ++i) {
+    CHECK(lens[i] >= 0 && lens[i] <= shape[1])
+        << "Length " << lens[i] << " of row " << i << " out of bounds";
+    n->row_offsets[i + 1] = n->row_offsets[i] + lens[i];
+  }
+  n->data = NDArray::RaggedEmpty(shape, n->row_offsets[shape[0]] * n->inner_size, dtype, ctx);
+  return RaggedNDArray(n);
+}
+
+RaggedNDArray RaggedNDArray::FromPadded(NDArray padded, NDArray lengths, DLContext ctx) {
+  CHECK_EQ(padded->ctx.device_type, kDLCPU) << "Padded arrays are packed on the CPU";
+  CHECK(padded->strides == nullptr) << "Padded array should be compact";
+  std::vector<int64_t> shape(padded->shape, padded->shape + padded->ndim);
+  RaggedNDArray ret = Empty(shape, lengths, padded->dtype, CPUContext());
+  const RaggedNDArrayObj* self = ret.operator->();
+
+  // Both the padded and the packed rows are contiguous, so each row
+  // is a single memcpy.
+  size_t slice_bytes = self->inner_size * GetDLDataTypeBytes(padded->dtype);
+  const char* src = static_cast<const char*>(padded->data) + padded->byte_offset;
+  char* dst = static_cast<char*>(self->data->data);
+  for (int64_t i = 0; i < shape[0]; ++i) {
+    int64_t len = self->row_offsets[i + 1] - self->row_offsets[i];
+    std::memcpy(dst + self->row_offsets[i] * slice_bytes, src + i * shape[1] * slice_bytes,
+                len * slice_bytes);
+  }
+
+  if (ctx.device_type == kDLCPU) {
+    return ret;
+  }
+  RaggedNDArray dev = Empty(shape, lengths, padded->dtype, ctx);
+  CopyFlat(self->data, dev->data, self->row_offsets[shape[0]] * slice_bytes);
+  return dev;
+}
+
+NDArray RaggedNDArray::ToPadded() const {
+  const RaggedNDArrayObj* self = operator->();
+  DLDataType dtype = self->data->dtype;
+  size_t slice_bytes = self->inner_size * GetDLDataTypeBytes(dtype);
+  int64_t num_slices = self->row_offsets[self->shape[0]];
+
+  NDArray packed = self->data;
+  if (self->data->ctx.device_type != kDLCPU) {
+    packed = NDArray::RaggedEmpty(self->shape, num_slices * self->inner_size, dtype, CPUContext());
+    CopyFlat(self->data, packed, num_slices * slice_bytes);
+  }
+
+  NDArray padded = NDArray::Empty(self->shape, dtype, CPUContext());
+  const char* src = static_cast<const char*>(packed->data) + packed->byte_offset;
+  char* dst = static_cast<char*>(padded->data);
+  int64_t row_bytes = self->shape[1] * slice_bytes;
+  for (int64_t i = 0; i < self->shape[0]; ++i) {
+    int64_t len_bytes = (self->row_offsets[i + 1] - self->row_offsets[i]) * slice_bytes;
+    std::memcpy(dst + i * row_bytes, src + self->row_offsets[i] * slice_bytes, len_bytes);
+    std::memset(dst + i * row_bytes + len_bytes, 0, row_bytes - len_bytes);
+  }
+  return padded;
+}
+
+NDArray RaggedNDArray::Row(int64_t i) const {
+  const RaggedNDArrayObj* self = operator->();
+  CHECK(i >= 0 && i < self->shape[0]) << "Row " << i << " out of bounds";
+
+  RowViewContext* view = new RowViewContext();
+  view->parent = self->data;
+  view->shape = std::vector<int64_t>(self->shape.begin() + 1, self->shape.end());
+  view->shape[0] = self->row_offsets[i + 1] - self->row_offsets[i];
+
+  DLTensor& tensor = view->managed.dl_tensor;
+  tensor = *(self->data.operator->());
+  tensor.ndim = static_cast<int>(view->shape.size());
+  tensor.shape = view->shape.data();
+  tensor.strides = nullptr;
+  tensor.byte_offset +=
+      self->row_offsets[i] * self->inner_size * GetDLDataTypeBytes(self->data->dtype);
+  view->managed.manager_ctx = view;
+  view->managed.deleter = RowViewDeleter;
+  return NDArray::FromDLPack(&view->managed);
+}
+
+TVM_REGISTER_OBJECT_TYPE(RaggedNDArrayObj);
+
+// Arguments: lengths, dtype, device_type, device_id, shape...
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayEmpty")
+    .set_body([](TVMArgs args, TVMRetValue* rv) {
+      DLDataType dtype = args[1];
+      TVMContext ctx;
+      ctx.device_type = static_cast<DLDeviceType>(args[2].operator int());
+      ctx.device_id = args[3];
+      std::vector<int64_t> shape;
+      for (int i = 4; i < args.size(); ++i) {
+        shape.push_back(args[i].operator int64_t());
+      }
+      *rv = RaggedNDArray::Empty(shape, args[0], dtype, ctx);
+    });
+
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayFromPadded")
+    .set_body([](TVMArgs args, TVMRetValue* rv) {
+      TVMContext ctx;
+      ctx.device_type = static_cast<DLDeviceType>(args[2].operator int());
+      ctx.device_id = args[3];
+      *rv = RaggedNDArray::FromPadded(args[0], args[1], ctx);
+    });
+
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayToPadded").set_body_typed([](RaggedNDArray arr) {
+  return arr.ToPadded();
+});
+
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayRow").set_body_typed([](RaggedNDArray arr, int64_t i) {
+  return arr.Row(i);
+});
+
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayData").set_body_typed([](RaggedNDArray arr) {
+  return arr->data;
+});
+
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayLengths").set_body_typed([](RaggedNDArray arr) {
+  return arr->lengths;
+});
+
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayNDim").set_body_typed([](RaggedNDArray arr) {
+  return static_cast<int64_t>(arr->shape.size());
+});
+
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayShape").set_body_typed([](RaggedNDArray arr, int i) {
+  CHECK_GE(i, 0) << "Dimension " << i << " out of bounds";
+  CHECK_LT(i, static_cast<int>(arr->shape.size())) << "Dimension " << i << " out of bounds";
+  return arr->shape[i];
+});
+
+// Row offsets are defined for i in [0, batch], the last one being the
+// total number of slices.
+TVM_REGISTER_GLOBAL("runtime.RaggedNDArrayRowOffset").set_body_typed([](RaggedNDArray arr,
+                                                                         int64_t i) {
+  CHECK_GE(i, 0) << "Row " << i << " out of bounds";
+  CHECK_LT(i, static_cast<int64_t>(arr->row_offsets.size())) << "Row " << i << " out of bounds";
+  return arr->row_offsets[i];
+});
+
+}  // namespace runtime
+}  // namespace tvm
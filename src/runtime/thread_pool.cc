@@ -464,3 +464,10 @@ int TVMBackendParallelBarrier(int task_id, TVMParallelGroupEnv* penv) {
 #endif
   return 0;
 }
+
+int64_t TVMBackendParallelNextChunk(void* counter, int64_t chunk_size) {
+  // The same for the OpenMP and the thread pool backends: the tasks
+  // only share the counter.
+  return reinterpret_cast<std::atomic<int64_t>*>(counter)->fetch_add(
+      chunk_size, std::memory_order_relaxed);
+}
@@ -0,0 +1,110 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file compile_profiler.cc
+ */
+#include "compile_profiler.h"
+
+#include <tvm/runtime/registry.h>
+#include <tvm/tir/expr.h>
+
+#include <chrono>
+
+namespace tvm {
+namespace support {
+
+CompileProfiler* CompileProfiler::Global() {
+  static CompileProfiler inst;
+  return &inst;
+}
+
+CompileSnapshot CompileProfiler::Snapshot() const {
+  CompileSnapshot ret;
+  ret.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+  for (int i = 0; i < kNumCompileCounters; ++i) {
+    ret.counters[i] = ThreadCounters()[i];
+  }
+  return ret;
+}
+
+void CompileProfiler::Record(const std::string& name, const CompileSnapshot& start) {
+  CompileSnapshot end = Snapshot();
+  CompileEvent event;
+  event.name = name;
+  event.start_us = start.time_us;
+  event.dur_us = end.time_us - start.time_us;
+  event.thread_id = ThreadId();
+  for (int i = 0; i < kNumCompileCounters; ++i) {
+    event.counters[i] = end.counters[i] - start.counters[i];
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back(std::move(event));
+}
+
+std::vector<CompileEvent> CompileProfiler::TakeEvents() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<CompileEvent> ret;
+  ret.swap(events_);
+  return ret;
+}
+
+int64_t CompileProfiler::ThreadId() {
+  static std::atomic<int64_t> next_id{0};
+  static thread_local int64_t id = next_id.fetch_add(1);
+  return id;
+}
+
+TVM_REGISTER_GLOBAL("driver.CompileProfilerSetEnabled").set_body_typed([](bool enabled) {
+  CompileProfiler::Global()->SetEnabled(enabled);
+});
+
+// [time_us, thread_id, counters...], for the phases recorded from python.
+TVM_REGISTER_GLOBAL("driver.CompileProfilerSnapshot").set_body_typed([]() {
+  CompileSnapshot snapshot = CompileProfiler::Global()->Snapshot();
+  Array<PrimExpr> ret;
+  ret.push_back(IntImm(DataType::Int(64), snapshot.time_us));
+  ret.push_back(IntImm(DataType::Int(64), CompileProfiler::ThreadId()));
+  for (int i = 0; i < kNumCompileCounters; ++i) {
+    ret.push_back(IntImm(DataType::Int(64), snapshot.counters[i]));
+  }
+  return ret;
+});
+
+// [name, start_us, dur_us, thread_id, counters...] for each phase.
+TVM_REGISTER_GLOBAL("driver.CompileProfilerTakeEvents").set_body_typed([]() {
+  Array<Array<PrimExpr>> ret;
+  for (const auto& event : CompileProfiler::Global()->TakeEvents()) {
+    Array<PrimExpr> entry;
+    entry.push_back(tir::StringImmNode::make(event.name));
+    entry.push_back(IntImm(DataType::Int(64), event.start_us));
+    entry.push_back(IntImm(DataType::Int(64), event.dur_us));
+    entry.push_back(IntImm(DataType::Int(64), event.thread_id));
+    for (int i = 0; i < kNumCompileCounters; ++i) {
+      entry.push_back(IntImm(DataType::Int(64), event.counters[i]));
+    }
+    ret.push_back(entry);
+  }
+  return ret;
+});
+
+}  // namespace support
+}  // namespace tvm
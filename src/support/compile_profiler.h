@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file compile_profiler.h
+ * \brief Recording of the compile time spent in the phases of
+ *  lowering, for tvm.driver.CompileProfiler.
+ */
+#ifndef TVM_SUPPORT_COMPILE_PROFILER_H_
+#define TVM_SUPPORT_COMPILE_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace support {
+
+/*! \brief The calls counted while compile profiling is enabled. */
+enum CompileCounter : int {
+  kRewriteSimplify = 0,
+  kCanonicalSimplify = 1,
+  kZ3Query = 2,
+  kZ3SolverCheck = 3,
+  kNumCompileCounters = 4
+};
+
+/*! \brief The time, in us, and the counters at some point. */
+struct CompileSnapshot {
+  int64_t time_us;
+  int64_t counters[kNumCompileCounters];
+};
+
+/*! \brief A phase of the compilation, with the counters incremented
+ *  while it ran. */
+struct CompileEvent {
+  std::string name;
+  int64_t start_us;
+  int64_t dur_us;
+  int64_t thread_id;
+  int64_t counters[kNumCompileCounters];
+};
+
+/*!
+ * \brief Global recorder of compile phases. Nothing is counted nor
+ *  recorded unless it is enabled, so that the instrumentation costs a
+ *  load and a branch otherwise. The counters are per thread: a phase
+ *  counts the calls made on the thread it ran on, not the ones of the
+ *  phases running concurrently on other threads.
+ */
+class CompileProfiler {
+ public:
+  static CompileProfiler* Global();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  void SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+  static inline void Count(CompileCounter counter) {
+    if (Global()->enabled()) ++ThreadCounters()[counter];
+  }
+
+  /*! \brief The time now and the counters of the current thread. */
+  CompileSnapshot Snapshot() const;
+
+  /*! \brief Record a phase that started at start and ends now. */
+  void Record(const std::string& name, const CompileSnapshot& start);
+
+  /*! \brief Remove and return the recorded phases. */
+  std::vector<CompileEvent> TakeEvents();
+
+  /*! \brief A small id of the current thread, for the trace. */
+  static int64_t ThreadId();
+
+ private:
+  static inline int64_t* ThreadCounters() {
+    static thread_local int64_t counters[kNumCompileCounters] = {};
+    return counters;
+  }
+
+  std::atomic<bool> enabled_{false};
+  std::mutex mutex_;
+  std::vector<CompileEvent> events_;
+};
+
+/*!
+ * \brief Record the phase spanning the lifetime of the scope, if
+ *  compile profiling is enabled. Scopes nest.
+ */
+class CompileProfileScope {
+ public:
+  explicit CompileProfileScope(const char* name) {
+    CompileProfiler* p = CompileProfiler::Global();
+    if (p->enabled()) {
+      name_ = name;
+      start_ = p->Snapshot();
+    }
+  }
+
+  ~CompileProfileScope() { End(); }
+
+  /*! \brief End the phase before the end of the scope. */
+  void End() {
+    if (name_ != nullptr) CompileProfiler::Global()->Record(name_, start_);
+    name_ = nullptr;
+  }
+
+ private:
+  const char* name_{nullptr};
+  CompileSnapshot start_;
+};
+
+}  // namespace support
+}  // namespace tvm
+
+#endif  // TVM_SUPPORT_COMPILE_PROFILER_H_
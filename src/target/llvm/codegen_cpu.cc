@@ -26,9 +26,11 @@
 
 #include <tvm/runtime/c_runtime_api.h>
 #include <tvm/tir/ir_pass.h>
+#include <tvm/tir/stmt_functor.h>
 
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace tvm {
 namespace codegen {
@@ -67,6 +69,8 @@ void CodeGenCPU::Init(const std::string& module_name, llvm::TargetMachine* tm,
       t_int_, {ftype_tvm_parallel_lambda_->getPointerTo(), t_void_p_, t_int_}, false);
   ftype_tvm_parallel_barrier_ =
       llvm::FunctionType::get(t_int_, {t_int_, t_tvm_parallel_group_env_->getPointerTo()}, false);
+  ftype_tvm_parallel_next_chunk_ =
+      llvm::FunctionType::get(t_int64_, {t_void_p_, t_int64_}, false);
   ftype_tvm_static_init_callback_ = llvm::FunctionType::get(t_int_, {t_void_p_}, false);
   ftype_tvm_static_init_ =
       llvm::FunctionType::get(t_int_,
@@ -97,6 +101,9 @@ void CodeGenCPU::Init(const std::string& module_name, llvm::TargetMachine* tm,
     f_tvm_parallel_barrier_ =
         llvm::Function::Create(ftype_tvm_parallel_barrier_, llvm::Function::ExternalLinkage,
                                "TVMBackendParallelBarrier", module_.get());
+    f_tvm_parallel_next_chunk_ =
+        llvm::Function::Create(ftype_tvm_parallel_next_chunk_, llvm::Function::ExternalLinkage,
+                               "TVMBackendParallelNextChunk", module_.get());
   }
   this->InitGlobalContext(dynamic_lookup);
 }
@@ -350,6 +357,8 @@ void CodeGenCPU::InitGlobalContext(bool dynamic_lookup) {
           InitContextPtr(ftype_tvm_parallel_launch_->getPointerTo(), "__TVMBackendParallelLaunch");
       gv_tvm_parallel_barrier_ = InitContextPtr(ftype_tvm_parallel_barrier_->getPointerTo(),
                                                 "__TVMBackendParallelBarrier");
+      gv_tvm_parallel_next_chunk_ = InitContextPtr(
+          ftype_tvm_parallel_next_chunk_->getPointerTo(), "__TVMBackendParallelNextChunk");
       // Mark as context functions
       gv_func_map_["TVMBackendAllocWorkspace"] = nullptr;
       gv_func_map_["TVMBackendFreeWorkspace"] = nullptr;
@@ -457,8 +466,27 @@ void CodeGenCPU::CreateParallelLaunch(const Stmt& body, int num_task) {
   llvm::Function* f =
       llvm::Function::Create(ftype_tvm_parallel_lambda_, llvm::Function::PrivateLinkage,
                              "__tvm_parallel_lambda", module_.get());
+  // The chunk counters of the dynamically scheduled loops of the
+  // launch live in the launching function and are shared with the
+  // tasks through the closure. They are reset before every launch.
+  Array<Var> counters;
+  std::vector<const Object*> dynamic_attrs;
+  tir::PostOrderVisit(body, [&](const ObjectRef& n) {
+    const AttrStmtNode* attr = n.as<AttrStmtNode>();
+    if (attr == nullptr || attr->attr_key != "pragma_parallel_dynamic") return;
+    Var counter("dynamic_chunk_counter", DataType::Handle());
+    llvm::Value* ptr = WithFunctionEntry([&]() { return builder_->CreateAlloca(t_int64_); });
+    builder_->CreateStore(llvm::ConstantInt::get(t_int64_, 0), ptr);
+    var_map_[counter.get()] = builder_->CreatePointerCast(ptr, t_void_p_);
+    dynamic_counters_[attr] = counter;
+    dynamic_attrs.push_back(attr);
+    counters.push_back(counter);
+  });
   // allocate and setup the closure, call the closure.
   Array<Var> vfields = tir::UndefinedVars(body, {});
+  for (const Var& counter : counters) {
+    vfields.push_back(counter);
+  }
   uint64_t nbytes;
   llvm::Value* cdata = PackClosureData(vfields, &nbytes);
   BasicBlock* par_launch_end = CheckCallSuccess(builder_->CreateCall(
@@ -492,9 +520,102 @@ void CodeGenCPU::CreateParallelLaunch(const Stmt& body, int num_task) {
   std::swap(parallel_env_, par_env);
   std::swap(function_, f);
   CHECK_NE(par_env.parallel_loop_count, 0) << "Cannot find parallel loop within parallel launch";
+  for (const Var& counter : counters) {
+    var_map_.erase(counter.get());
+  }
+  for (const Object* attr : dynamic_attrs) {
+    dynamic_counters_.erase(attr);
+  }
   builder_->SetInsertPoint(par_launch_end);
 }
 
+void CodeGenCPU::CreateDynamicParallelFor(const ForNode* op) {
+  using llvm::BasicBlock;
+  DataType t = op->extent.dtype();
+  llvm::Value* extent = MakeValue(op->extent);
+  llvm::Value* chunk = MakeValue(cast(t, parallel_env_.dynamic_chunk));
+  llvm::Value* counter = MakeValue(parallel_env_.dynamic_counter);
+  BasicBlock* claim_block = BasicBlock::Create(*ctx_, "dynamic_chunk_claim", function_);
+  BasicBlock* body_block = BasicBlock::Create(*ctx_, "dynamic_chunk_body", function_);
+  BasicBlock* end_block = BasicBlock::Create(*ctx_, "dynamic_chunk_end", function_);
+  builder_->CreateBr(claim_block);
+  // Claim chunks until the loop is exhausted.
+  builder_->SetInsertPoint(claim_block);
+  llvm::Value* begin = builder_->CreateCall(
+      RuntimeTVMParallelNextChunk(), {counter, builder_->CreateSExtOrTrunc(chunk, t_int64_)});
+  // Compare in 64 bits, as the counter may go past the extent.
+  builder_->CreateCondBr(
+      builder_->CreateICmpSLT(begin, builder_->CreateSExtOrTrunc(extent, t_int64_)), body_block,
+      end_block);
+  builder_->SetInsertPoint(body_block);
+  begin = builder_->CreateTrunc(begin, extent->getType());
+  llvm::Value* end = CreateAdd(t, begin, chunk);
+  end = builder_->CreateSelect(CreateLT(t, end, extent), end, extent);
+  CreateSerialFor(begin, end, ConstInt32(1), op->loop_var, op->body);
+  builder_->CreateBr(claim_block);
+  builder_->SetInsertPoint(end_block);
+}
+
+void CodeGenCPU::CreateBalancedParallelFor(const ForNode* op, const PrimExpr& cost) {
+  llvm::Value* extent = MakeValue(op->extent);
+  llvm::Value* task_id = builder_->CreateSExt(MakeValue(parallel_env_.task_id), t_int64_);
+  llvm::Value* num_task = builder_->CreateSExt(MakeValue(parallel_env_.num_task), t_int64_);
+  llvm::Value* one = llvm::ConstantInt::get(t_int64_, 1);
+  // Task t runs the iterations whose cumulative cost is in
+  // [t * total / num_task, (t + 1) * total / num_task). The bounds of
+  // adjacent tasks are found with the same target, so the tasks
+  // cover the loop without overlap.
+  llvm::Value* total = MakeCostAt(cost, op->loop_var, extent);
+  llvm::Value* begin_target = builder_->CreateSDiv(builder_->CreateMul(total, task_id), num_task);
+  llvm::Value* end_target =
+      builder_->CreateSDiv(builder_->CreateMul(total, builder_->CreateAdd(task_id, one)), num_task);
+  llvm::Value* begin = CreateCostLowerBound(cost, op->loop_var, extent, begin_target);
+  llvm::Value* end = CreateCostLowerBound(cost, op->loop_var, extent, end_target);
+  // Trailing iterations without cost go to the last task.
+  end = builder_->CreateSelect(builder_->CreateICmpEQ(builder_->CreateAdd(task_id, one), num_task),
+                               extent, end);
+  CreateSerialFor(begin, end, ConstInt32(1), op->loop_var, op->body);
+}
+
+llvm::Value* CodeGenCPU::MakeCostAt(const PrimExpr& cost, const Var& var, llvm::Value* value) {
+  CHECK(!var_map_.count(var.get()));
+  var_map_[var.get()] = value;
+  llvm::Value* ret = MakeValue(cost);
+  var_map_.erase(var.get());
+  return builder_->CreateSExtOrTrunc(ret, t_int64_);
+}
+
+llvm::Value* CodeGenCPU::CreateCostLowerBound(const PrimExpr& cost, const Var& var,
+                                              llvm::Value* extent, llvm::Value* target) {
+  using llvm::BasicBlock;
+  llvm::Type* t = extent->getType();
+  llvm::AllocaInst* lo = WithFunctionEntry([&]() { return builder_->CreateAlloca(t); });
+  llvm::AllocaInst* hi = WithFunctionEntry([&]() { return builder_->CreateAlloca(t); });
+  builder_->CreateStore(llvm::ConstantInt::get(t, 0), lo);
+  builder_->CreateStore(extent, hi);
+  BasicBlock* cond_block = BasicBlock::Create(*ctx_, "cost_search_cond", function_);
+  BasicBlock* body_block = BasicBlock::Create(*ctx_, "cost_search_body", function_);
+  BasicBlock* end_block = BasicBlock::Create(*ctx_, "cost_search_end", function_);
+  builder_->CreateBr(cond_block);
+  builder_->SetInsertPoint(cond_block);
+  llvm::Value* not_found =
+      builder_->CreateICmpSLT(builder_->CreateLoad(lo), builder_->CreateLoad(hi));
+  builder_->CreateCondBr(not_found, body_block, end_block);
+  // Binary search, the cumulative cost being non decreasing.
+  builder_->SetInsertPoint(body_block);
+  llvm::Value* lo_value = builder_->CreateLoad(lo);
+  llvm::Value* hi_value = builder_->CreateLoad(hi);
+  llvm::Value* half = builder_->CreateAShr(builder_->CreateSub(hi_value, lo_value), 1);
+  llvm::Value* mid = builder_->CreateAdd(lo_value, half);
+  llvm::Value* below = builder_->CreateICmpSLT(MakeCostAt(cost, var, mid), target);
+  llvm::Value* next = builder_->CreateAdd(mid, llvm::ConstantInt::get(t, 1));
+  builder_->CreateStore(builder_->CreateSelect(below, next, lo_value), lo);
+  builder_->CreateStore(builder_->CreateSelect(below, hi_value, mid), hi);
+  builder_->CreateBr(cond_block);
+  builder_->SetInsertPoint(end_block);
+  return builder_->CreateLoad(lo);
+}
+
 llvm::Value* CodeGenCPU::CreateStaticHandle() {
   llvm::GlobalVariable* gv = new llvm::GlobalVariable(
       *module_, t_void_p_, false, llvm::GlobalValue::PrivateLinkage, 0, "__tvm_static_handle");
@@ -688,6 +809,11 @@ llvm::Value* CodeGenCPU::RuntimeTVMParallelBarrier() {
   return GetContextPtr(gv_tvm_parallel_barrier_);
 }
 
+llvm::Value* CodeGenCPU::RuntimeTVMParallelNextChunk() {
+  if (f_tvm_parallel_next_chunk_ != nullptr) return f_tvm_parallel_next_chunk_;
+  return GetContextPtr(gv_tvm_parallel_next_chunk_);
+}
+
 void CodeGenCPU::AddStartupFunction() {
   if (export_system_symbols_.size() != 0) {
     llvm::FunctionType* ftype = llvm::FunctionType::get(t_void_, {}, false);
@@ -796,6 +922,27 @@ void CodeGenCPU::VisitStmt_(const AttrStmtNode* op) {
       this->VisitStmt(op->body);
     } else if (op->attr_key == "pragma_parallel_launch_point") {
       CreateParallelLaunch(op->body, 0);
+    } else if (op->attr_key == "pragma_parallel_dynamic") {
+      // Hand out the iterations of the parallel loop below in chunks
+      // of op->value iterations on demand, instead of splitting them
+      // evenly between the tasks ahead of time.
+      if (parallel_env_.penv == nullptr) {
+        // Launch here, so that the launch allocates the chunk counter.
+        CreateParallelLaunch(GetRef<Stmt>(op), 0);
+      } else {
+        auto it = dynamic_counters_.find(op);
+        CHECK(it != dynamic_counters_.end());
+        CHECK(!parallel_env_.stride_pattern)
+            << "Pragma parallel_dynamic cannot be used with parallel_stride_pattern";
+        const IntImmNode* chunk = op->value.as<IntImmNode>();
+        CHECK(chunk != nullptr && chunk->value > 0)
+            << "The chunk of pragma parallel_dynamic should be a positive integer constant";
+        parallel_env_.dynamic_counter = it->second;
+        parallel_env_.dynamic_chunk = op->value;
+        this->VisitStmt(op->body);
+        CHECK(!parallel_env_.dynamic_counter.defined())
+            << "Pragma parallel_dynamic should be placed on a parallel loop";
+      }
     } else if (op->attr_key == "pragma_parallel_barrier_when_finish") {
       CHECK(parallel_env_.penv != nullptr) << "Cannot run barrier without parallel environment";
       // CHECK(!parallel_env_.in_parallel_loop)
@@ -839,9 +986,16 @@ void CodeGenCPU::VisitStmt_(const ForNode* op) {
       CHECK(!parallel_env_.in_parallel_loop)
           << "Nested parallel loop is not supported by threadpool, try fuse them instead";
       parallel_env_.in_parallel_loop = true;
-      if (parallel_env_.stride_pattern) {
+      const AttrStmtNode* cost = FindBalancedCost(op->body);
+      if (parallel_env_.dynamic_counter.defined()) {
+        CreateDynamicParallelFor(op);
+        parallel_env_.dynamic_counter = Var();
+        parallel_env_.dynamic_chunk = PrimExpr();
+      } else if (parallel_env_.stride_pattern) {
         CreateSerialFor(MakeValue(task_id), MakeValue(op->extent), MakeValue(num_task),
                         op->loop_var, op->body);
+      } else if (cost != nullptr) {
+        CreateBalancedParallelFor(op, cost->value);
       } else {
         PrimExpr step = (op->extent + num_task - make_const(t, 1)) / num_task;
         PrimExpr begin = MinNode::make(task_id * step, op->extent);
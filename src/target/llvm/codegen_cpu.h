@@ -69,6 +69,7 @@ class CodeGenCPU : public CodeGenLLVM {
   llvm::FunctionType* ftype_tvm_api_set_last_error_{nullptr};
   llvm::FunctionType* ftype_tvm_parallel_launch_{nullptr};
   llvm::FunctionType* ftype_tvm_parallel_barrier_{nullptr};
+  llvm::FunctionType* ftype_tvm_parallel_next_chunk_{nullptr};
   llvm::FunctionType* ftype_tvm_register_system_symbol_{nullptr};
   // Lazy entry for function call.
   llvm::FunctionType* ftype_tvm_static_init_callback_{nullptr};
@@ -83,6 +84,10 @@ class CodeGenCPU : public CodeGenLLVM {
     bool in_parallel_loop{false};
     int parallel_loop_count{0};
     llvm::Value* penv{nullptr};
+    // chunk counter and chunk size of the dynamically scheduled
+    // parallel loop being generated, if any.
+    Var dynamic_counter;
+    PrimExpr dynamic_chunk;
   };
   // Get runtime functions
   void InitGlobalContext(bool dynamic_lookup);
@@ -93,6 +98,7 @@ class CodeGenCPU : public CodeGenLLVM {
   llvm::Value* RuntimeTVMAPISetLastError();
   llvm::Value* RuntimeTVMParallelLaunch();
   llvm::Value* RuntimeTVMParallelBarrier();
+  llvm::Value* RuntimeTVMParallelNextChunk();
   llvm::Value* CreateStaticHandle();
   llvm::Value* GetPackedFuncHandle(const std::string& str);
   llvm::Value* PackClosureData(const Array<Var>& fields, uint64_t *num_bytes);
@@ -113,6 +119,16 @@ class CodeGenCPU : public CodeGenLLVM {
   void CreateStaticInit(const std::string& init_fname, const Stmt& body);
   // Create parallel launch
   void CreateParallelLaunch(const Stmt& body, int num_task);
+  // Create the chunk loop of a dynamically scheduled parallel loop
+  void CreateDynamicParallelFor(const ForNode* op);
+  // Create the loop of a parallel loop split by equal cumulative cost
+  void CreateBalancedParallelFor(const ForNode* op, const PrimExpr& cost);
+  // Evaluate the cumulative cost, a function of var, at value
+  llvm::Value* MakeCostAt(const PrimExpr& cost, const Var& var, llvm::Value* value);
+  // Find the first value of var in [0, extent) with a cumulative cost
+  // of at least target, extent if there is none
+  llvm::Value* CreateCostLowerBound(const PrimExpr& cost, const Var& var, llvm::Value* extent,
+                                    llvm::Value* target);
   // Create a new compute scope.
   void CreateComputeScope(const AttrStmtNode* op);
   // Check if the call to packed function is successful
@@ -126,6 +142,7 @@ class CodeGenCPU : public CodeGenLLVM {
   llvm::GlobalVariable* gv_tvm_api_set_last_error_{nullptr};
   llvm::GlobalVariable* gv_tvm_parallel_launch_{nullptr};
   llvm::GlobalVariable* gv_tvm_parallel_barrier_{nullptr};
+  llvm::GlobalVariable* gv_tvm_parallel_next_chunk_{nullptr};
   std::unordered_map<std::string, llvm::GlobalVariable*> gv_func_map_;
   // context for direct dynamic lookup
   llvm::Function* f_tvm_func_call_{nullptr};
@@ -133,9 +150,13 @@ class CodeGenCPU : public CodeGenLLVM {
   llvm::Function* f_tvm_api_set_last_error_{nullptr};
   llvm::Function* f_tvm_parallel_launch_{nullptr};
   llvm::Function* f_tvm_parallel_barrier_{nullptr};
+  llvm::Function* f_tvm_parallel_next_chunk_{nullptr};
   llvm::Function* f_tvm_register_system_symbol_{nullptr};
   // Current parallel environment scope.
   ParallelEnv parallel_env_;
+  // The chunk counters of the parallel_dynamic pragmas in the
+  // current parallel launch.
+  std::unordered_map<const Object*, Var> dynamic_counters_;
   // global to packed function handle
   std::unordered_map<std::string, llvm::GlobalVariable*> func_handle_map_;
   // List of symbols to be exported to TVM system lib.
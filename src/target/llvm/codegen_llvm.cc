@@ -165,6 +165,12 @@ std::unique_ptr<llvm::Module> CodeGenLLVM::Finish() {
   }
   link_modules_.clear();
   // optimize
+  if (optimize_) this->Optimize();
+  return std::move(module_);
+}
+
+std::unique_ptr<llvm::Module> CodeGenLLVM::OptimizeLinked(std::unique_ptr<llvm::Module> module) {
+  module_ = std::move(module);
   this->Optimize();
   return std::move(module_);
 }
@@ -890,6 +896,9 @@ llvm::Value* CodeGenLLVM::VisitExpr_(const LoadNode* op) {
   bool is_volatile = volatile_buf_.count(op->buffer_var.get());
   llvm::Value* buffer = MakeValue(op->buffer_var);
   llvm::Value* index = MakeValue(op->index);
+  if (t.lanes() > 1 && !is_one(op->predicate)) {
+    return CreatePredicatedLoad(op, buffer, index);
+  }
 
   if (t.lanes() == 1) {
     int alignment, native_bits;
@@ -927,6 +936,40 @@ llvm::Value* CodeGenLLVM::VisitExpr_(const LoadNode* op) {
   return ret;
 }
 
+// Contiguous accesses become llvm.masked.load, which the x86 backend
+// lowers to vmaskmov on AVX/AVX2 and to masked moves on AVX-512. Other
+// accesses become llvm.masked.gather. Disabled lanes read as zero.
+llvm::Value* CodeGenLLVM::CreatePredicatedLoad(const LoadNode* op, llvm::Value* buffer,
+                                               llvm::Value* index) {
+  DataType t = op->dtype;
+  llvm::Value* mask = MakeValue(op->predicate);
+  llvm::Value* passthru = llvm::Constant::getNullValue(LLVMType(t));
+  llvm::CallInst* load = nullptr;
+  const RampNode* ramp = op->index.as<RampNode>();
+  if (ramp != nullptr && is_one(ramp->stride)) {
+    int alignment, native_bits;
+    GetAlignment(t, op->buffer_var.get(), ramp->base, &alignment, &native_bits);
+    unsigned addrspace = llvm::dyn_cast<llvm::PointerType>(buffer->getType())->getAddressSpace();
+    llvm::Value* ptr = CreateBufferPtr(t.element_of(), buffer, MakeValue(ramp->base));
+    ptr = builder_->CreatePointerCast(ptr, LLVMType(t)->getPointerTo(addrspace));
+#if TVM_LLVM_VERSION >= 100
+    load = builder_->CreateMaskedLoad(ptr, llvm::Align(alignment), mask, passthru);
+#else
+    load = builder_->CreateMaskedLoad(ptr, alignment, mask, passthru);
+#endif
+    AddAliasInfo(load, op->buffer_var.get(), op->index, t);
+  } else {
+    llvm::Value* ptrs = CreateBufferPtr(t.element_of(), buffer, index);
+#if TVM_LLVM_VERSION >= 100
+    load = builder_->CreateMaskedGather(ptrs, llvm::Align(t.bits() / 8), mask, passthru);
+#else
+    load = builder_->CreateMaskedGather(ptrs, t.bits() / 8, mask, passthru);
+#endif
+    AddAliasInfo(load, op->buffer_var.get(), PrimExpr(), t);
+  }
+  return load;
+}
+
 llvm::Value* CodeGenLLVM::VisitExpr_(const CallNode* op) {
   if (op->call_type == CallNode::Intrinsic || op->call_type == CallNode::PureIntrinsic) {
     return CreateIntrinsic(op);
@@ -974,12 +1017,16 @@ llvm::Value* CodeGenLLVM::VisitExpr_(const BroadcastNode* op) {
 }
 
 void CodeGenLLVM::VisitStmt_(const StoreNode* op) {
-  CHECK(is_one(op->predicate));
   DataType t = op->value.dtype();
+  CHECK(t.lanes() > 1 || is_one(op->predicate));
   bool is_volatile = volatile_buf_.count(op->buffer_var.get());
   llvm::Value* buffer = MakeValue(op->buffer_var);
   llvm::Value* index = MakeValue(op->index);
   llvm::Value* value = MakeValue(op->value);
+  if (!is_one(op->predicate)) {
+    CreatePredicatedStore(op, buffer, index, value);
+    return;
+  }
 
   if (t.lanes() == 1) {
     int alignment, native_bits;
@@ -1016,6 +1063,35 @@ void CodeGenLLVM::VisitStmt_(const StoreNode* op) {
   this->Scalarize(op->index, f);
 }
 
+void CodeGenLLVM::CreatePredicatedStore(const StoreNode* op, llvm::Value* buffer,
+                                        llvm::Value* index, llvm::Value* value) {
+  DataType t = op->value.dtype();
+  llvm::Value* mask = MakeValue(op->predicate);
+  const RampNode* ramp = op->index.as<RampNode>();
+  if (ramp != nullptr && is_one(ramp->stride)) {
+    int alignment, native_bits;
+    GetAlignment(t, op->buffer_var.get(), ramp->base, &alignment, &native_bits);
+    unsigned addrspace = llvm::dyn_cast<llvm::PointerType>(buffer->getType())->getAddressSpace();
+    llvm::Value* ptr = CreateBufferPtr(t.element_of(), buffer, MakeValue(ramp->base));
+    ptr = builder_->CreatePointerCast(ptr, LLVMType(t)->getPointerTo(addrspace));
+#if TVM_LLVM_VERSION >= 100
+    llvm::CallInst* store = builder_->CreateMaskedStore(value, ptr, llvm::Align(alignment), mask);
+#else
+    llvm::CallInst* store = builder_->CreateMaskedStore(value, ptr, alignment, mask);
+#endif
+    AddAliasInfo(store, op->buffer_var.get(), op->index, t);
+  } else {
+    llvm::Value* ptrs = CreateBufferPtr(t.element_of(), buffer, index);
+#if TVM_LLVM_VERSION >= 100
+    llvm::CallInst* store =
+        builder_->CreateMaskedScatter(value, ptrs, llvm::Align(t.bits() / 8), mask);
+#else
+    llvm::CallInst* store = builder_->CreateMaskedScatter(value, ptrs, t.bits() / 8, mask);
+#endif
+    AddAliasInfo(store, op->buffer_var.get(), PrimExpr(), t);
+  }
+}
+
 void CodeGenLLVM::VisitStmt_(const ForNode* op) {
   CHECK(is_zero(op->min));
   analyzer_->Bind(op->loop_var, Range::make_by_min_extent(op->min, op->extent));
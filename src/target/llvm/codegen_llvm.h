@@ -89,6 +89,20 @@ class CodeGenLLVM :
    * \return the created module.
    */
   virtual std::unique_ptr<llvm::Module> Finish();
+  /*!
+   * \brief Set whether Finish optimizes the module. Modules generated
+   *  separately and linked are instead optimized once linked, with
+   *  OptimizeLinked.
+   * \param optimize Whether to optimize.
+   */
+  void SetOptimize(bool optimize) { optimize_ = optimize; }
+  /*!
+   * \brief Optimize a module linked from modules finished without
+   *  optimizing, as Finish optimizes the module it generates.
+   * \param module The linked module, in the context of this generator.
+   * \return the optimized module.
+   */
+  std::unique_ptr<llvm::Module> OptimizeLinked(std::unique_ptr<llvm::Module> module);
   /*!
    * \brief Add mod to be linked with the generated module
    * \param mod The module to be linked.
@@ -237,6 +251,10 @@ class CodeGenLLVM :
   llvm::Value* CreateBroadcast(llvm::Value* value, int lanes);
   llvm::Value* CreateBufferPtr(DataType t, llvm::Value* buffer, llvm::Value* index);
   llvm::Value* CreateBufferVecPtr(DataType t, llvm::Value* buffer, llvm::Value* index);
+  // Vector load and store of the lanes enabled by the predicate of op.
+  llvm::Value* CreatePredicatedLoad(const LoadNode* op, llvm::Value* buffer, llvm::Value* index);
+  void CreatePredicatedStore(const StoreNode* op, llvm::Value* buffer, llvm::Value* index,
+                             llvm::Value* value);
   // Vector concatenation.
   llvm::Value* CreateVecSlice(llvm::Value* vec, int begin, int extent);
   llvm::Value* CreateVecFlip(llvm::Value* vec);
@@ -262,6 +280,8 @@ class CodeGenLLVM :
   std::unique_ptr<llvm::MDBuilder> md_builder_;
   // llvm target machine
   llvm::TargetMachine* target_machine_{nullptr};
+  // whether Finish optimizes the module
+  bool optimize_{true};
   // llvm context
   llvm::LLVMContext* ctx_{nullptr};
   // helpful data types
@@ -26,12 +26,15 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/target/codegen.h>
+#include <tvm/target/target.h>
 #include <mutex>
 #include "llvm_common.h"
 #include "codegen_llvm.h"
 #include "codegen_blob.h"
 #include "../../runtime/file_util.h"
 #include "../../runtime/library_module.h"
+#include "../../support/compile_profiler.h"
+#include "../../support/parallel_for.h"
 
 namespace tvm {
 namespace codegen {
@@ -198,14 +201,19 @@ class LLVMModuleNode final : public runtime::ModuleNode {
     bool system_lib = (target.find("-system-lib") != std::string::npos);
     CHECK_NE(funcs.size(), 0U);
     ctx_ = std::make_shared<llvm::LLVMContext>();
-    std::unique_ptr<CodeGenLLVM> cg = CodeGenLLVM::Create(tm_.get());
     entry_func_ = funcs[0]->name;
-    cg->Init(funcs[0]->name, tm_.get(), ctx_.get(), system_lib, system_lib);
-    for (LoweredFunc f :  funcs) {
-      cg->AddFunction(f);
+    if (funcs.size() > 1) {
+      module_ = BuildPerFunction(funcs, target, system_lib,
+                                 BuildConfig::Current()->parallel_build_threads);
+    } else {
+      std::unique_ptr<CodeGenLLVM> cg = CodeGenLLVM::Create(tm_.get());
+      cg->Init(funcs[0]->name, tm_.get(), ctx_.get(), system_lib, system_lib);
+      for (LoweredFunc f :  funcs) {
+        cg->AddFunction(f);
+      }
+      cg->AddMainFunction(funcs[0]->name);
+      module_ = cg->Finish();
     }
-    cg->AddMainFunction(funcs[0]->name);
-    module_ = cg->Finish();
 
     module_->addModuleFlag(llvm::Module::Warning, "tvm_target", llvm::MDString::get(*ctx_, target));
     module_->addModuleFlag(llvm::Module::Override, "Debug Info Version",
@@ -264,6 +272,63 @@ class LLVMModuleNode final : public runtime::ModuleNode {
   }
 
  private:
+  /*!
+   * \brief Generate each function in its own module, on num_threads
+   *  threads, link the modules in the order of funcs and optimize the
+   *  linked module once, as a single generated module is. The threads
+   *  work in their own LLVM context, so the modules are moved to ctx_
+   *  as bitcode. A num_threads of 0 generates the functions on the
+   *  calling thread, so the module does not depend on the number of
+   *  threads.
+   */
+  std::unique_ptr<llvm::Module> BuildPerFunction(const Array<LoweredFunc>& funcs,
+                                                 const std::string& target, bool system_lib,
+                                                 int num_threads) {
+    BuildConfig config = BuildConfig::Current();
+    std::vector<std::string> bitcodes(funcs.size());
+    support::parallel_for(0, static_cast<int>(funcs.size()), num_threads, [&](int i) {
+      With<BuildConfig> config_scope(config);
+      support::CompileProfileScope profile("codegen.llvm.BuildFunction");
+      llvm::LLVMContext ctx;
+      std::unique_ptr<llvm::TargetMachine> tm = GetLLVMTargetMachine(target);
+      std::unique_ptr<CodeGenLLVM> cg = CodeGenLLVM::Create(tm.get());
+      cg->Init(funcs[0]->name, tm.get(), &ctx, system_lib, system_lib);
+      cg->SetOptimize(false);
+      cg->AddFunction(funcs[i]);
+      if (i == 0) cg->AddMainFunction(funcs[0]->name);
+      std::unique_ptr<llvm::Module> module = cg->Finish();
+      llvm::raw_string_ostream os(bitcodes[i]);
+#if TVM_LLVM_VERSION <= 60
+      llvm::WriteBitcodeToFile(module.get(), os);
+#else
+      llvm::WriteBitcodeToFile(*module, os);
+#endif
+      os.flush();
+    });
+
+    support::CompileProfileScope profile("codegen.llvm.Link");
+    std::unique_ptr<llvm::Module> ret;
+    for (size_t i = 0; i < bitcodes.size(); ++i) {
+      llvm::SMDiagnostic err;
+      std::unique_ptr<llvm::Module> module =
+          llvm::parseIR(llvm::MemoryBufferRef(bitcodes[i], funcs[i]->name), err, *ctx_);
+      CHECK(module != nullptr) << "Failed to read back the module of " << funcs[i]->name << ": "
+                               << std::string(err.getMessage());
+      if (ret == nullptr) {
+        ret = std::move(module);
+      } else {
+        CHECK(!llvm::Linker::linkModules(*ret, std::move(module)))
+            << "Failed to link the module of " << funcs[i]->name;
+      }
+    }
+    profile.End();
+
+    support::CompileProfileScope optimize_profile("codegen.llvm.Optimize");
+    std::unique_ptr<CodeGenLLVM> cg = CodeGenLLVM::Create(tm_.get());
+    cg->Init(funcs[0]->name, tm_.get(), ctx_.get(), system_lib, system_lib);
+    return cg->OptimizeLinked(std::move(ret));
+  }
+
   void LazyInitJIT() {
     std::lock_guard<std::mutex> lock(mutex_);
     if (ee_) {
@@ -815,14 +815,18 @@ Stmt BaseComputeOpNode::BuildRealize(const Stage& stage,
     realize = tir::RealizeNode::make(
         t->op, t->value_index, t->dtype, bounds, const_true(), realize,
         stage.is_ancestor_attached_at_root() ? output_layout(t->value_index) : NullValue<Modes>());
-    // alignment requirement, only useful for compute
+    // alignment requirement, only useful for compute. Ragged
+    // dimensions are instead aligned in the storage layout, when the
+    // tensor dimensions are frozen.
+    Modes layout = output_layout(t->value_index);
     for (size_t i = 0; i < stage->dim_relation_graph->leaf_dimensions.size(); ++i) {
       Dimension dim = stage->dim_relation_graph->leaf_dimensions[i];
 
       auto it = stage->align_info.find(dim.as<DimensionNode>());
       if (it != stage->align_info.end()) {
         auto pair = (*it).second;
-        if (pair.first != 0) {
+        bool ragged = layout.defined() && i < layout->ndim() && layout->is_ragged(i);
+        if (pair.first != 0 && !ragged) {
           Array<PrimExpr> tuple = {static_cast<int>(i), pair.first, pair.second};
           realize =
               tir::AttrStmtNode::make(t, tir::attr::buffer_dim_align,
@@ -149,6 +149,25 @@ void IndexLoopVarDeps(const Stage& stage, Array<DimInfo> all_dimensions,
   }
 }
 
+// Annotate the body of the parallel loop over iv, whose loop var is
+// var, with the balanced cost of its iterations. The cost goes right
+// in the body of the loop, ahead of the prefetch attributes, where
+// codegen looks for it first.
+static void MakeBalancedCost(const IterVar& iv, const IterVarAttr& it_attr, ForType for_type,
+                             const Var& var, const PrimExpr& value, std::vector<Stmt>* nest) {
+  if (!it_attr.defined() || !it_attr->balanced_cost.defined()) return;
+  CHECK_EQ(for_type, ForType::Parallel);
+  // The cost is the cumulative cost of the iterations before the
+  // loop var, which codegen evaluates from 0 to the extent.
+  CHECK(!it_attr->permutation.defined())
+      << "balanced_parallel and sort_by_length cannot both be applied to " << iv;
+  CHECK(value.same_as(var)) << "balanced_parallel needs a loop over " << iv
+                            << " starting at 0, but it iterates over " << value;
+  PrimExpr cost = tir::Substitute(it_attr->balanced_cost, Map<Var, PrimExpr>({{iv->var, var}}));
+  nest->emplace_back(AttrStmtNode::make(iv, tir::attr::parallel_balanced_cost, cost,
+                                        EvaluateNode::make(0)));
+}
+
 void MakeLoopNestFromDependentVars(
     const Stage& stage, const std::unordered_map<IterVar, Range>& dom_map, size_t begin_iter_pos,
     bool new_loop_var, const std::unordered_set<IterVar>& skip_iter,
@@ -272,11 +291,23 @@ void MakeLoopNestFromDependentVars(
               AttrStmtNode::make(iv, tir::attr::pragma_scope_prefix + pkey, pvalue, no_op));
         }
       }
-      if (!debug_keep_trivial_loop && is_one(tir::Simplify(dom->extent))) {
+      bool trivial = !debug_keep_trivial_loop && is_one(tir::Simplify(dom->extent));
+      if (trivial) {
         // std::cout << "[MLN]   2" << std::endl;
         CHECK(hfuse_group_id < 0) << "Trying to hfuse iv of extent 1";
         nest[i + 1].emplace_back(LetStmtNode::make(var, dom->min, no_op));
         value_map[iv] = dom->min;
+      } else if (it_attr.defined() && it_attr->permutation.defined()) {
+        // Iterate over sorted positions, each mapped to the position
+        // of the iter var through the permutation
+        CHECK(is_zero(dom->min));
+        Var idx(bind_iv->var->name_hint + ".sorted", bind_iv->var.dtype());
+        nest[i + 1].emplace_back(
+            ForNode::make(idx, 0, dom->extent, for_type, DeviceAPI::None, no_op, hfuse_group_id));
+        PrimExpr new_value = it_attr->permutation.MakeCallTo(Array<PrimExpr>({idx}),
+                                                             it_attr->permutation->dimensions);
+        value_map[iv] = new_value;
+        nest[i + 1].emplace_back(LetStmtNode::make(var, new_value, no_op));
       } else if (is_zero(dom->min)) {
         // std::cout << "[MLN]   3" << std::endl;
         nest[i + 1].emplace_back(
@@ -293,13 +324,16 @@ void MakeLoopNestFromDependentVars(
         nest[i + 1].emplace_back(LetStmtNode::make(var, new_value, no_op));
       }
 
+      if (!trivial) {
+        MakeBalancedCost(iv, it_attr, for_type, var, value_map[iv], &nest[i + 1]);
+      }
       if (it_attr.defined() && it_attr->prefetch_data.size() != 0) {
         CHECK(!is_one(dom->extent)) << "Cannot prefetch on trivial loop with extent=1";
         CHECK_EQ(it_attr->prefetch_data.size(), it_attr->prefetch_offset.size());
         for (size_t j = 0; j < it_attr->prefetch_data.size(); ++j) {
           nest[i + 1].emplace_back(
               AttrStmtNode::make(it_attr->prefetch_data[j], tir::attr::prefetch_scope,
-                                 it_attr->prefetch_offset[j], no_op, hfuse_group_id));
+                                 it_attr->prefetch_offset[j], no_op));
         }
       }
     } else if (bind_iv->thread_tag == "vthread" || bind_iv->thread_tag == "cthread") {
@@ -521,9 +555,19 @@ std::vector<std::vector<Stmt>> MakeLoopNest(const Stage& stage,
         }
       }
       if (print) std::cout << "[MLNi]     Loop type " << for_type << std::endl;
-      if (!debug_keep_trivial_loop && is_one(dom->extent)) {
+      bool trivial = !debug_keep_trivial_loop && is_one(dom->extent);
+      if (trivial) {
         nest[i + 1].emplace_back(LetStmtNode::make(var, dom->min, no_op));
         value_map[iv] = dom->min;
+      } else if (it_attr.defined() && it_attr->permutation.defined()) {
+        CHECK(is_zero(dom->min));
+        Var idx(bind_iv->var->name_hint + ".sorted", bind_iv->var.dtype());
+        nest[i + 1].emplace_back(
+            ForNode::make(idx, 0, dom->extent, for_type, DeviceAPI::None, no_op));
+        PrimExpr new_value = it_attr->permutation.MakeCallTo(Array<PrimExpr>({idx}),
+                                                             it_attr->permutation->dimensions);
+        value_map[iv] = new_value;
+        nest[i + 1].emplace_back(LetStmtNode::make(var, new_value, no_op));
       } else if (is_zero(dom->min)) {
         nest[i + 1].emplace_back(
             ForNode::make(var, 0, dom->extent, for_type, DeviceAPI::None, no_op));
@@ -538,6 +582,9 @@ std::vector<std::vector<Stmt>> MakeLoopNest(const Stage& stage,
         // std::cout << "YO11 " << new_value << std::endl;
         nest[i + 1].emplace_back(LetStmtNode::make(var, new_value, no_op));
       }
+      if (!trivial) {
+        MakeBalancedCost(iv, it_attr, for_type, var, value_map[iv], &nest[i + 1]);
+      }
       if (it_attr.defined() && it_attr->prefetch_data.size() != 0) {
         CHECK(!is_one(dom->extent)) << "Cannot prefetch on trivial loop with extent=1";
         CHECK_EQ(it_attr->prefetch_data.size(), it_attr->prefetch_offset.size());
@@ -588,6 +635,23 @@ std::vector<std::vector<Stmt>> MakeLoopNest(const Stage& stage,
         extent = bind_iv->dom->extent;
       }
 
+      // The parallel_dynamic pragma asking for the persistent workers
+      // of a single kernel goes around the thread extent, which
+      // becomes a loop on CPU targets. Other pragmas on env threads
+      // are not emitted.
+      if (stage->op.as<SingleKernelEnvelopeOpNode>() && stage->iter_var_attrs.count(iv)) {
+        IterVarAttr it_attr = stage->iter_var_attrs[iv];
+        for (size_t k = 0; k < it_attr->pragma_keys.size(); ++k) {
+          const std::string& pkey = it_attr->pragma_keys[k].as<StringImmNode>()->value;
+          if (pkey != "parallel_dynamic") continue;
+          PrimExpr pvalue = it_attr->pragma_values[k];
+          if (!pvalue.defined()) {
+            pvalue = make_const(DataType::Int(32), 1);
+          }
+          nest[i + 1].emplace_back(
+              AttrStmtNode::make(iv, tir::attr::pragma_scope_prefix + pkey, pvalue, no_op));
+        }
+      }
       // annotate the extent of the IterVar
       nest[i + 1].emplace_back(
           AttrStmtNode::make(bind_iv, tir::attr::thread_extent, extent, no_op));
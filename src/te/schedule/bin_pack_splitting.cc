@@ -1,8 +1,10 @@
 #include <tvm/te/operation.h>
 #include <tvm/te/schedule.h>
+#include <tvm/tir/ir_pass.h>
 #include <tvm/tir/stmt_functor.h>
 
 #include <algorithm>
+#include <vector>
 
 #include "../operation/op_util.h"
 #include "graph.h"
@@ -14,8 +16,8 @@ namespace tvm {
 namespace te {
 
 Array<Operation> SplitALoop(Schedule& sch, Operation op, size_t to_split_index,
-                            UninterpFun split_point, std::unordered_map<Tensor, Tensor> graph1_vsub,
-                            std::unordered_map<Tensor, Tensor> graph2_vsub) {
+                            Array<UninterpFun> split_points,
+                            const std::vector<std::unordered_map<Tensor, Tensor>>& graph_vsubs) {
   sch->InvalidateCache();
   Stage s = sch.operator[](op);
   // CHECK(s->is_output)
@@ -23,185 +25,161 @@ Array<Operation> SplitALoop(Schedule& sch, Operation op, size_t to_split_index,
 
   auto compute_op = op.as<ComputeOpNode>();
   CHECK(compute_op) << "Loop splitting for bin packing is currently allowed only for ComputeOp";
-
-  std::unordered_map<const VarNode*, PrimExpr> op1_vsub;
-  std::unordered_map<const VarNode*, PrimExpr> op2_vsub;
+  CHECK_GT(split_points.size(), 0);
+  size_t num_tiers = split_points.size() + 1;
+  CHECK_EQ(graph_vsubs.size(), num_tiers);
+
+  // Tier t iterates over [split_points[t - 1], split_points[t]) along
+  // the split loop, where the first and the last tier start and end at
+  // the bounds of the original loop.
+  struct Tier {
+    std::unordered_map<const VarNode*, PrimExpr> vsub;
+    Array<IterVar> axis;
+    Array<Var> vars;
+    Array<Dimension> dims;
+    Array<UninterpFun> min_ufs;
+    Array<UninterpFun> ext_ufs;
+    Array<PrimExpr> maxes;
+    Array<IterVar> red_axis;
+    Array<PrimExpr> body;
+    Array<PrimExpr> pred;
+  };
+  std::vector<Tier> tiers(num_tiers);
 
   Modes loop_layout = compute_op->loop_layout();
-  Array<IterVar> op1_axis;
-  Array<IterVar> op2_axis;
-  Array<Var> op1_vars;
-  Array<Var> op2_vars;
-  Array<Dimension> op1_dims;
-  Array<Dimension> op2_dims;
-  Array<UninterpFun> op1_min_ufs;
-  Array<UninterpFun> op2_min_ufs;
-  Array<UninterpFun> op1_ext_ufs;
-  Array<UninterpFun> op2_ext_ufs;
-  Array<PrimExpr> op1_maxes;
-  Array<PrimExpr> op2_maxes;
   for (size_t i = 0; i < compute_op->axis.size(); ++i) {
     auto orig_iv = compute_op->axis[i];
     auto orig_dim = compute_op->root_index_dimensions[i];
-    IterVar iv1;
-    IterVar iv2;
-    auto var1 = Var("iv1" + std::to_string(i), orig_iv->var.dtype());
-    auto var2 = Var("iv2" + std::to_string(i), orig_iv->var.dtype());
-    VarReplacer op1_replacer(op1_vsub);
-    VarReplacer op2_replacer(op2_vsub);
-    if (i == to_split_index) {
-      iv1 = IterVarNode::make(
-          Range::make_by_min_max_exclusive(op1_replacer(orig_iv->dom->min),
-                                           split_point.MakeCallTo(op1_vars, op1_dims)),
-          var1, orig_iv->iter_type);
-      iv2 = IterVarNode::make(
-          Range::make_by_min_max_exclusive(split_point.MakeCallTo(op2_vars, op2_dims),
-                                           op2_replacer(orig_iv->dom->max_exclusive())),
-          var2, orig_iv->iter_type);
-      op1_min_ufs.push_back(loop_layout->l_fun_mins[i]);
-      op1_ext_ufs.push_back(split_point);
-      op2_min_ufs.push_back(split_point);
-      op2_ext_ufs.push_back(loop_layout->l_funs[i]);
-    } else {
-      iv1 = IterVarNode::make(op1_replacer.replace(orig_iv->dom), var1, orig_iv->iter_type);
-      iv2 = IterVarNode::make(op2_replacer.replace(orig_iv->dom), var2, orig_iv->iter_type);
-      op1_min_ufs.push_back(loop_layout->l_fun_mins[i]);
-      op1_ext_ufs.push_back(loop_layout->l_funs[i]);
-      op2_min_ufs.push_back(loop_layout->l_fun_mins[i]);
-      op2_ext_ufs.push_back(loop_layout->l_funs[i]);
+    for (size_t t = 0; t < num_tiers; ++t) {
+      Tier& tier = tiers[t];
+      auto var =
+          Var("iv" + std::to_string(t + 1) + "_" + std::to_string(i), orig_iv->var.dtype());
+      VarReplacer replacer(tier.vsub);
+      IterVar iv;
+      if (i == to_split_index) {
+        bool first = t == 0;
+        bool last = t == num_tiers - 1;
+        PrimExpr min = first ? replacer(orig_iv->dom->min)
+                             : split_points[t - 1].MakeCallTo(tier.vars, tier.dims);
+        PrimExpr max = last ? replacer(orig_iv->dom->max_exclusive())
+                            : split_points[t].MakeCallTo(tier.vars, tier.dims);
+        iv = IterVarNode::make(Range::make_by_min_max_exclusive(min, max), var,
+                               orig_iv->iter_type);
+        tier.min_ufs.push_back(first ? loop_layout->l_fun_mins[i] : split_points[t - 1]);
+        tier.ext_ufs.push_back(last ? loop_layout->l_funs[i] : split_points[t]);
+      } else {
+        iv = IterVarNode::make(replacer.replace(orig_iv->dom), var, orig_iv->iter_type);
+        tier.min_ufs.push_back(loop_layout->l_fun_mins[i]);
+        tier.ext_ufs.push_back(loop_layout->l_funs[i]);
+      }
+      tier.axis.push_back(iv);
+      tier.vars.push_back(iv->var);
+      tier.dims.push_back(orig_dim);
+      tier.vsub[orig_iv->var.get()] = var;
+      tier.maxes.push_back(loop_layout->l_maxes[i]);
     }
-    op1_axis.push_back(iv1);
-    op2_axis.push_back(iv2);
-    op1_vars.push_back(iv1->var);
-    op2_vars.push_back(iv2->var);
-    op1_dims.push_back(orig_dim);
-    op2_dims.push_back(orig_dim);
-    op1_vsub[orig_iv->var.get()] = var1;
-    op2_vsub[orig_iv->var.get()] = var2;
-    op1_maxes.push_back(loop_layout->l_maxes[i]);
-    op2_maxes.push_back(loop_layout->l_maxes[i]);
   }
 
-  Array<IterVar> op1_red_axis;
-  Array<IterVar> op2_red_axis;
   for (size_t i = 0; i < compute_op->reduce_axis.size(); ++i) {
     auto orig_iv = compute_op->reduce_axis[i];
-    auto orig_dim = compute_op->reduction_dimensions[i];
-    IterVar iv1 =
-        IterVarNode::make(VarReplacer(op1_vsub).replace(orig_iv->dom),
-                          Var("k1" + std::to_string(i), orig_iv->var.dtype()), orig_iv->iter_type);
-    IterVar iv2 =
-        IterVarNode::make(VarReplacer(op2_vsub).replace(orig_iv->dom),
-                          Var("k2" + std::to_string(i), orig_iv->var.dtype()), orig_iv->iter_type);
-    op1_red_axis.push_back(iv1);
-    op2_red_axis.push_back(iv2);
-    op1_vsub[orig_iv->var.get()] = iv1->var;
-    op2_vsub[orig_iv->var.get()] = iv2->var;
+    for (size_t t = 0; t < num_tiers; ++t) {
+      Tier& tier = tiers[t];
+      IterVar iv = IterVarNode::make(
+          VarReplacer(tier.vsub).replace(orig_iv->dom),
+          Var("k" + std::to_string(t + 1) + "_" + std::to_string(i), orig_iv->var.dtype()),
+          orig_iv->iter_type);
+      tier.red_axis.push_back(iv);
+      tier.vsub[orig_iv->var.get()] = iv->var;
+    }
   }
 
-  Array<PrimExpr> op1_body;
-  Array<PrimExpr> op2_body;
-  Array<PrimExpr> op1_pred;
-  Array<PrimExpr> op2_pred;
-  VarReplacer op1_replacer(op1_vsub);
-  VarReplacer op2_replacer(op2_vsub);
-
-  auto replace = [&](PrimExpr e, VarReplacer& replacer, std::unordered_map<Tensor, Tensor>& vsub) {
+  auto replace = [&](PrimExpr e, VarReplacer& replacer,
+                     const std::unordered_map<Tensor, Tensor>& vsub) {
     return te::ReplaceTensor(replacer(e), vsub);
   };
 
-  for (size_t i = 0; i < compute_op->num_outputs(); ++i) {
-    if (auto reduce = compute_op->body[i].as<tir::ReduceNode>()) {
-      CHECK_EQ(compute_op->num_outputs(), 1)
-          << "Splitting reduction ops with multiple outputs is not yet supported";
-
-      Array<PrimExpr> op1_source;
-      Array<PrimExpr> op2_source;
-      for (auto s : reduce->source) {
-        op1_source.push_back(op1_replacer(s));
-        op2_source.push_back(op2_replacer(s));
+  for (size_t t = 0; t < num_tiers; ++t) {
+    Tier& tier = tiers[t];
+    VarReplacer replacer(tier.vsub);
+    for (size_t i = 0; i < compute_op->num_outputs(); ++i) {
+      if (auto reduce = compute_op->body[i].as<tir::ReduceNode>()) {
+        CHECK_EQ(compute_op->num_outputs(), 1)
+            << "Splitting reduction ops with multiple outputs is not yet supported";
+
+        Array<PrimExpr> source;
+        for (auto s : reduce->source) {
+          source.push_back(replacer(s));
+        }
+        tier.body.push_back(ReduceNode::make(reduce->combiner, source, tier.red_axis,
+                                             replace(reduce->condition, replacer, graph_vsubs[t]),
+                                             reduce->value_index, reduce->dimensions));
+      } else {
+        tier.body.push_back(replace(compute_op->body[i], replacer, graph_vsubs[t]));
       }
-
-      op1_body.push_back(ReduceNode::make(reduce->combiner, op1_source, op1_red_axis,
-                                          replace(reduce->condition, op1_replacer, graph1_vsub),
-                                          reduce->value_index, reduce->dimensions));
-      op2_body.push_back(ReduceNode::make(reduce->combiner, op2_source, op2_red_axis,
-                                          replace(reduce->condition, op2_replacer, graph2_vsub),
-                                          reduce->value_index, reduce->dimensions));
-    } else {
-      op1_body.push_back(replace(compute_op->body[i], op1_replacer, graph1_vsub));
-      op2_body.push_back(replace(compute_op->body[i], op2_replacer, graph2_vsub));
+      tier.pred.push_back(replace(compute_op->pred[i], replacer, graph_vsubs[t]));
     }
-    op1_pred.push_back(replace(compute_op->pred[i], op1_replacer, graph1_vsub));
-    op2_pred.push_back(replace(compute_op->pred[i], op2_replacer, graph2_vsub));
   }
 
-  Modes op1_loop_layout =
-      ModesNode::make_loop_layout(op1_dims, op1_maxes, op1_min_ufs, op1_ext_ufs);
-  Modes op2_loop_layout =
-      ModesNode::make_loop_layout(op2_dims, op2_maxes, op2_min_ufs, op2_ext_ufs);
-
-  Operation op1 = ComputeOpNode::make(compute_op->name + "1", "", {}, op1_axis, op1_dims,
-                                      compute_op->output_shape_storage, compute_op->storage_layouts,
-                                      op1_loop_layout, op1_body, op1_pred);
-
-  Operation op2 = ComputeOpNode::make(compute_op->name + "2", "", {}, op2_axis, op2_dims,
-                                      compute_op->output_shape_storage, compute_op->storage_layouts,
-                                      op2_loop_layout, op2_body, op2_pred);
-
-  Stage s1(op1);
-  Stage s2(op2);
+  Array<Operation> new_ops;
+  for (size_t t = 0; t < num_tiers; ++t) {
+    Tier& tier = tiers[t];
+    Modes tier_loop_layout =
+        ModesNode::make_loop_layout(tier.dims, tier.maxes, tier.min_ufs, tier.ext_ufs);
+    new_ops.push_back(ComputeOpNode::make(
+        compute_op->name + std::to_string(t + 1), "", {}, tier.axis, tier.dims,
+        compute_op->output_shape_storage, compute_op->storage_layouts, tier_loop_layout,
+        tier.body, tier.pred));
+  }
 
   ArrayNode* stages = sch->stages.CopyOnWrite();
   size_t pos = FindNodeRef(stages, s);
   CHECK_LT(pos, stages->data.size());
   stages->data.erase(stages->data.begin() + pos);
-  stages->data.insert(stages->data.begin() + pos, s1);
-  stages->data.insert(stages->data.begin() + pos + 1, s2);
-
   MapNode* stage_map = sch->stage_map.CopyOnWrite();
   stage_map->data.erase(op);
-  sch->stage_map.Set(op1, s1);
-  sch->stage_map.Set(op2, s2);
+  for (size_t t = 0; t < num_tiers; ++t) {
+    Stage new_stage(new_ops[t]);
+    new_stage->is_output = s->is_output;
+    stages->data.insert(stages->data.begin() + pos + t, new_stage);
+    sch->stage_map.Set(new_ops[t], new_stage);
+  }
 
   if (s->is_output) {
-    s1->is_output = true;
-    s2->is_output = true;
     ArrayNode* sch_outputs = sch->outputs.CopyOnWrite();
     pos = FindNodeRef(sch_outputs, s->origin_op);
     CHECK(pos < sch->outputs.size());
     sch_outputs->data.erase(sch_outputs->data.begin() + pos);
-    sch_outputs->data.insert(sch_outputs->data.end(), op1);
-    sch_outputs->data.insert(sch_outputs->data.end(), op2);
+    for (auto new_op : new_ops) {
+      sch_outputs->data.insert(sch_outputs->data.end(), new_op);
+    }
   }
-  return Array<Operation>({op1, op2});
+  return new_ops;
 }
 
 Array<Array<Operation>> SplitAGraph(Schedule& sch, Array<Operation> graph_ops,
-                                    size_t to_split_index, UninterpFun split_point) {
-  std::unordered_map<Tensor, Tensor> graph1_vsub;
-  std::unordered_map<Tensor, Tensor> graph2_vsub;
-  Array<Operation> graph1_ops;
-  Array<Operation> graph2_ops;
+                                    size_t to_split_index, Array<UninterpFun> split_points) {
+  size_t num_tiers = split_points.size() + 1;
+  std::vector<std::unordered_map<Tensor, Tensor>> graph_vsubs(num_tiers);
+  std::vector<Array<Operation>> graphs(num_tiers);
   for (auto op : graph_ops) {
-    auto new_ops = SplitALoop(sch, op, to_split_index, split_point, graph1_vsub, graph2_vsub);
-    auto graph1_op = new_ops[0];
-    auto graph2_op = new_ops[1];
-    for (size_t i = 0; i < op->num_outputs(); ++i) {
-      graph1_vsub[op.output(i)] = graph1_op.output(i);
-      graph2_vsub[op.output(i)] = graph2_op.output(i);
+    // The inputs of the subgraph are shared by the tiers
+    if (!op.as<ComputeOpNode>()) continue;
+    auto new_ops = SplitALoop(sch, op, to_split_index, split_points, graph_vsubs);
+    for (size_t t = 0; t < num_tiers; ++t) {
+      for (size_t i = 0; i < op->num_outputs(); ++i) {
+        graph_vsubs[t][op.output(i)] = new_ops[t].output(i);
+      }
+      graphs[t].push_back(new_ops[t]);
     }
-    graph1_ops.push_back(graph1_op);
-    graph2_ops.push_back(graph2_op);
   }
-  return Array<Array<Operation>>({graph1_ops, graph2_ops});
+  return Array<Array<Operation>>(graphs.begin(), graphs.end());
 }
 
 Array<Array<Operation>> Schedule::split_for_bin_packing(Array<Tensor> input_tensors,
                                                         Tensor output_tensor,
-                                                        Map<IterVar, UninterpFun> to_split,
+                                                        Map<IterVar, Array<UninterpFun>> to_split,
                                                         bool include_inputs) {
-  std::unordered_map<size_t, UninterpFun> to_split_indices;
+  std::unordered_map<size_t, Array<UninterpFun>> to_split_indices;
   auto compute_op = output_tensor->op.as<ComputeOpNode>();
   CHECK(compute_op) << "Loop splitting for bin packing is currently allowed only for ComputeOp";
   for (size_t i = 0; i < compute_op->axis.size(); ++i) {
@@ -224,6 +202,35 @@ Array<Array<Operation>> Schedule::split_for_bin_packing(Array<Tensor> input_tens
   return ops;
 }
 
+Array<UninterpFun> MakeBinPackSplitPoints(UninterpFun l_fun, Array<Integer> tile_factors) {
+  CHECK_GT(tile_factors.size(), 0);
+  PrimExpr body = l_fun->body.defined() ? l_fun->body
+                                        : l_fun.MakeCallTo(l_fun->parameters, l_fun->dimensions);
+  Array<UninterpFun> split_points;
+  for (size_t i = 0; i < tile_factors.size(); ++i) {
+    int64_t factor = tile_factors[i];
+    CHECK_GT(factor, 0);
+    if (i > 0) {
+      int64_t prev_factor = tile_factors[i - 1];
+      CHECK(factor < prev_factor && prev_factor % factor == 0)
+          << "Tile factors should be decreasing, each dividing the previous one, but got "
+          << tile_factors;
+    }
+    // The largest multiple of factor below the extent. As factor
+    // divides the previous factors, this is also at least the previous
+    // split point.
+    auto round_down = [&](PrimExpr e) {
+      return Simplify(floordiv(e, static_cast<int>(factor)) * static_cast<int>(factor));
+    };
+    Range range = Range::make_by_min_max_inclusive(round_down(l_fun->range->min),
+                                                   round_down(l_fun->range->max_inclusive()));
+    split_points.push_back(UninterpFunNode::make(
+        l_fun->fname + "_bp" + std::to_string(factor), range, l_fun->dimensions,
+        l_fun->parameters, round_down(body), UninterpFunNode::kLFun));
+  }
+  return split_points;
+}
+
 }  // namespace te
 }  // namespace tvm
 
@@ -46,6 +46,18 @@ Array<Range> ComputeRealizeBounds(const Stage& stage, const ComputeOpNode* compu
   return new_shape;
 }
 
+// Pad the storage layout such that the rows of the ragged dimensions
+// aligned with storage_align_dim start at aligned offsets.
+Modes AlignRaggedRows(const Stage& s, Modes layout) {
+  for (size_t i = 0; i < layout->ndim(); ++i) {
+    auto it = s->align_info.find(layout->dimensions[i].as<DimensionNode>());
+    if (it == s->align_info.end() || it->second.first == 0 || !layout->is_ragged(i)) continue;
+    CHECK_EQ(it->second.second, 0) << "Ragged dimensions can only be aligned with a zero offset";
+    layout = ModesNode::make_row_aligned_storage_layout(layout, i, it->second.first);
+  }
+  return layout;
+}
+
 void Schedule::freeze_tensor_dimensions(const Map<IterVar, Range>& dom_map) {
   Schedule& sch = *this;
   auto feed_graph = GetFeedGraph(sch, true);
@@ -71,7 +83,7 @@ void Schedule::freeze_tensor_dimensions(const Map<IterVar, Range>& dom_map) {
         if (root_layouts.size() > 0) {
           Modes leaf_layout = DimensionPassDownModes(s, compute_op, root_layouts[i]);
           if (leaf_layout.defined()) {
-            mutable_compute_op->set_storage_layout(i, leaf_layout);
+            mutable_compute_op->set_storage_layout(i, AlignRaggedRows(s, leaf_layout));
           }
         }
       }
@@ -126,7 +138,7 @@ void Schedule::freeze_tensor_dimensions(const Map<IterVar, Range>& dom_map) {
       if (root_layout.defined()) {
         Modes leaf_layout = DimensionPassDownModes(s, placeholder_op, root_layout);
         if (leaf_layout.defined()) {
-          mutable_placeholder_op->set_storage_layout(leaf_layout);
+          mutable_placeholder_op->set_storage_layout(AlignRaggedRows(s, leaf_layout));
         }
       }
 
@@ -1,12 +1,20 @@
 #include "function_generator.h"
 
+#include <dmlc/common.h>
+
+#include <tvm/arith/pattern.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/target/target.h>
 #include <tvm/te/operation.h>
 #include <tvm/te/schedule_pass.h>
 #include <tvm/tir/expr.h>
+#include <tvm/tir/expr_equality.h>
 #include <tvm/tir/ir_pass.h>
 #include <tvm/tir/stmt_functor.h>
 
+#include <functional>
+#include <limits>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -20,13 +28,29 @@ namespace te {
 
 Buffer AllocationAggregator::create_buffer(Array<PrimExpr> extents, DataType buf_dtype,
                                            std::string name) {
-  CHECK_EQ(buf_dtype, dtype);
-  Buffer buf = BufferNode::make(aggregate_buffer_var, dtype, extents, {}, aggregate_allocated_size,
-                                name, "global", 0, 0, kDefault, kAll);
+  CHECK(buf_dtype.is_scalar() &&
+        (dtype.bits() % buf_dtype.bits() == 0 || buf_dtype.bits() % dtype.bits() == 0))
+      << "Cannot pack " << buf_dtype << " buffers into a " << dtype << " aggregate";
   PrimExpr size = 1;
   for (auto ext : extents) {
     size = size * ext;
   }
+  if (buf_dtype.bits() > dtype.bits()) {
+    // Wider buffers start at an offset aligned to their element size
+    int widen = buf_dtype.bits() / dtype.bits();
+    PrimExpr start = indexdiv(aggregate_allocated_size + (widen - 1), widen);
+    Buffer buf = BufferNode::make(aggregate_buffer_var, buf_dtype, extents, {}, start, name,
+                                  "global", 0, 0, kDefault, kAll);
+    aggregate_allocated_size = (start + size) * widen;
+    return buf;
+  }
+  int pack = dtype.bits() / buf_dtype.bits();
+  Buffer buf = BufferNode::make(aggregate_buffer_var, buf_dtype, extents, {},
+                                aggregate_allocated_size * pack, name, "global", 0, 0, kDefault,
+                                kAll);
+  if (pack > 1) {
+    size = indexdiv(size + (pack - 1), pack);
+  }
   aggregate_allocated_size = aggregate_allocated_size + size;
   return buf;
 }
@@ -36,34 +60,83 @@ Buffer AllocationAggregator::aggregate_buffer() {
                           aggregate_name, "global", 0, 0, kDefault, kAll);
 }
 
-size_t AFunctionGenerator::FunKeyHasher::operator()(const FunKey& pattern) const {
-  size_t hash = std::hash<const Object*>{}(pattern.dimension.get());
+Stmt CopyAggregateToDevice(Buffer host_agg_buf, Buffer dev_agg_buf, PrimExpr aggregate_size) {
+  return EvaluateNode::make(copy_to_device(
+      host_agg_buf->data, 0, dev_agg_buf->data, 0, aggregate_size * DataType::Int(32).bytes(),
+      Var("src_devtype_dummy", DataType::Handle()), Var("src_devid_dummy", DataType::Handle()),
+      Var("dst_devtype_dummy", DataType::Handle()), Var("dst_devid_dummy", DataType::Handle()),
+      kDLInt, 32));
+}
 
-  for (auto dim : pattern.dependent_dimensions) {
-    hash ^= std::hash<const Object*>{}(dim);
+size_t AFunctionGenerator::FunKeyHasher::operator()(const FunKey& pattern) const {
+  DeeperExprHash hasher;
+  size_t hash = hasher(pattern.extent);
+  // The dependent l_funs are unordered
+  for (const auto& l_fun : pattern.dependent_l_funs) {
+    hash += dmlc::HashCombine(hasher(l_fun.first), hasher(l_fun.second));
   }
-
   return hash;
 }
 
-// TODO: Consider using the associated l_funs to determine dependent
-// dimension equality as multiple dimensions might have the same
-// l_funs
 bool AFunctionGenerator::FunKeyEquality::operator()(const FunKey& p1, const FunKey& p2) const {
-  if (p1.dimension != p2.dimension) return false;
-  return (p1.dependent_dimensions == p2.dependent_dimensions);
+  DeeperExprEquality equals;
+  if (!equals(p1.extent, p2.extent)) return false;
+  if (p1.dependent_l_funs.size() != p2.dependent_l_funs.size()) return false;
+  // Match the dependent l_funs as multisets
+  std::vector<bool> matched(p2.dependent_l_funs.size(), false);
+  for (const auto& l_fun1 : p1.dependent_l_funs) {
+    bool found = false;
+    for (size_t j = 0; j < p2.dependent_l_funs.size() && !found; ++j) {
+      const auto& l_fun2 = p2.dependent_l_funs[j];
+      if (!matched[j] && equals(l_fun1.first, l_fun2.first) &&
+          equals(l_fun1.second, l_fun2.second)) {
+        matched[j] = found = true;
+      }
+    }
+    if (!found) return false;
+  }
+  return true;
+}
+
+// The body of l_fun over parameters shared by all l_funs, so that the
+// bodies of l_funs created separately compare equal. l_funs without a
+// body are only equal to themselves.
+PrimExpr CanonicalLFunBody(const UninterpFun& l_fun) {
+  static std::mutex mutex;
+  static std::vector<Var> canonical_params;
+  Array<PrimExpr> params;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (canonical_params.size() < l_fun->arity()) {
+      canonical_params.push_back(
+          Var("afkey_p" + std::to_string(canonical_params.size()), DataType::Int(32)));
+    }
+    params = Array<PrimExpr>(canonical_params.begin(),
+                             canonical_params.begin() + l_fun->arity());
+  }
+  if (!l_fun->body.defined()) return l_fun.MakeCallTo(params, l_fun->dimensions);
+  std::unordered_map<const VarNode*, PrimExpr> vsub;
+  for (size_t i = 0; i < l_fun->arity(); ++i) {
+    vsub[l_fun->parameters[i].get()] = params[i];
+  }
+  return VarReplacer(vsub)(l_fun->body);
 }
 
 AFunctionGenerator::FunKey make_key(const Modes& layout, const int& idx) {
-  // std::cout << "[AFG] Making key " << layout->dimensions[idx] << std::endl;
-  auto transitive_dependent_dims = layout->get_transitive_dependent_dims(idx);
-  std::multiset<const Object*> transitive_dependent_dims_set;
-  for (auto dim : transitive_dependent_dims) {
-    auto l_fun = layout->l_funs[layout->dimensions.GetIdx(dim)];
-    // std::cout << "[ADep " << dim << " " << l_fun << std::endl;
-    transitive_dependent_dims_set.insert(l_fun.get());
+  AFunctionGenerator::FunKey key;
+  key.extent = layout->l_funs[idx]->range->max_inclusive();
+  for (auto dim : layout->get_transitive_dependent_dims(idx)) {
+    int dim_idx = layout->dimensions.GetIdx(dim);
+    PrimExpr l_max = layout->l_maxes.size() == layout->ndim()
+                         ? layout->l_maxes[dim_idx]
+                         : layout->l_funs[dim_idx]->range->max_inclusive();
+    key.dependent_l_funs.push_back({CanonicalLFunBody(layout->l_funs[dim_idx]), l_max});
   }
-  return {layout->dimensions[idx], transitive_dependent_dims_set};
+  return key;
+}
+
+AFunctionGenerator::FunMap& AFunctionGenerator::afun_map() {
+  return shared ? shared->dim_afun_map : dim_afun_map;
 }
 
 Stmt AFunctionGenerator::Generate() {
@@ -72,7 +145,7 @@ Stmt AFunctionGenerator::Generate() {
       for (size_t i = 0; i < layout->ndim(); ++i) {
         if (layout->a_funs[i].defined() && layout->a_funs[i]->body.defined()) {
           FunKey key = make_key(layout, i);
-          this->dim_afun_map[key] = layout->a_funs[i];
+          this->afun_map()[key] = layout->a_funs[i];
         }
       }
     }
@@ -116,6 +189,197 @@ Stmt AFunctionGenerator::Generate() {
   return SeqStmt(stmts);
 }
 
+Stmt AllocateScratch(Buffer buf, PrimExpr extent, Stmt body) {
+  return AttrStmtNode::make(buf->data, attr::storage_scope, StringImmNode::make("global"),
+                            AllocateNode::make(buf->data, buf->dtype, {extent},
+                                               IntImm(DataType::Bool(1), 1), body));
+}
+
+/*!
+ * \brief The narrowest integer type holding values in [min_value,
+ * max_value]: unsigned if min_value is non-negative, signed otherwise,
+ * of at most 16 bits. Int32 if the values need more bits.
+ */
+DataType NarrowestAuxType(int64_t min_value, int64_t max_value) {
+  if (min_value >= 0) {
+    if (max_value <= 255) return DataType::UInt(8);
+    if (max_value <= 65535) return DataType::UInt(16);
+    return DataType::Int(32);
+  }
+  int64_t max_abs = std::max(-min_value - 1, max_value);
+  if (max_abs <= 127) return DataType::Int(8);
+  if (max_abs <= 32767) return DataType::Int(16);
+  return DataType::Int(32);
+}
+
+/*!
+ * \brief The type of an aux buffer holding values in [min_value,
+ * max_value]. This is int64 if a bound is a constant overflowing int32.
+ * If the narrow_aux_buffers build option is set and both bounds are
+ * constants, it is NarrowestAuxType of the bounds. It is int32
+ * otherwise. Compute the bounds in int64 to avoid folding overflows.
+ */
+DataType AuxBufferType(PrimExpr max_value, PrimExpr min_value = 0) {
+  const IntImmNode* max_imm = Simplify(max_value).as<IntImmNode>();
+  const IntImmNode* min_imm = Simplify(min_value).as<IntImmNode>();
+  if (max_imm && max_imm->value > std::numeric_limits<int32_t>::max()) return DataType::Int(64);
+  if (min_imm && min_imm->value < std::numeric_limits<int32_t>::min()) return DataType::Int(64);
+  if (!BuildConfig::Current()->narrow_aux_buffers || !max_imm || !min_imm) {
+    return DataType::Int(32);
+  }
+  return NarrowestAuxType(min_imm->value, max_imm->value);
+}
+
+/*! \brief The type aux values of buf are computed in: int32, or int64
+ * for int64 buffers. */
+DataType AuxValueType(Buffer buf) {
+  return buf->dtype.bits() > 32 ? buf->dtype : DataType::Int(32);
+}
+
+/*! \brief Load buf[index], widening narrow buffers to int32. */
+PrimExpr LoadAux(Buffer buf, Array<PrimExpr> index) {
+  PrimExpr load = buf.vload(index, buf->dtype);
+  return cast(AuxValueType(buf), load);
+}
+
+/*! \brief Store value into buf[index], converting it to the buffer
+ * dtype. */
+Stmt StoreAux(Buffer buf, Array<PrimExpr> index, PrimExpr value) {
+  return buf.vstore(index, cast(buf->dtype, value));
+}
+
+/*!
+ * \brief Generate code storing the exclusive prefix sum of weight, a
+ * function of loop_var, into buf[i] for loop_var = loop_min + i and i
+ * in [0, extent). If store_total is set, the total is additionally
+ * stored into buf[extent].
+ *
+ * When num_blocks is zero, the scan is a serial loop with a single
+ * counter. Otherwise the iteration space is split into num_blocks
+ * blocks that are scanned locally in parallel, followed by a serial
+ * scan over the (few) block sums and a parallel pass adding the block
+ * offsets back. The inner loops of both parallel passes are unit
+ * stride and are left to the backend to vectorize.
+ */
+Stmt MakePrefixSum(Var loop_var, PrimExpr loop_min, PrimExpr extent, PrimExpr weight, Buffer buf,
+                   bool store_total, std::string prefix, int num_blocks) {
+  // Sums are accumulated in int64 for int64 buffers
+  DataType acc_dtype = AuxValueType(buf);
+  weight = cast(acc_dtype, weight);
+  Buffer counter = decl_buffer({1}, acc_dtype, prefix + "ctr");
+  PrimExpr counter_load = counter.vload({0}, acc_dtype);
+
+  if (num_blocks == 0) {
+    PrimExpr idx = is_zero(loop_min) ? PrimExpr(loop_var) : loop_var - loop_min;
+    Stmt fun_store = StoreAux(buf, {idx}, counter_load);
+    Stmt counter_incr = counter.vstore({0}, counter_load + weight);
+    Stmt stmt = ForNode::make(loop_var, loop_min, extent, ForType::Serial, DeviceAPI::None,
+                              SeqStmt({fun_store, counter_incr}));
+
+    Array<Stmt> stmts = {counter.vstore({0}, make_zero(acc_dtype)), stmt};
+    if (store_total) {
+      stmts.push_back(StoreAux(buf, {extent}, counter_load));
+    }
+    return AllocateScratch(counter, 1, SeqStmt(stmts));
+  }
+
+  Buffer block_sums = decl_buffer({num_blocks + 1}, acc_dtype, prefix + "bsum");
+  PrimExpr block_size = indexdiv(extent + (num_blocks - 1), num_blocks);
+
+  // Generates a parallel loop over the blocks, with a serial loop
+  // over the elements of each block nested inside.
+  auto make_block_loop = [&](std::function<Stmt(Var, PrimExpr)> element_body,
+                             std::function<Stmt(Var, Stmt)> block_body) {
+    Var block(prefix + "b", DataType::Int(32));
+    Var j(prefix + "j", DataType::Int(32));
+    PrimExpr block_start = block * block_size;
+    PrimExpr block_extent = max(min(block_size, extent - block_start), 0);
+    Stmt inner = ForNode::make(j, 0, block_extent, ForType::Serial, DeviceAPI::None,
+                               element_body(block, block_start + j));
+    return ForNode::make(block, 0, num_blocks, ForType::Parallel, DeviceAPI::None,
+                         block_body(block, inner));
+  };
+
+  // Phase 1: local exclusive scans, accumulating into block_sums
+  Stmt local_scans = make_block_loop(
+      [&](Var block, PrimExpr i) {
+        PrimExpr weight_i = VarReplacer({{loop_var.get(), loop_min + i}})(weight);
+        PrimExpr sum_load = block_sums.vload({block}, acc_dtype);
+        return SeqStmt(
+            {StoreAux(buf, {i}, sum_load), block_sums.vstore({block}, sum_load + weight_i)});
+      },
+      [&](Var block, Stmt inner) {
+        return SeqStmt({block_sums.vstore({block}, make_zero(acc_dtype)), inner});
+      });
+
+  // Phase 2: exclusive scan over the block sums
+  Stmt block_scan;
+  {
+    Var block(prefix + "sb", DataType::Int(32));
+    Var sum(prefix + "s", acc_dtype);
+    Stmt body = LetStmtNode::make(
+        sum, block_sums.vload({block}, acc_dtype),
+        SeqStmt({block_sums.vstore({block}, counter_load),
+                 counter.vstore({0}, counter_load + sum)}));
+    body = ForNode::make(block, 0, num_blocks, ForType::Serial, DeviceAPI::None, body);
+    block_scan = SeqStmt({counter.vstore({0}, make_zero(acc_dtype)), body,
+                          block_sums.vstore({num_blocks}, counter_load)});
+    block_scan = AllocateScratch(counter, 1, block_scan);
+  }
+
+  // Phase 3: add the block offsets to the local scans
+  Var offset(prefix + "off", acc_dtype);
+  Stmt add_offsets = make_block_loop(
+      [&](Var block, PrimExpr i) {
+        return StoreAux(buf, {i}, LoadAux(buf, {i}) + offset);
+      },
+      [&](Var block, Stmt inner) {
+        return LetStmtNode::make(offset, block_sums.vload({block}, acc_dtype), inner);
+      });
+
+  Array<Stmt> stmts = {local_scans, block_scan, add_offsets};
+  if (store_total) {
+    stmts.push_back(
+        StoreAux(buf, {extent}, block_sums.vload({num_blocks}, acc_dtype)));
+  }
+  return AllocateScratch(block_sums, num_blocks + 1, SeqStmt(stmts));
+}
+
+/*! \brief Check if var is the only scalar variable e refers to. */
+bool OnlyUsesVar(PrimExpr e, Var var) {
+  bool ret = true;
+  PostOrderVisit(e, [&](const ObjectRef& node) {
+    if (auto v = node.as<VarNode>()) {
+      if (v != var.get() && !v->dtype.is_handle()) ret = false;
+    }
+  });
+  return ret;
+}
+
+/*!
+ * \brief Parallel counterpart of the serial fusion function
+ * generation loops. The outer to fused position buffer is computed as
+ * a prefix sum of the inner extents, after which the fused to outer
+ * and fused to inner buffers can be filled independently for each
+ * outer iteration.
+ */
+Stmt MakeParallelFusionLoops(Var outer_var, PrimExpr outer_min, PrimExpr outer_extent,
+                             Var inner_var, PrimExpr inner_min, PrimExpr inner_extent,
+                             Buffer fused_to_outer_buf, Buffer fused_to_inner_buf,
+                             Buffer outer_to_fused_pos_buf, std::string prefix, int num_blocks) {
+  Stmt pos_scan = MakePrefixSum(outer_var, outer_min, outer_extent, inner_extent,
+                                outer_to_fused_pos_buf, false, prefix, num_blocks);
+
+  PrimExpr fused_pos =
+      LoadAux(outer_to_fused_pos_buf, {outer_var - outer_min}) + (inner_var - inner_min);
+  Stmt body = SeqStmt({StoreAux(fused_to_outer_buf, {fused_pos}, outer_var),
+                       StoreAux(fused_to_inner_buf, {fused_pos}, inner_var)});
+  body = ForNode::make(inner_var, inner_min, inner_extent, ForType::Serial, DeviceAPI::None, body);
+  body = ForNode::make(outer_var, outer_min, outer_extent, ForType::Parallel, DeviceAPI::None,
+                       body);
+  return SeqStmt({pos_scan, body});
+}
+
 void copy_body_to_ufun_shell(UninterpFun fun, UninterpFun shell) {
   // std::cout << "[FG] Setting body for " << fun << std::endl;
   PrimExpr body = fun->body;
@@ -139,72 +403,159 @@ UninterpFun AFunctionGenerator::set_afun(Modes layout, int idx, UninterpFun afun
 
   Dimension dim = layout->dimensions[idx];
   FunKey key = make_key(layout, idx);
-  if (dim_afun_map.count(key)) {
+  if (afun_map().count(key)) {
     // std::cout << "[AFG]   Copying body to " << afun_shell << std::endl;
     if (debug_fill_function_bodies) {
-      copy_body_to_ufun_shell(dim_afun_map[key], afun_shell);
+      copy_body_to_ufun_shell(afun_map()[key], afun_shell);
     }
   } else {
-    std::string prefix = dim->name + "_af" + std::to_string(count++) + "_";
+    int id = shared ? shared->afun_count++ : count++;
+    std::string prefix = dim->name + "_af" + std::to_string(id) + "_";
     Var loop_var = Var(prefix + "i", DataType::Int(32));
-    PrimExpr body_expr = 1;
 
-    PrimExpr afun_max_extent = 1;
+    PrimExpr loop_extent = layout->l_funs[idx]->range->max_inclusive();
+    PrimExpr buf_extent = loop_extent + 1;
+    // The prefix sum is at most the dense size of this dimension and
+    // all the ones depending on it. This is computed in int64 so that
+    // large layouts get int64 a_funs.
+    PrimExpr afun_max_value = cast(DataType::Int(64), loop_extent);
+    for (auto dependent_dim : layout->get_transitive_dependent_dims(idx)) {
+      int dependent_dim_idx = layout->dimensions.GetIdx(dependent_dim);
+      PrimExpr l_max = layout->l_maxes.size() == layout->ndim()
+                           ? layout->l_maxes[dependent_dim_idx]
+                           : layout->l_funs[dependent_dim_idx]->range->max_inclusive();
+      afun_max_value = afun_max_value * cast(DataType::Int(64), l_max);
+    }
+    DataType afun_dtype = AuxBufferType(afun_max_value);
+    DataType value_dtype = afun_dtype.bits() > 32 ? afun_dtype : DataType::Int(32);
+
+    PrimExpr body_expr = make_const(value_dtype, 1);
     for (auto dependent_dim : layout->get_immediate_dependent_dims(idx)) {
       int dependent_dim_idx = layout->dimensions.GetIdx(dependent_dim);
-      afun_max_extent = afun_max_extent * layout->l_funs[dependent_dim_idx]->range->extent;
       UninterpFun l_fun = layout->l_funs[dependent_dim_idx];
       PrimExpr l_fun_call = l_fun.MakeCallTo(Array<PrimExpr>({loop_var}), {dim});
       if (layout->has_dependent_dims(dependent_dim_idx)) {
         UninterpFun afun = set_afun(layout, dependent_dim_idx, layout->a_funs[dependent_dim_idx]);
-        PrimExpr afun_call = afun.MakeCallTo(Array<PrimExpr>({l_fun_call}), {dependent_dim});
+        PrimExpr afun_call =
+            afun.MakeCallTo(Array<PrimExpr>({l_fun_call}), {dependent_dim}, value_dtype);
         body_expr = body_expr * afun_call;
       } else {
-        body_expr = body_expr * l_fun_call;
+        body_expr = body_expr * cast(value_dtype, l_fun_call);
       }
     }
 
-    PrimExpr loop_extent = layout->l_funs[idx]->range->max_inclusive();
-    PrimExpr buf_extent = loop_extent + 1;
+    CHECK_EQ(afun_shell->parameters.size(), 1);
+    Var param = afun_shell->parameters[0];
+
+    // Affine and uniformly bucketed lengths have a closed form prefix
+    // sum, which needs neither an aux buffer nor prep code.
+    PrimExpr closed_form = UninterpFun::ClosedFormPrefixSum(loop_var, body_expr, param);
+    if (closed_form.defined()) {
+      if (debug_fill_function_bodies) {
+        const_cast<UninterpFunNode*>(afun_shell.as<UninterpFunNode>())->SetBody(closed_form);
+      }
+      afun_map()[key] = afun_shell;
+      return afun_shell;
+    }
+
     // std::cout << "[ASDC]   Buffer range " << layout->l_funs[idx]->range << std::endl;
-    auto buffer_pair = agg_pair.create_buffer_pair({buf_extent}, DataType::Int(32), prefix);
+    auto buffer_pair = agg_pair.create_buffer_pair({buf_extent}, afun_dtype, prefix);
     Buffer afun_buffer_host = buffer_pair.first;
     Buffer afun_buffer_dev = buffer_pair.second;
-    Buffer afun_counter = decl_buffer({1}, DataType::Int(32), prefix + "ctr");
-
-    Stmt fun_store =
-        afun_buffer_host.vstore({loop_var}, afun_counter.vload({0}, DataType::Int(32)));
-    Stmt counter_incr =
-        afun_counter.vstore({0}, afun_counter.vload({0}, DataType::Int(32)) + body_expr);
-    SeqStmt loop_stmts = SeqStmt({fun_store, counter_incr});
-    Stmt stmt =
-        ForNode::make(loop_var, 0, loop_extent, ForType::Serial, DeviceAPI::None, loop_stmts);
-
-    Stmt counter_init = afun_counter.vstore({0}, 0);
-    Stmt last_element =
-        afun_buffer_host.vstore({loop_extent}, afun_counter.vload({0}, DataType::Int(32)));
-    stmt = SeqStmt({counter_init, stmt, last_element});
-
-    stmt =
-        AttrStmtNode::make(afun_counter->data, attr::storage_scope, StringImmNode::make("global"),
-                           AllocateNode::make(afun_counter->data, DataType::Int(32), {1},
-                                              IntImm(DataType::Bool(1), 1), stmt));
-    stmts.push_back(stmt);
 
-    CHECK_EQ(afun_shell->parameters.size(), 1);
-    Var param = afun_shell->parameters[0];
+    Stmt afun_stmt = MakePrefixSum(loop_var, 0, loop_extent, body_expr, afun_buffer_host, true,
+                                   prefix, sch->prep_code_scan_blocks);
+    if (shared) {
+      shared->afun_stmts.push_back(afun_stmt);
+    } else {
+      stmts.push_back(afun_stmt);
+    }
+
     if (debug_fill_function_bodies) {
       // std::cout << "[FG] Setting body for " << afun_shell << std::endl;
       const_cast<UninterpFunNode*>(afun_shell.as<UninterpFunNode>())
-          ->SetBody(afun_buffer_dev.vload({param}, DataType::Int(32)));
+          ->SetBody(LoadAux(afun_buffer_dev, {param}));
     }
 
-    dim_afun_map[key] = afun_shell;
+    afun_map()[key] = afun_shell;
     // std::cout << "[AFG]   Generated body for " << afun_shell << std::endl;
   }
   return afun_shell;
 }
 
+Stmt PermutationGenerator::Generate() {
+  Array<Stmt> stmts;
+  for (Stage s : sch->stages) {
+    for (auto it : s->iter_var_attrs) {
+      UninterpFun permutation = it.second->permutation;
+      if (permutation.defined() && !permutation->body.defined()) {
+        Stmt stmt = generate_permutation(it.first, permutation, it.second->permutation_key);
+        if (shared) {
+          shared->afun_stmts.push_back(stmt);
+        } else {
+          stmts.push_back(stmt);
+        }
+      }
+    }
+  }
+  return SeqStmt(stmts);
+}
+
+Stmt PermutationGenerator::generate_permutation(IterVar iv, UninterpFun permutation,
+                                                PrimExpr key) {
+  int id = shared ? shared->afun_count++ : count++;
+  std::string prefix = permutation->fname + std::to_string(id) + "_";
+  PrimExpr extent = permutation->range->extent;
+  PrimExpr max_key = Simplify(UninterpFun::InlineUninterpFunCalls(
+      UninterpFun::RelaxUninterpCallsMaxInclusive(key, false)));
+  PrimExpr num_buckets = max_key + 1;
+
+  auto buffer_pair = agg_pair.create_buffer_pair({extent}, AuxBufferType(extent - 1), prefix);
+  Buffer perm_host = buffer_pair.first;
+  Buffer perm_dev = buffer_pair.second;
+  Buffer hist = decl_buffer({num_buckets}, DataType::Int(32), prefix + "hist");
+  Buffer start = decl_buffer({num_buckets}, DataType::Int(32), prefix + "start");
+
+  // Larger keys go to lower buckets, for a decreasing order
+  auto bucket_of = [&](Var i) {
+    return max_key - tir::Substitute(key, Map<Var, PrimExpr>({{iv->var, i}}));
+  };
+
+  Var k(prefix + "k", DataType::Int(32));
+  Stmt clear = ForNode::make(k, 0, num_buckets, ForType::Serial, DeviceAPI::None,
+                             hist.vstore({k}, 0));
+
+  Var i(prefix + "i", DataType::Int(32));
+  PrimExpr i_bucket = bucket_of(i);
+  Stmt histogram =
+      ForNode::make(i, 0, extent, ForType::Serial, DeviceAPI::None,
+                    hist.vstore({i_bucket}, hist.vload({i_bucket}, DataType::Int(32)) + 1));
+
+  Var sk(prefix + "sk", DataType::Int(32));
+  Stmt scan = MakePrefixSum(sk, 0, num_buckets, hist.vload({sk}, DataType::Int(32)), start,
+                            false, prefix, 0);
+
+  // Scattering in increasing order keeps the sort stable
+  Var j(prefix + "j", DataType::Int(32));
+  Var pos(prefix + "pos", DataType::Int(32));
+  PrimExpr j_bucket = bucket_of(j);
+  Stmt scatter = ForNode::make(
+      j, 0, extent, ForType::Serial, DeviceAPI::None,
+      LetStmtNode::make(pos, start.vload({j_bucket}, DataType::Int(32)),
+                        SeqStmt({StoreAux(perm_host, {pos}, j),
+                                 start.vstore({j_bucket}, pos + 1)})));
+
+  Stmt stmt = SeqStmt({clear, histogram, scan, scatter});
+  stmt = AllocateScratch(hist, num_buckets, AllocateScratch(start, num_buckets, stmt));
+
+  CHECK_EQ(permutation->parameters.size(), 1);
+  if (debug_fill_function_bodies) {
+    const_cast<UninterpFunNode*>(permutation.as<UninterpFunNode>())
+        ->SetBody(LoadAux(perm_dev, {permutation->parameters[0]}));
+  }
+  return stmt;
+}
+
 bool is_constant(PrimExpr expr, Array<IterVar> iter_vars) {
   std::unordered_set<const Object*> iter_vars_set;
   for (auto iv : iter_vars) {
@@ -281,21 +632,6 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage, const Rag
   // std::cout << "[GFS]   Fused " << fused->var << " " << fused_dom << " " << fused_extent_relaxed
   //           << std::endl;
 
-  auto decl_both_buffers = [&](Array<PrimExpr> shape, std::string prefix) {
-    prefix = prefix + std::to_string(count);
-    auto buffer_pair = agg_pair.create_buffer_pair(shape, DataType::Int(32), prefix);
-    Buffer host_buffer = buffer_pair.first;
-    Buffer dev_buffer = buffer_pair.second;
-    return std::make_pair(host_buffer, dev_buffer);
-  };
-
-  // Allocate buffers
-  auto fused_to_inner_bufs = decl_both_buffers({fused_extent_relaxed}, "fi");
-  auto fused_to_outer_bufs = decl_both_buffers({fused_extent_relaxed}, "fo");
-  auto outer_to_fused_pos_bufs = decl_both_buffers({outer_extent_relaxed}, "ofp");
-  Buffer fused_val = decl_buffer({1}, DataType::Int(32), "f" + std::to_string(count));
-  count++;
-
   PrimExpr outer_loop_extent = outer_dom->extent;
   PrimExpr inner_loop_extent_unreplaced = inner_dom->extent;
   PrimExpr inner_loop_extent = inner_loop_extent_unreplaced;
@@ -342,26 +678,69 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage, const Rag
     }
   }
 
+  // Allocate buffers
+  Array<PrimExpr> key;
+  if (shared) {
+    auto canonical = [&](PrimExpr e) {
+      return VarReplacer({{outer->var.get(), shared->key_var}})(e);
+    };
+    key = Array<PrimExpr>({outer_dom->min, outer_loop_extent, canonical(inner_dom->min),
+                           canonical(inner_loop_extent), fused_extent_relaxed,
+                           outer_extent_relaxed});
+  }
+  bool found = false;
+  // The types of the buffers are only narrowed for constant minimum
+  // outer and inner values.
+  PrimExpr outer_min = Simplify(UninterpFun::InlineUninterpFunCalls(outer_dom->min));
+  PrimExpr inner_min = Simplify(UninterpFun::InlineUninterpFunCalls(inner_dom->min));
+  auto bufs = GetFusionBuffers(key, fused_extent_relaxed, outer_min, outer_extent_relaxed,
+                               inner_min, inner_extent_relaxed, "", &found);
+  auto fused_to_inner_bufs = bufs[0];
+  auto fused_to_outer_bufs = bufs[1];
+  auto outer_to_fused_pos_bufs = bufs[2];
+  Buffer fused_val = decl_buffer({1}, DataType::Int(32), "f" + std::to_string(count));
+  count++;
+
   // Compute the outer and inner variables in terms of the root itervars
   PrimExpr outer_value = outer->var;
   PrimExpr inner_value = inner->var;
 
   Stmt no_op = EvaluateNode::make(0);
   Stmt body = NullValue<Stmt>();
-  PrimExpr fused_val_load = fused_val.vload({0}, DataType::Int(32));
-  {
-    Stmt outer_store = fused_to_outer_bufs.first.vstore({fused_val_load}, outer_value);
-    Stmt inner_store = fused_to_inner_bufs.first.vstore({fused_val_load}, inner_value);
-    Stmt fused_incr = fused_val.vstore({0}, fused_val_load + 1);
-    body = SeqStmt({outer_store, inner_store, fused_incr});
-  }
+  if (found) {
+    body = no_op;
+  } else if (sch->prep_code_scan_blocks > 0) {
+    body = MakeParallelFusionLoops(outer->var, outer_dom->min, outer_loop_extent, inner->var,
+                                   inner_dom->min, inner_loop_extent, fused_to_outer_bufs.first,
+                                   fused_to_inner_bufs.first, outer_to_fused_pos_bufs.first,
+                                   "f" + std::to_string(count - 1) + "_",
+                                   sch->prep_code_scan_blocks);
+  } else {
+    PrimExpr fused_val_load = fused_val.vload({0}, DataType::Int(32));
+    {
+      Stmt outer_store = StoreAux(fused_to_outer_bufs.first, {fused_val_load}, outer_value);
+      Stmt inner_store = StoreAux(fused_to_inner_bufs.first, {fused_val_load}, inner_value);
+      Stmt fused_incr = fused_val.vstore({0}, fused_val_load + 1);
+      body = SeqStmt({outer_store, inner_store, fused_incr});
+    }
+
+    body = ForNode::make(inner->var, inner_dom->min, inner_loop_extent, ForType::Serial,
+                         DeviceAPI::None, body);
+    body = SeqStmt(
+        {StoreAux(outer_to_fused_pos_bufs.first, {outer_value - outer_dom->min}, fused_val_load),
+         body});
+    body = ForNode::make(outer->var, outer_dom->min, outer_loop_extent, ForType::Serial,
+                         DeviceAPI::None, body);
 
-  body = ForNode::make(inner->var, inner_dom->min, inner_loop_extent, ForType::Serial,
-                       DeviceAPI::None, body);
-  body = SeqStmt(
-      {outer_to_fused_pos_bufs.first.vstore({outer_value - outer_dom->min}, fused_val_load), body});
-  body = ForNode::make(outer->var, outer_dom->min, outer_loop_extent, ForType::Serial,
-                       DeviceAPI::None, body);
+    body = SeqStmt({fused_val.vstore({0}, 0), body});
+
+    body = AttrStmtNode::make(fused_val->data, attr::storage_scope, StringImmNode::make("global"),
+                              AllocateNode::make(fused_val->data, DataType::Int(32), {1},
+                                                 IntImm(DataType::Bool(1), 1), body));
+  }
+  if (!found) {
+    body = AddFusionBody(key, bufs, body);
+  }
 
   // Add annotations stating that the buffers we create all contain
   // non-negative integers
@@ -369,12 +748,6 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage, const Rag
   non_negative_objects.push_back(fused_to_inner_bufs.second->data);
   non_negative_objects.push_back(outer_to_fused_pos_bufs.second->data);
 
-  body = SeqStmt({fused_val.vstore({0}, 0), body});
-
-  body = AttrStmtNode::make(fused_val->data, attr::storage_scope, StringImmNode::make("global"),
-                            AllocateNode::make(fused_val->data, DataType::Int(32), {1},
-                                               IntImm(DataType::Bool(1), 1), body));
-
   PrimExpr fused_min = VarReplacer({{outer->var.get(), outer_dom->min}})(inner_dom->min);
   auto init_uf = [&](UninterpFun uf, PrimExpr max_extent, Buffer loadee,
                      PrimExpr body = NullValue<PrimExpr>()) {
@@ -384,7 +757,7 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage, const Rag
       CHECK_EQ(uf->arity(), 1);
       Array<PrimExpr> extents;
       for (auto param : uf->parameters) extents.push_back(param - fused_min);
-      body = loadee.vload(extents, DataType::Int(32));
+      body = LoadAux(loadee, extents);
     }
 
     // std::cout << "[FPL]   Setting body " << uf->func_name() << " " << body << std::endl;
@@ -397,8 +770,17 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage, const Rag
   init_uf(rel->fused_to_outer_uf, outer_extent_relaxed, fused_to_outer_bufs.second);
   init_uf(rel->fused_to_inner_uf, inner_extent_relaxed, fused_to_inner_bufs.second);
 
-  auto oif_body = outer_to_fused_pos_bufs.second.vload(
-                      {rel->outer_inner_to_fused_uf->parameters[0]}, DataType::Int(32)) +
+  // The row bounds have to be computable from the outer value alone
+  // for the lookups to be walked incrementally.
+  PrimExpr row_min = UninterpFun::InlineUninterpFunCalls(inner_dom->min);
+  if (debug_fill_function_bodies && OnlyUsesVar(row_min, outer->var) &&
+      OnlyUsesVar(inner_loop_extent, outer->var)) {
+    fused_lookups.push_back({rel->fused_to_outer_uf, rel->fused_to_inner_uf, outer->var, row_min,
+                             inner_loop_extent, Simplify(fused_min + fused_extent_relaxed - 1)});
+  }
+
+  auto oif_body = LoadAux(outer_to_fused_pos_bufs.second,
+                              {rel->outer_inner_to_fused_uf->parameters[0]}) +
                   rel->outer_inner_to_fused_uf->parameters[1];
   init_uf(rel->outer_inner_to_fused_uf, fused_extent_relaxed, outer_to_fused_pos_bufs.second,
           oif_body);
@@ -429,45 +811,67 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage,
   // std::cout << "[GFS]           " << inner_extent << std::endl;
   // std::cout << "[GFS]           " << fused_extent << std::endl;
 
-  auto decl_both_buffers = [&](Array<PrimExpr> shape, std::string prefix) {
-    prefix = "d_" + prefix + std::to_string(count);
-    auto buffer_pair = agg_pair.create_buffer_pair(shape, DataType::Int(32), prefix);
-    Buffer host_buffer = buffer_pair.first;
-    Buffer dev_buffer = buffer_pair.second;
-    return std::make_pair(host_buffer, dev_buffer);
-  };
-
-  // Allocate buffers
-  auto fused_to_inner_bufs = decl_both_buffers({fused_extent}, "fi");
-  auto fused_to_outer_bufs = decl_both_buffers({fused_extent}, "fo");
-  auto outer_to_fused_pos_bufs = decl_both_buffers({outer_extent}, "ofp");
-  Buffer fused_val = decl_buffer({1}, DataType::Int(32), "fb" + std::to_string(count));
-  count++;
-
   CHECK(is_constant(outer_extent, stage->all_iter_vars));
 
   // Compute the outer and inner variables in terms of the root itervars
   Var outer_loop_var = Var("out", DataType::Int(32));
   Var inner_loop_var = Var("in", DataType::Int(32));
 
+  // std::cout << "[GFS]  LFun: " << layout->l_funs[layout->dimensions.GetIdx(rel->inner)]
+  //           << std::endl;
+  PrimExpr inner_loop_extent = layout->l_funs[layout->dimensions.GetIdx(rel->inner)].MakeCallTo(
+      Array<Var>({outer_loop_var}), {rel->outer});
+
+  // Allocate buffers
+  Array<PrimExpr> key;
+  if (shared) {
+    PrimExpr canonical_inner_loop_extent = UninterpFun::InlineUninterpFunCalls(
+        VarReplacer({{outer_loop_var.get(), shared->key_var}})(inner_loop_extent));
+    key = Array<PrimExpr>(
+        {0, outer_extent, 0, canonical_inner_loop_extent, fused_extent, outer_extent});
+  }
+  bool found = false;
+  auto bufs = GetFusionBuffers(key, fused_extent, 0, outer_extent, 0, inner_extent, "d_", &found);
+  auto fused_to_inner_bufs = bufs[0];
+  auto fused_to_outer_bufs = bufs[1];
+  auto outer_to_fused_pos_bufs = bufs[2];
+  Buffer fused_val = decl_buffer({1}, DataType::Int(32), "fb" + std::to_string(count));
+  count++;
+
   Stmt no_op = EvaluateNode::make(0);
   Stmt body = NullValue<Stmt>();
-  PrimExpr fused_val_load = fused_val.vload({0}, DataType::Int(32));
-  {
-    Stmt outer_store = fused_to_outer_bufs.first.vstore({fused_val_load}, outer_loop_var);
-    Stmt inner_store = fused_to_inner_bufs.first.vstore({fused_val_load}, inner_loop_var);
-    Stmt fused_incr = fused_val.vstore({0}, fused_val_load + 1);
-    body = SeqStmt({outer_store, inner_store, fused_incr});
-  }
+  if (found) {
+    body = no_op;
+  } else if (sch->prep_code_scan_blocks > 0) {
+    body = MakeParallelFusionLoops(outer_loop_var, 0, outer_extent, inner_loop_var, 0,
+                                   inner_loop_extent, fused_to_outer_bufs.first,
+                                   fused_to_inner_bufs.first, outer_to_fused_pos_bufs.first,
+                                   "fb" + std::to_string(count - 1) + "_",
+                                   sch->prep_code_scan_blocks);
+  } else {
+    PrimExpr fused_val_load = fused_val.vload({0}, DataType::Int(32));
+    {
+      Stmt outer_store = StoreAux(fused_to_outer_bufs.first, {fused_val_load}, outer_loop_var);
+      Stmt inner_store = StoreAux(fused_to_inner_bufs.first, {fused_val_load}, inner_loop_var);
+      Stmt fused_incr = fused_val.vstore({0}, fused_val_load + 1);
+      body = SeqStmt({outer_store, inner_store, fused_incr});
+    }
 
-  // std::cout << "[GFS]  LFun: " << layout->l_funs[layout->dimensions.GetIdx(rel->inner)]
-  //           << std::endl;
-  body = ForNode::make(inner_loop_var, 0,
-                       layout->l_funs[layout->dimensions.GetIdx(rel->inner)].MakeCallTo(
-                           Array<Var>({outer_loop_var}), {rel->outer}),
-                       ForType::Serial, DeviceAPI::None, body);
-  body = SeqStmt({outer_to_fused_pos_bufs.first.vstore({outer_loop_var}, fused_val_load), body});
-  body = ForNode::make(outer_loop_var, 0, outer_extent, ForType::Serial, DeviceAPI::None, body);
+    body = ForNode::make(inner_loop_var, 0, inner_loop_extent, ForType::Serial, DeviceAPI::None,
+                         body);
+    body = SeqStmt({StoreAux(outer_to_fused_pos_bufs.first, {outer_loop_var}, fused_val_load),
+                    body});
+    body = ForNode::make(outer_loop_var, 0, outer_extent, ForType::Serial, DeviceAPI::None, body);
+
+    body = SeqStmt({fused_val.vstore({0}, 0), body});
+
+    body = AttrStmtNode::make(fused_val->data, attr::storage_scope, StringImmNode::make("global"),
+                              AllocateNode::make(fused_val->data, DataType::Int(32), {1},
+                                                 IntImm(DataType::Bool(1), 1), body));
+  }
+  if (!found) {
+    body = AddFusionBody(key, bufs, body);
+  }
 
   // Add annotations stating that the buffers we create all contain
   // non-negative integers
@@ -475,12 +879,6 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage,
   non_negative_objects.push_back(fused_to_inner_bufs.second->data);
   non_negative_objects.push_back(outer_to_fused_pos_bufs.second->data);
 
-  body = SeqStmt({fused_val.vstore({0}, 0), body});
-
-  body = AttrStmtNode::make(fused_val->data, attr::storage_scope, StringImmNode::make("global"),
-                            AllocateNode::make(fused_val->data, DataType::Int(32), {1},
-                                               IntImm(DataType::Bool(1), 1), body));
-
   auto init_uf = [&](UninterpFun uf, PrimExpr max_extent, Buffer loadee,
                      PrimExpr body = NullValue<PrimExpr>()) {
     UninterpFunNode* uf_node = const_cast<UninterpFunNode*>(uf.as<UninterpFunNode>());
@@ -492,7 +890,7 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage,
         uf_node->SetBody(body);
         // std::cout << "[FG]   Custom body " << uf << std::endl;
       } else {
-        uf_node->SetBody(loadee.vload(extents, DataType::Int(32)));
+        uf_node->SetBody(LoadAux(loadee, extents));
         // std::cout << "[FG]   Loadee body " << uf << std::endl;
       }
     }
@@ -501,13 +899,111 @@ Stmt FusionFunctionGenerator::generate_fusion_statements(Stage& stage,
 
   init_uf(rel->fused_to_outer_uf, outer_extent, fused_to_outer_bufs.second);
   init_uf(rel->fused_to_inner_uf, inner_extent, fused_to_inner_bufs.second);
-  auto oif_body = outer_to_fused_pos_bufs.second.vload(
-                      {rel->outer_inner_to_fused_uf->parameters[0]}, DataType::Int(32)) +
+  auto oif_body = LoadAux(outer_to_fused_pos_bufs.second,
+                              {rel->outer_inner_to_fused_uf->parameters[0]}) +
                   rel->outer_inner_to_fused_uf->parameters[1];
   init_uf(rel->outer_inner_to_fused_uf, fused_extent, outer_to_fused_pos_bufs.second, oif_body);
   return body;
 }
 
+std::vector<std::pair<Buffer, Buffer>> FusionFunctionGenerator::GetFusionBuffers(
+    Array<PrimExpr> key, PrimExpr fused_extent, PrimExpr outer_min, PrimExpr outer_extent,
+    PrimExpr inner_min, PrimExpr inner_extent, std::string prefix, bool* p_found) {
+  *p_found = false;
+  if (shared) {
+    if (auto entry = shared->FindFusion(key)) {
+      *p_found = true;
+      return entry->buffers;
+    }
+  }
+
+  DataType outer_dtype = AuxBufferType(outer_extent - 1, outer_min);
+  if (outer_dtype == DataType::Int(32) && BuildConfig::Current()->compact_fusion_buffers) {
+    const IntImmNode* outer_max_imm = Simplify(outer_extent - 1).as<IntImmNode>();
+    const IntImmNode* outer_min_imm = Simplify(outer_min).as<IntImmNode>();
+    if (outer_max_imm && outer_min_imm) {
+      DataType compact = NarrowestAuxType(outer_min_imm->value, outer_max_imm->value);
+      if (compact.bits() <= 16) outer_dtype = compact;
+    }
+  }
+
+  std::string suffix = std::to_string(shared ? shared->fusion_count++ : count);
+  return {agg_pair.create_buffer_pair({fused_extent}, AuxBufferType(inner_extent - 1, inner_min),
+                                     prefix + "fi" + suffix),
+          agg_pair.create_buffer_pair({fused_extent}, outer_dtype, prefix + "fo" + suffix),
+          agg_pair.create_buffer_pair({outer_extent}, AuxBufferType(fused_extent),
+                                     prefix + "ofp" + suffix)};
+}
+
+Stmt FusionFunctionGenerator::AddFusionBody(Array<PrimExpr> key,
+                                            const std::vector<std::pair<Buffer, Buffer>>& bufs,
+                                            Stmt body) {
+  if (!shared) {
+    return body;
+  }
+  shared->fusion_entries.push_back({key, bufs});
+  shared->fusion_stmts.push_back(body);
+  return EvaluateNode::make(0);
+}
+
+AggregatorPair* SharedPrepCodeNode::GetAggregatorPair(bool distinct_device) {
+  if (!agg_pair) {
+    this->distinct_device = distinct_device;
+    agg_pair = std::unique_ptr<AggregatorPair>(new AggregatorPair(distinct_device));
+  }
+  CHECK_EQ(this->distinct_device, distinct_device)
+      << "Prep code can only be shared between schedules lowered for the same device";
+  return agg_pair.get();
+}
+
+std::pair<Buffer, Buffer> SharedPrepCodeNode::KernelAggregateBuffers() {
+  auto with_symbolic_size = [this](Buffer buf) {
+    return BufferNode::make(buf->data, buf->dtype, {size_var}, {}, 0, buf->name, buf->scope, 0, 0,
+                            kDefault, kAll);
+  };
+  auto agg_bufs = agg_pair->aggregate_buffers();
+  Buffer host_buf = with_symbolic_size(agg_bufs.first);
+  Buffer dev_buf = distinct_device ? with_symbolic_size(agg_bufs.second) : host_buf;
+  return std::make_pair(host_buf, dev_buf);
+}
+
+const SharedPrepCodeNode::FusionEntry* SharedPrepCodeNode::FindFusion(
+    const Array<PrimExpr>& key) const {
+  for (const auto& entry : fusion_entries) {
+    bool equal = entry.key.size() == key.size();
+    for (size_t i = 0; equal && i < key.size(); ++i) {
+      equal = tir::Equal(entry.key[i], key[i]);
+    }
+    if (equal) return &entry;
+  }
+  return nullptr;
+}
+
+Stmt SharedPrepCodeNode::Prelude() {
+  CHECK(agg_pair) << "No schedule sharing this prep code has been lowered yet";
+  auto agg_bufs = agg_pair->aggregate_buffers();
+  Map<Buffer, Buffer> buffer_map;
+  buffer_map.Set(agg_bufs.first, agg_bufs.second);
+  Array<Stmt> stmts;
+  stmts.push_back_all(fusion_stmts);
+  stmts.push_back_all(afun_stmts);
+  if (!is_zero(agg_pair->aggregate_size()) && distinct_device) {
+    stmts.push_back(
+        CopyAggregateToDevice(agg_bufs.first, agg_bufs.second, agg_pair->aggregate_size()));
+  }
+  return AttrStmtNode::make(buffer_map, attr::prep_code_scope, 0, SeqStmt(stmts));
+}
+
+TVM_REGISTER_NODE_TYPE(SharedPrepCodeNode);
+
+TVM_REGISTER_GLOBAL("te.SharedPrepCode").set_body_typed([]() {
+  return SharedPrepCode(make_object<SharedPrepCodeNode>());
+});
+
+TVM_REGISTER_GLOBAL("te.SharedPrepCodePrelude").set_body_typed([](SharedPrepCode shared) {
+  return shared->Prelude();
+});
+
 std::pair<Buffer, Buffer> AggregatorPair::create_buffer_pair(Array<PrimExpr> extents,
                                                              DataType buf_dtype, std::string name) {
   if (distinct_device) {
@@ -638,20 +1134,191 @@ Stmt FunctionGenerator::SimplifyFusionFunctions(Stmt body) {
 }
 
 void FunctionGenerator::GenerateAFunctions() {
-  AFunctionGenerator generator(sch, &buffer_map, &agg_pair, debug_fill_function_bodies,
-                               afuns_needed_for);
-  afun_stmt = generator.Generate();
+  AFunctionGenerator generator(sch, &buffer_map, active_agg_pair(), debug_fill_function_bodies,
+                               afuns_needed_for, shared.defined() ? shared.operator->() : nullptr);
+  PermutationGenerator perm_generator(sch, active_agg_pair(), debug_fill_function_bodies,
+                                      shared.defined() ? shared.operator->() : nullptr);
+  afun_stmt = SeqStmt({generator.Generate(), perm_generator.Generate()});
   // std::cout << "[AFUNSTMT]\n " << afun_stmt << std::endl;
   // exit(0);
 }
 
+/*!
+ * \brief Strength reduces the fusion function lookups of serial loops
+ * over consecutive fused positions, see
+ * FunctionGenerator::StrengthReduceFusedLookups.
+ */
+class FusedLookupStrengthReducer : public StmtExprMutator {
+ public:
+  explicit FusedLookupStrengthReducer(const std::vector<FusedLookup>& lookups) {
+    for (size_t i = 0; i < lookups.size(); ++i) {
+      uf_map[lookups[i].fused_to_outer_uf.get()] = {&lookups[i], true};
+      uf_map[lookups[i].fused_to_inner_uf.get()] = {&lookups[i], false};
+    }
+  }
+
+  Stmt VisitStmt_(const ForNode* op) final {
+    Stmt stmt = StmtExprMutator::VisitStmt_(op);
+    op = stmt.as<ForNode>();
+    if (op->for_type != ForType::Serial) return stmt;
+
+    std::unordered_set<const VarNode*> body_vars;
+    PostOrderVisit(op->body, [&](const ObjectRef& node) {
+      if (auto loop = node.as<ForNode>()) {
+        body_vars.insert(loop->loop_var.get());
+      } else if (auto let = node.as<LetStmtNode>()) {
+        body_vars.insert(let->var.get());
+      } else if (auto let = node.as<LetNode>()) {
+        body_vars.insert(let->var.get());
+      } else if (auto attr = node.as<AttrStmtNode>()) {
+        if (auto iv = attr->node.as<IterVarNode>()) body_vars.insert(iv->var.get());
+      }
+    });
+
+    // Group the lookups of the loop by the fused position they are
+    // made at, which has to advance by one per iteration.
+    groups.clear();
+    PostOrderVisit(op->body, [&](const ObjectRef& node) {
+      auto call = node.as<CallNode>();
+      if (!call || !uf_map.count(call->func.get()) || call->args.size() != 1) return;
+      PrimExpr pos = call->args[0];
+      Array<PrimExpr> coeffs = arith::DetectLinearEquation(pos, {op->loop_var});
+      if (coeffs.size() != 2 || !is_one(Simplify(coeffs[0]))) return;
+      bool invariant = true;
+      PostOrderVisit(coeffs[1], [&](const ObjectRef& n) {
+        if (body_vars.count(n.as<VarNode>())) invariant = false;
+      });
+      if (!invariant) return;
+      const FusedLookup* lookup = uf_map.at(call->func.get()).first;
+      for (auto& group : groups) {
+        if (group.lookup == lookup && Equal(group.pos, pos)) return;
+      }
+      groups.push_back({lookup, pos});
+    });
+    if (groups.empty()) return stmt;
+
+    Array<Stmt> init;
+    Array<Stmt> advance;
+    for (auto& group : groups) {
+      std::string prefix = op->loop_var->name_hint + "_f" + std::to_string(num_groups++);
+      group.outer = Var(prefix + "_o", DataType::Handle());
+      group.inner = Var(prefix + "_i", DataType::Handle());
+      group.row_end = Var(prefix + "_e", DataType::Handle());
+      PrimExpr outer = LoadState(group.outer);
+      PrimExpr inner = LoadState(group.inner);
+      // Positions past the last row hold no valid outer value, clamp
+      // it so that the row bounds can still be read.
+      Range outer_range = group.lookup->fused_to_outer_uf->range;
+      PrimExpr clamped = max(min(outer, outer_range->min + outer_range->extent - 1), 0);
+      PrimExpr row_end =
+          VarReplacer({{group.lookup->outer_var.get(), clamped}})(group.lookup->inner_min +
+                                                                  group.lookup->inner_extent);
+      // The lookups of the body are guarded by the fused extent, but
+      // these run for the positions past it in a tail tile too. Clamp
+      // them to the fusion buffers, the values read are then unused.
+      auto reload = [&](PrimExpr pos) {
+        pos = min(pos, group.lookup->fused_max);
+        return SeqStmt({StoreState(group.outer, Lookup(group.lookup->fused_to_outer_uf, pos)),
+                        StoreState(group.inner, Lookup(group.lookup->fused_to_inner_uf, pos)),
+                        StoreState(group.row_end, row_end)});
+      };
+      init.push_back(reload(VarReplacer({{op->loop_var.get(), op->min}})(group.pos)));
+      advance.push_back(IfThenElseNode::make(inner + 1 < LoadState(group.row_end),
+                                             StoreState(group.inner, inner + 1),
+                                             reload(group.pos)));
+    }
+
+    Stmt body = this->Replace(op->body);
+    body = SeqStmt({IfThenElseNode::make(op->loop_var > op->min, SeqStmt(advance)), body});
+    stmt = ForNode::make(op->loop_var, op->min, op->extent, op->for_type, op->device_api, body,
+                         op->hfuse_group_id);
+    stmt = SeqStmt({SeqStmt(init), stmt});
+    for (auto& group : groups) {
+      for (Var state : {group.outer, group.inner, group.row_end}) {
+        stmt = AttrStmtNode::make(
+            state, attr::storage_scope, StringImmNode::make("local"),
+            AllocateNode::make(state, DataType::Int(32), {1}, IntImm(DataType::Bool(1), 1), stmt));
+      }
+    }
+    groups.clear();
+    return stmt;
+  }
+
+ private:
+  struct Group {
+    const FusedLookup* lookup;
+    PrimExpr pos;
+    Var outer;
+    Var inner;
+    Var row_end;
+  };
+
+  static PrimExpr LoadState(Var state) {
+    return LoadNode::make(DataType::Int(32), state, 0, const_true(), kAll);
+  }
+
+  static Stmt StoreState(Var state, PrimExpr value) {
+    return StoreNode::make(state, cast(DataType::Int(32), value), 0, const_true(), kAll);
+  }
+
+  static PrimExpr Lookup(UninterpFun uf, PrimExpr pos) {
+    return uf.MakeCallTo(Array<PrimExpr>({pos}), uf->dimensions, DataType::Int(32));
+  }
+
+  // Replaces the lookups of the groups of the loop being rewritten by
+  // the running values.
+  Stmt Replace(Stmt body) {
+    class Replacer : public StmtExprMutator {
+     public:
+      Replacer(const std::unordered_map<const Object*, std::pair<const FusedLookup*, bool>>& uf_map,
+               const std::vector<Group>& groups)
+          : uf_map(uf_map), groups(groups) {}
+
+      PrimExpr VisitExpr_(const CallNode* op) final {
+        auto it = uf_map.find(op->func.get());
+        if (it != uf_map.end() && op->args.size() == 1) {
+          for (auto& group : groups) {
+            if (group.lookup == it->second.first && Equal(group.pos, op->args[0])) {
+              PrimExpr value = FusedLookupStrengthReducer::LoadState(
+                  it->second.second ? group.outer : group.inner);
+              return value.dtype() == op->dtype ? value : cast(op->dtype, value);
+            }
+          }
+        }
+        return StmtExprMutator::VisitExpr_(op);
+      }
+
+     private:
+      const std::unordered_map<const Object*, std::pair<const FusedLookup*, bool>>& uf_map;
+      const std::vector<Group>& groups;
+    };
+    return Replacer(uf_map, groups)(body);
+  }
+
+  // Maps the fusion functions to their lookup and whether they are
+  // the fused_to_outer function.
+  std::unordered_map<const Object*, std::pair<const FusedLookup*, bool>> uf_map;
+  std::vector<Group> groups;
+  // Numbers the groups, for unique names of their state
+  int num_groups{0};
+};
+
+Stmt FunctionGenerator::StrengthReduceFusedLookups(Stmt body) {
+  if (!BuildConfig::Current()->incremental_fused_lookups || fused_lookups.empty()) {
+    return body;
+  }
+  return FusedLookupStrengthReducer(fused_lookups)(body);
+}
+
 void FunctionGenerator::GenerateFusionFunctions() {
   FusionFunctionGenerator generator(sch, dom_map, root_layout_map,
                                     stages_to_generate_fusion_funcs_for, &non_negative_objects,
-                                    &buffer_map, &agg_pair, debug_fill_function_bodies);
+                                    &buffer_map, active_agg_pair(), debug_fill_function_bodies,
+                                    shared.defined() ? shared.operator->() : nullptr);
   // std::cout << "[MAPMAP11] " << generator.root_layout_map.defined() << std::endl;
   // std::cout << "[MAPMAP12] " << generator.root_layout_map.size() << std::endl;
   ffun_stmt = generator.Generate();
+  fused_lookups = generator.fused_lookups;
 }
 
 Stmt FunctionGenerator::CreateBody(Stmt body) {
@@ -668,21 +1335,24 @@ Stmt FunctionGenerator::CreateBody(Stmt body) {
     }
   }
 
-  auto agg_buf_pair = agg_pair.aggregate_buffers();
-  auto host_agg_buf = agg_buf_pair.first;
-  auto dev_agg_buf = agg_buf_pair.second;
-  buffer_map.Set(host_agg_buf, dev_agg_buf);
   Stmt prep_code_body;
-  if (is_zero(agg_pair.aggregate_size()) || dev_agg_buf == host_agg_buf) {
+  if (shared.defined()) {
+    // The aggregate buffers are filled and copied by the shared
+    // prelude, the kernel just takes them as arguments.
+    auto agg_buf_pair = shared->KernelAggregateBuffers();
+    buffer_map.Set(agg_buf_pair.first, agg_buf_pair.second);
     prep_code_body = SeqStmt({ffun_stmt, afun_stmt});
   } else {
-    Stmt copy_stmt = EvaluateNode::make(copy_to_device(
-        host_agg_buf->data, 0, dev_agg_buf->data, 0,
-        agg_pair.aggregate_size() * DataType::Int(32).bytes(),
-        Var("src_devtype_dummy", DataType::Handle()), Var("src_devid_dummy", DataType::Handle()),
-        Var("dst_devtype_dummy", DataType::Handle()), Var("dst_devid_dummy", DataType::Handle()),
-        kDLInt, 32));
-    prep_code_body = SeqStmt({ffun_stmt, afun_stmt, copy_stmt});
+    auto agg_buf_pair = agg_pair.aggregate_buffers();
+    auto host_agg_buf = agg_buf_pair.first;
+    auto dev_agg_buf = agg_buf_pair.second;
+    buffer_map.Set(host_agg_buf, dev_agg_buf);
+    if (is_zero(agg_pair.aggregate_size()) || dev_agg_buf == host_agg_buf) {
+      prep_code_body = SeqStmt({ffun_stmt, afun_stmt});
+    } else {
+      Stmt copy_stmt = CopyAggregateToDevice(host_agg_buf, dev_agg_buf, agg_pair.aggregate_size());
+      prep_code_body = SeqStmt({ffun_stmt, afun_stmt, copy_stmt});
+    }
   }
   Stmt prep_code = AttrStmtNode::make(buffer_map, attr::prep_code_scope, 0, prep_code_body);
   // std::cout << "[PREPSTMT]\n " << prep_code << std::endl;
@@ -8,8 +8,10 @@
 #include <tvm/tir/ir_pass.h>
 #include <tvm/tir/stmt_functor.h>
 
+#include <memory>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 namespace tvm {
 namespace te {
@@ -22,6 +24,11 @@ class AllocationAggregator {
         aggregate_buffer_var(aggregate_name_, DataType::Handle()),
         aggregate_allocated_size(0) {}
 
+  /*!
+   * \brief Carve a buffer out of the aggregate. buf_dtype may be
+   * narrower than the aggregate dtype, in which case the buffer is
+   * packed and rounded up to a whole number of aggregate elements.
+   */
   Buffer create_buffer(Array<PrimExpr> extents, DataType buf_dtype, std::string name);
 
   Buffer aggregate_buffer();
@@ -57,25 +64,34 @@ class AggregatorPair {
   AllocationAggregator dev_agg;
 };
 
+class SharedPrepCodeNode;
+
 class AFunctionGenerator {
  public:
   AFunctionGenerator(const Schedule& sch_, Map<Buffer, Buffer>* p_buffer_map_,
                      AggregatorPair* p_agg_pair_, bool debug_fill_function_bodies_,
-                     Array<Buffer> afuns_needed_for_)
+                     Array<Buffer> afuns_needed_for_, SharedPrepCodeNode* shared_ = nullptr)
       : sch(sch_),
         buffer_map(*p_buffer_map_),
         agg_pair(*p_agg_pair_),
         debug_fill_function_bodies(debug_fill_function_bodies_),
-        afuns_needed_for(afuns_needed_for_) {}
+        afuns_needed_for(afuns_needed_for_),
+        shared(shared_) {}
 
   Stmt Generate();
 
+  /*!
+   * \brief The structure an a_fun is computed from: the extent of its
+   * dimension and, for each dimension transitively depending on it,
+   * the body of its l_fun, over canonical parameters, and its maximum.
+   * a_funs of distinct Dimension objects with the same structure, as
+   * in kernels created separately over the same lengths, are shared.
+   */
   struct FunKey {
-    Dimension dimension;
-    std::multiset<const Object*> dependent_dimensions;
+    PrimExpr extent;
+    std::vector<std::pair<PrimExpr, PrimExpr>> dependent_l_funs;
   };
 
- private:
   class FunKeyHasher {
    public:
     size_t operator()(const FunKey& pattern) const;
@@ -86,18 +102,121 @@ class AFunctionGenerator {
     bool operator()(const FunKey& p1, const FunKey& p2) const;
   };
 
+  using FunMap = std::unordered_map<FunKey, UninterpFun, FunKeyHasher, FunKeyEquality>;
+
+ private:
   UninterpFun set_afun(Modes layout, int idx, UninterpFun a_fun_shell);
 
+  FunMap& afun_map();
+
   Schedule sch;
   Map<Buffer, Buffer>& buffer_map;
   AggregatorPair& agg_pair;
   bool debug_fill_function_bodies;
   Array<Buffer> afuns_needed_for;
-  std::unordered_map<FunKey, UninterpFun, FunKeyHasher, FunKeyEquality> dim_afun_map;
+  SharedPrepCodeNode* shared;
+  FunMap dim_afun_map;
   Array<Stmt> stmts;
   int count{0};
 };
 
+/*!
+ * \brief Generates the permutations of the loops scheduled with
+ * Stage::sort_by_length: a counting sort of the loop positions by
+ * decreasing sort key, written into an aux buffer by the prep code.
+ */
+class PermutationGenerator {
+ public:
+  PermutationGenerator(const Schedule& sch_, AggregatorPair* p_agg_pair_,
+                       bool debug_fill_function_bodies_, SharedPrepCodeNode* shared_ = nullptr)
+      : sch(sch_),
+        agg_pair(*p_agg_pair_),
+        debug_fill_function_bodies(debug_fill_function_bodies_),
+        shared(shared_) {}
+
+  Stmt Generate();
+
+ private:
+  Stmt generate_permutation(IterVar iv, UninterpFun permutation, PrimExpr key);
+
+  Schedule sch;
+  AggregatorPair& agg_pair;
+  bool debug_fill_function_bodies;
+  SharedPrepCodeNode* shared;
+  int count{0};
+};
+
+/*!
+ * \brief Prep code shared by all the schedules of a model that use
+ * it through Schedule::share_prep_code.
+ *
+ * The a_funs and fusion functions of all such schedules are
+ * deduplicated (a_funs by their FunKey, fusion functions by the
+ * bounds of the fused loops) and generated once, into aggregate
+ * buffers common to all of them. The kernels only read the aggregate
+ * buffers, which they take as arguments, while the statements
+ * filling them are collected into a single prelude.
+ */
+class SharedPrepCodeNode : public runtime::Object {
+ public:
+  /*! \brief A fusion function generated into the prelude. */
+  struct FusionEntry {
+    Array<PrimExpr> key;
+    std::vector<std::pair<Buffer, Buffer>> buffers;
+  };
+
+  /*! \brief The aggregator all kernels allocate prep code buffers from. */
+  AggregatorPair* GetAggregatorPair(bool distinct_device);
+
+  /*! \brief The aggregate buffers, as seen by the kernels. As later
+   * kernels may grow them, their size is left symbolic. */
+  std::pair<Buffer, Buffer> KernelAggregateBuffers();
+
+  /*! \brief The prelude filling the aggregate buffers for all the
+   * kernels lowered so far. */
+  Stmt Prelude();
+
+  const FusionEntry* FindFusion(const Array<PrimExpr>& key) const;
+
+  void VisitAttrs(AttrVisitor* v) {}
+
+  std::unique_ptr<AggregatorPair> agg_pair;
+  bool distinct_device{false};
+  AFunctionGenerator::FunMap dim_afun_map;
+  std::vector<FusionEntry> fusion_entries;
+  /*! \brief Canonical loop variable the fusion keys are expressed in. */
+  Var key_var{"fkey_outer", DataType::Int(32)};
+  Var size_var{"shared_aux_size", DataType::Int(32)};
+  Array<Stmt> afun_stmts;
+  Array<Stmt> fusion_stmts;
+  int afun_count{0};
+  int fusion_count{0};
+
+  static constexpr const char* _type_key = "te.SharedPrepCode";
+  TVM_DECLARE_FINAL_OBJECT_INFO(SharedPrepCodeNode, Object);
+};
+
+class SharedPrepCode : public ObjectRef {
+ public:
+  TVM_DEFINE_MUTABLE_OBJECT_REF_METHODS(SharedPrepCode, ObjectRef, SharedPrepCodeNode);
+};
+
+/*!
+ * \brief What is needed to walk the fused loop of a RaggedFuseNode
+ * incrementally: the row of an outer value spans the inner values
+ * [inner_min, inner_min + inner_extent), both expressed in terms of
+ * outer_var.
+ */
+struct FusedLookup {
+  UninterpFun fused_to_outer_uf;
+  UninterpFun fused_to_inner_uf;
+  Var outer_var;
+  PrimExpr inner_min;
+  PrimExpr inner_extent;
+  /*! \brief The last fused position the fusion buffers hold */
+  PrimExpr fused_max;
+};
+
 class FusionFunctionGenerator : public StmtExprMutator {
  public:
   FusionFunctionGenerator(const Schedule& sch_, const std::unordered_map<IterVar, Range>& dom_map_,
@@ -105,7 +224,8 @@ class FusionFunctionGenerator : public StmtExprMutator {
                           const std::vector<Stage>& stages_to_generate_for_,
                           Array<ObjectRef>* p_non_negative_objects_,
                           Map<Buffer, Buffer>* p_buffer_map_, AggregatorPair* p_agg_pair_,
-                          bool debug_fill_function_bodies_)
+                          bool debug_fill_function_bodies_,
+                          SharedPrepCodeNode* shared_ = nullptr)
       : sch(sch_),
         dom_map(dom_map_),
         root_layout_map(root_layout_map_),
@@ -114,6 +234,7 @@ class FusionFunctionGenerator : public StmtExprMutator {
         buffer_map(*p_buffer_map_),
         agg_pair(*p_agg_pair_),
         debug_fill_function_bodies(debug_fill_function_bodies_),
+        shared(shared_),
         count(0) {
     for (auto it : root_layout_map_) {
       /* std::cout << "[MAPMAP] " << it.first << " " << it.second << std::endl; */
@@ -135,8 +256,34 @@ class FusionFunctionGenerator : public StmtExprMutator {
   Map<Buffer, Buffer>& buffer_map;
   AggregatorPair& agg_pair;
   bool debug_fill_function_bodies;
+  SharedPrepCodeNode* shared;
+  /*! \brief The fusion functions that can be strength reduced. */
+  std::vector<FusedLookup> fused_lookups;
 
  private:
+  /*!
+   * \brief Look up, or allocate, the fused_to_outer, fused_to_inner
+   * and outer_to_fused_pos buffer pairs of a fusion function with the
+   * given key. Sets *p_found if the function was already generated
+   * into the shared prelude. The outer and inner values are in
+   * [outer_min, outer_extent) and [inner_min, inner_extent), which
+   * narrow_aux_buffers uses to pick the buffer types. With the
+   * compact_fusion_buffers build option, the fused_to_outer buffers
+   * hold 8 or 16 bit values whenever the outer values fit.
+   */
+  std::vector<std::pair<Buffer, Buffer>> GetFusionBuffers(Array<PrimExpr> key,
+                                                          PrimExpr fused_extent,
+                                                          PrimExpr outer_min,
+                                                          PrimExpr outer_extent,
+                                                          PrimExpr inner_min,
+                                                          PrimExpr inner_extent,
+                                                          std::string prefix, bool* p_found);
+
+  /*! \brief Record a newly generated fusion function. Returns the
+   * statement to be added to this schedule's prep code. */
+  Stmt AddFusionBody(Array<PrimExpr> key, const std::vector<std::pair<Buffer, Buffer>>& bufs,
+                     Stmt body);
+
   int count;
 };
 
@@ -167,6 +314,10 @@ class FunctionGenerator {
         agg_pair(distinct_device_),
         debug_fill_function_bodies(debug_fill_function_bodies_),
         afuns_needed_for(afuns_needed_for_) {
+    if (sch->shared_prep_code.defined()) {
+      shared = Downcast<SharedPrepCode>(sch->shared_prep_code);
+      shared->GetAggregatorPair(distinct_device_);
+    }
     for (auto s : sch->stages) {
       for (auto rel : s->dim_relation_graph->relations) {
         if (rel.as<RaggedDimensionFuseNode>()) {
@@ -183,20 +334,37 @@ class FunctionGenerator {
 
   void GenerateFusionFunctions();
 
+  /*!
+   * \brief Replace the fused_to_outer and fused_to_inner lookups
+   * made at consecutive fused positions by a serial loop with a
+   * running (outer, inner) pair, loaded at the first iteration and
+   * advanced in place of every later lookup. The fusion buffers are
+   * only read again when a row ends.
+   */
+  Stmt StrengthReduceFusedLookups(Stmt body);
+
   Stmt CreateBody(Stmt body);
 
-  PrimExpr GetCurrentAggregateBufferSize() { return agg_pair.current_device_buffer_size(); }
+  PrimExpr GetCurrentAggregateBufferSize() {
+    return active_agg_pair()->current_device_buffer_size();
+  }
 
  private:
+  AggregatorPair* active_agg_pair() {
+    return shared.defined() ? shared->agg_pair.get() : &agg_pair;
+  }
+
   const Schedule& sch;
   const std::unordered_map<IterVar, Range>& dom_map;
   AggregatorPair agg_pair;
+  SharedPrepCode shared;
   bool debug_fill_function_bodies;
   Array<Buffer> afuns_needed_for;
   Map<Buffer, Buffer> buffer_map;
   Array<ObjectRef> non_negative_objects;
   std::vector<Stage> stages_to_generate_fusion_funcs_for;
   Map<Stage, Modes> root_layout_map;
+  std::vector<FusedLookup> fused_lookups;
   Stmt afun_stmt;
   Stmt ffun_stmt;
 };
@@ -602,6 +602,66 @@ Stage& Stage::parallel(IterVar var) {  // NOLINT(*)
   return *this;
 }
 
+Stage& Stage::balanced_parallel(IterVar var) {  // NOLINT(*)
+  StageNode* self = operator->();
+  const BaseVarDimOpNode* op = self->op.as<BaseVarDimOpNode>();
+  CHECK(op) << "balanced_parallel is only supported for ragged operations";
+  Modes layout = self->op->output_layout(0);
+  CHECK(layout.defined()) << "balanced_parallel needs the output layout of " << self->op;
+  Dimension dim = op->GetDimensionFromVar(0, var->var);
+  CHECK(layout->dimensions.Contains(dim))
+      << "Dimension " << dim << " is not in the output layout of " << self->op;
+  int idx = layout->dimensions.GetIdx(dim);
+  CHECK(layout->has_dependent_dims(idx))
+      << "No ragged dimension depends on " << dim << ", use parallel instead";
+  // The a_fun of the dimension is the exclusive prefix sum of the
+  // sizes of the slices of the output indexed by it.
+  PrimExpr cost = layout->a_funs[idx].MakeCallTo(Array<PrimExpr>({var->var}), {dim});
+  UpdateIterVarAttr(self, var, [cost](IterVarAttrNode* n) {
+    n->iter_type = kParallelized;
+    n->balanced_cost = cost;
+  });
+  return *this;
+}
+
+Stage& Stage::sort_by_length(IterVar var) {  // NOLINT(*)
+  StageNode* self = operator->();
+  const BaseVarDimOpNode* op = self->op.as<BaseVarDimOpNode>();
+  CHECK(op) << "sort_by_length is only supported for ragged operations";
+  bool leaf = false;
+  for (auto leaf_iv : self->leaf_iter_vars) leaf = leaf || leaf_iv.same_as(var);
+  CHECK(leaf) << "sort_by_length needs a leaf iter var, but " << var
+              << " has been split or fused or is not part of the schedule";
+  Modes layout = self->op->loop_layout();
+  if (!layout.defined()) layout = self->op->output_layout(0);
+  CHECK(layout.defined()) << "sort_by_length needs the loop layout of " << self->op;
+  Dimension dim = op->GetDimensionFromVar(0, var->var);
+  CHECK(layout->dimensions.Contains(dim))
+      << "Dimension " << dim << " is not in the loop layout of " << self->op;
+  int idx = layout->dimensions.GetIdx(dim);
+  CHECK(layout->has_dependent_dims(idx))
+      << "No ragged dimension depends on " << dim << ", there is nothing to sort by";
+  CHECK_EQ(layout->l_funs[idx]->arity(), 0) << "Only loops of constant extent can be sorted";
+
+  // Sort by the extent of the first dimension depending immediately
+  // on the loop. A product of extents would make the number of
+  // buckets of the counting sort grow as a power of the maximum length.
+  Dimension dependent_dim = layout->get_immediate_dependent_dims(idx)[0];
+  UninterpFun l_fun = layout->l_funs[layout->dimensions.GetIdx(dependent_dim)];
+  PrimExpr key = l_fun.MakeCallTo(Array<PrimExpr>({var->var}), {dim});
+  // The body, a load from the permutation buffer, is set by the prep
+  // code generation.
+  UninterpFun permutation = UninterpFunNode::make(
+      var->var->name_hint + "_perm",
+      Range::make_by_min_extent(0, layout->l_funs[idx]->range->max_inclusive()), {dim},
+      {Var("param", DataType::Int(32))}, NullValue<PrimExpr>());
+  UpdateIterVarAttr(self, var, [permutation, key](IterVarAttrNode* n) {
+    n->permutation = permutation;
+    n->permutation_key = key;
+  });
+  return *this;
+}
+
 Stage& Stage::pragma(IterVar var, const std::string& pragma_type,
                      const PrimExpr& pragma_value) {  // NOLINT(*)
   if (pragma_type == "unroll") {
@@ -609,6 +669,14 @@ Stage& Stage::pragma(IterVar var, const std::string& pragma_type,
   } else if (pragma_type == "vectorize") {
     this->vectorize(var);
   } else {
+    if (pragma_type == "parallel_dynamic") {
+      // Workers claim chunks of this many iterations, so a chunk that
+      // is not positive would never advance the claim counter.
+      const IntImmNode* chunk = pragma_value.as<IntImmNode>();
+      CHECK(chunk != nullptr && chunk->value > 0)
+          << "The chunk of pragma parallel_dynamic should be a positive integer constant, "
+          << "but got " << pragma_value;
+    }
     UpdateIterVarAttr(operator->(), var, [pragma_type, pragma_value](IterVarAttrNode* n) {
       n->pragma_keys.push_back(tir::StringImmNode::make(pragma_type));
       n->pragma_values.push_back(pragma_value);
@@ -723,6 +791,8 @@ Schedule Schedule::copy() const {
   ObjectPtr<ScheduleNode> n = make_object<ScheduleNode>();
   n->outputs = self->outputs;
   n->cacheTensorInfos = self->cacheTensorInfos;
+  n->prep_code_scan_blocks = self->prep_code_scan_blocks;
+  n->shared_prep_code = self->shared_prep_code;
   // Copy the stages.
   for (Stage s : self->stages) {
     Stage scopy = CopyStage(s);
@@ -954,6 +1024,15 @@ void Schedule::hfuse(const Array<Operation>& ops, const Array<IterVar>& ivs) {
   }
 }
 
+void Schedule::parallel_prep_code(int num_blocks) {
+  CHECK_GE(num_blocks, 0) << "The number of prep code scan blocks cannot be negative";
+  (*this)->prep_code_scan_blocks = num_blocks;
+}
+
+void Schedule::share_prep_code(ObjectRef shared_prep_code) {
+  (*this)->shared_prep_code = shared_prep_code;
+}
+
 void ScheduleNode::InvalidateCache() { op2stage_cache_.clear(); }
 
 void ScheduleNode::InitCache() {
@@ -1237,6 +1316,10 @@ TVM_REGISTER_GLOBAL("te.StageTensorize").set_body_method(&Stage::tensorize);
 
 TVM_REGISTER_GLOBAL("te.StageParallel").set_body_method(&Stage::parallel);
 
+TVM_REGISTER_GLOBAL("te.StageBalancedParallel").set_body_method(&Stage::balanced_parallel);
+
+TVM_REGISTER_GLOBAL("te.StageSortByLength").set_body_method(&Stage::sort_by_length);
+
 TVM_REGISTER_GLOBAL("te.StagePragma").set_body_method(&Stage::pragma);
 
 TVM_REGISTER_GLOBAL("te.StagePrefetch").set_body_method(&Stage::prefetch);
@@ -1258,6 +1341,8 @@ TVM_REGISTER_GLOBAL("te.ScheduleCacheRead").set_body_method(&Schedule::cache_rea
 
 TVM_REGISTER_GLOBAL("te.SplitForBinPacking").set_body_method(&Schedule::split_for_bin_packing);
 
+TVM_REGISTER_GLOBAL("te.BinPackSplitPoints").set_body_typed(MakeBinPackSplitPoints);
+
 TVM_REGISTER_GLOBAL("te.ScheduleCacheReadOpaque").set_body_method(&Schedule::cache_read_opaque);
 
 TVM_REGISTER_GLOBAL("te.ScheduleCacheReadOpaqueAllReaders")
@@ -1285,6 +1370,10 @@ TVM_REGISTER_GLOBAL("te.ScheduleRFactor").set_body_method(&Schedule::rfactor);
 
 TVM_REGISTER_GLOBAL("te.ScheduleHFuse").set_body_method(&Schedule::hfuse);
 
+TVM_REGISTER_GLOBAL("te.ScheduleParallelPrepCode").set_body_method(&Schedule::parallel_prep_code);
+
+TVM_REGISTER_GLOBAL("te.ScheduleSharePrepCode").set_body_method(&Schedule::share_prep_code);
+
 TVM_REGISTER_GLOBAL("te.ScheduleSingleKernel").set_body_method(&Schedule::single_kernel);
 
 TVM_REGISTER_GLOBAL("te.ScheduleUnify").set_body_method(&Schedule::unify);
@@ -31,6 +31,7 @@
 #include <unordered_set>
 #include <utility>
 
+#include "../../support/compile_profiler.h"
 #include "../../tir/ir/var_replacer.h"
 #include "../../tir/pass/ir_util.h"
 #include "../operation/op_util.h"
@@ -769,13 +770,19 @@ Stmt ScheduleOps(Schedule sch, InferBoundsResult bounds, bool debug_keep_trivial
   // Generate A functions for all layouts
   FunctionGenerator function_generator(sch, dom_map, distinct_device, debug_fill_function_bodies,
                                        afuns_needed_for);
-  function_generator.GenerateAFunctions();
+  {
+    support::CompileProfileScope profile("ScheduleOps.GenerateAFunctions");
+    function_generator.GenerateAFunctions();
+  }
   PrimExpr afun_buf_size = function_generator.GetCurrentAggregateBufferSize();
   // Map<Buffer, Buffer> prep_buffer_map;
   // AFunGenerator generator(sch);
   // Stmt a_fun_stmt = generator.GenerateAndSetAFuns(&prep_buffer_map);
 
-  sch.freeze_tensor_dimensions(dom_map_);
+  {
+    support::CompileProfileScope profile("ScheduleOps.FreezeTensorDimensions");
+    sch.freeze_tensor_dimensions(dom_map_);
+  }
 
   Stmt body = Stmt();
   // scan init and scan updates
@@ -837,7 +844,7 @@ Stmt ScheduleOps(Schedule sch, InferBoundsResult bounds, bool debug_keep_trivial
               << "Only stages attached at the root can be hfused";
           CHECK_EQ(i, 0) << "Only the outermost leaf itervars can be hfused";
           CHECK(!hfuse_group_mapping.count(s.get())) << "One op cannot be hfused multiple times";
-          CHECK(it_attr->bind_thread.defined() || iv->iter_type == kParallelized)
+          CHECK(it_attr->bind_thread.defined() || it_attr->iter_type == kParallelized)
               << "We only allow hfusion for parallel loops right now as storage_rewrite does not "
                  "handle the sequential loop case correctly ";
           hfuse_group_mapping[s.get()] = it_attr->hfuse_group_id;
@@ -883,6 +890,7 @@ Stmt ScheduleOps(Schedule sch, InferBoundsResult bounds, bool debug_keep_trivial
 
   // std::cout << "[SO] Generating code" << std::endl;
   // reverse the post DFS order.
+  support::CompileProfileScope inject_profile("ScheduleOps.InjectStages");
   int previous_hfuse_group_id = -1;
   // for (size_t i = stage_order.size(); i != 0; --i) {
   // Stage s = stage_order[i - 1];
@@ -984,12 +992,27 @@ Stmt ScheduleOps(Schedule sch, InferBoundsResult bounds, bool debug_keep_trivial
     previous_hfuse_group_id = current_hfuse_group_id;
   }
 
+  inject_profile.End();
+
   // std::cout << "Body after gen " << body << std::endl;
-  body = function_generator.SimplifyFusionFunctions(body);
+  {
+    support::CompileProfileScope profile("ScheduleOps.SimplifyFusionFunctions");
+    body = function_generator.SimplifyFusionFunctions(body);
+  }
   // std::cout << "Body after function simpl " << body << std::endl;
   // exit(0);
-  function_generator.GenerateFusionFunctions();
-  body = function_generator.CreateBody(body);
+  {
+    support::CompileProfileScope profile("ScheduleOps.GenerateFusionFunctions");
+    function_generator.GenerateFusionFunctions();
+  }
+  {
+    support::CompileProfileScope profile("ScheduleOps.StrengthReduceFusedLookups");
+    body = function_generator.StrengthReduceFusedLookups(body);
+  }
+  {
+    support::CompileProfileScope profile("ScheduleOps.CreateBody");
+    body = function_generator.CreateBody(body);
+  }
 
   PrimExpr total_buf_size = function_generator.GetCurrentAggregateBufferSize();
 
@@ -997,6 +1020,7 @@ Stmt ScheduleOps(Schedule sch, InferBoundsResult bounds, bool debug_keep_trivial
   // << std::endl;
 
   // std::cout << "Body after function gen " << body << std::endl;
+  support::CompileProfileScope post_proc_profile("ScheduleOps.PostProc");
   sch->InvalidateCache();
   sch->InitCache();
   SchedulePostProc post_proc;
@@ -1011,6 +1035,8 @@ Stmt ScheduleOps(Schedule sch, InferBoundsResult bounds, bool debug_keep_trivial
   // Stmt ret3 = env_replace(std::move(ret2));
   Stmt ret3 = std::move(ret2);
   // std::cout << "Body after postproc2 " << ret2 << std::endl;
+  post_proc_profile.End();
+  support::CompileProfileScope inline_profile("ScheduleOps.InlineUninterpFunCalls");
   return UninterpFun::InlineUninterpFunCalls(ret3);
 }
 
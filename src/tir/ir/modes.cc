@@ -1,3 +1,4 @@
+#include <tvm/arith/analyzer.h>
 #include <tvm/arith/int_set.h>
 #include <tvm/ir/attrs.h>
 #include <tvm/runtime/registry.h>
@@ -5,11 +6,14 @@
 #include <tvm/te/dimension.h>
 #include <tvm/tir/expr_equality.h>
 #include <tvm/tir/expr_functor.h>
+#include <tvm/tir/ir_pass.h>
+#include <tvm/tir/op.h>
 #include <tvm/tir/uf_equality.h>
 #include <tvm/tir/uninterp_fun.h>
 
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <unordered_set>
 #include <vector>
 
@@ -141,6 +145,89 @@ Modes ModesNode::make_storage_layout(Array<tvm::te::Dimension> dimensions, Array
   return ModesNode::make(dimensions, l_maxes, {}, l_funs, user_a_funs, false);
 }
 
+Modes ModesNode::make_padded_storage_layout(Array<tvm::te::Dimension> dimensions,
+                                            Array<PrimExpr> l_maxes, Array<UninterpFun> l_funs,
+                                            Array<Integer> bucket_sizes,
+                                            Map<Dimension, UninterpFun> user_a_funs) {
+  CHECK_EQ(l_funs.size(), bucket_sizes.size());
+  Array<UninterpFun> padded_l_funs;
+  for (size_t i = 0; i < l_funs.size(); ++i) {
+    int bucket_size = bucket_sizes[i];
+    if (bucket_size > 1 && l_maxes.size() > 0) {
+      auto pl_max = l_maxes[i].as<IntImmNode>();
+      CHECK(pl_max == nullptr || pl_max->value % bucket_size == 0)
+          << "The dense extent " << l_maxes[i] << " of " << dimensions[i]->name
+          << " should be a multiple of its bucket size " << bucket_size;
+    }
+    padded_l_funs.push_back(UninterpFun::MakePaddedLFun(l_funs[i], bucket_size));
+  }
+  return ModesNode::make(dimensions, l_maxes, {}, padded_l_funs, user_a_funs, false);
+}
+
+Modes ModesNode::make_row_aligned_storage_layout(Modes layout, int dim_idx, int factor) {
+  CHECK(!layout->loop_layout) << "Only storage layouts can be row aligned";
+  CHECK_GT(factor, 0);
+  CHECK(dim_idx >= 0 && static_cast<size_t>(dim_idx) < layout->ndim());
+  CHECK(layout->is_ragged(dim_idx)) << "Dimension " << layout->dimensions[dim_idx]->name
+                                    << " of layout " << layout << " is not ragged";
+
+  // The dimensions inside a row need to be dense with constant
+  // extents so that the padding needed is known statically.
+  Array<PrimExpr> dense_shape = layout->get_dense_shape();
+  int64_t inner_size = 1;
+  for (size_t i = dim_idx + 1; i < layout->ndim(); ++i) {
+    PrimExpr extent = Simplify(dense_shape[i]);
+    auto pextent = extent.as<IntImmNode>();
+    CHECK(!layout->is_ragged(i) && pextent)
+        << "Cannot align the rows of " << layout->dimensions[dim_idx]->name
+        << " as the inner dimension " << layout->dimensions[i]->name << " is not dense";
+    inner_size *= pextent->value;
+  }
+  int64_t a = factor, b = inner_size;
+  while (b != 0) {
+    int64_t r = a % b;
+    a = b;
+    b = r;
+  }
+  int bucket_size = static_cast<int>(factor / a);
+  if (bucket_size == 1) return layout;
+
+  Array<PrimExpr> l_maxes;
+  Array<UninterpFun> l_funs;
+  for (size_t i = 0; i < layout->ndim(); ++i) {
+    PrimExpr l_max = layout->l_maxes.size() > 0 ? layout->l_maxes[i] : dense_shape[i];
+    UninterpFun l_fun = layout->l_funs[i];
+    if (static_cast<int>(i) == dim_idx) {
+      l_max = Simplify(floordiv(l_max + (bucket_size - 1), bucket_size) * bucket_size);
+      l_fun = UninterpFun::MakePaddedLFun(l_fun, bucket_size);
+    }
+    l_maxes.push_back(l_max);
+    l_funs.push_back(l_fun);
+  }
+
+  // The a_funs without bodies are generated later, and are recreated
+  // here to account for the padded lengths. User provided a_funs
+  // cannot be, and are only kept for the dimensions the padded
+  // dimension does not affect.
+  Dimension aligned_dim = layout->dimensions[dim_idx];
+  Map<Dimension, UninterpFun> user_a_funs;
+  for (size_t i = 0; i < layout->ndim(); ++i) {
+    UninterpFun a_fun = layout->a_funs.size() > 0 ? layout->a_funs[i] : NullValue<UninterpFun>();
+    if (!a_fun.defined() || !a_fun->body.defined()) continue;
+    bool affected = false;
+    if (layout->has_dependent_dims(i)) {
+      for (auto dependent_dim : layout->get_transitive_dependent_dims(i)) {
+        affected = affected || dependent_dim.same_as(aligned_dim);
+      }
+    }
+    CHECK(!affected) << "Cannot align the rows of " << aligned_dim->name
+                     << " as the positions of " << layout->dimensions[i]->name
+                     << " are given by the user";
+    user_a_funs.Set(layout->dimensions[i], a_fun);
+  }
+  return ModesNode::make(layout->dimensions, l_maxes, {}, l_funs, user_a_funs, false);
+}
+
 Modes ModesNode::make(std::string name, Array<PrimExpr> dense_shape, bool is_loop_layout) {
   Array<Dimension> dimensions;
   for (size_t i = 0; i < dense_shape.size(); ++i) {
@@ -170,6 +257,10 @@ const bool ModesNode::is_ragged() const {
   return false;
 }
 
+TVM_REGISTER_GLOBAL("tir.ModesIndexBits").set_body_typed([](Modes modes) {
+  return modes->get_dtype().bits();
+});
+
 TVM_REGISTER_GLOBAL("tir.ModesIsRagged").set_body_typed([](Modes modes) {
   return modes->is_ragged();
 });
@@ -263,18 +354,20 @@ const PrimExpr ComputeTExpr(const ModesNode* self, int dim_idx, Array<PrimExpr>
   bool print2 = print && (dim_idx == 0);
   if (print2) std::cout << "[CP]  iDim " << dim << std::endl;
 
-  PrimExpr t_expr = 1;
+  DataType dtype = self->get_dtype();
+  PrimExpr t_expr = make_const(dtype, 1);
   std::unordered_set<const Object*> handled_already;
   if (self->has_dependent_dims(dim_idx)) {
     CHECK(self->a_funs[dim_idx].defined()) << dim_idx << " " << self->dimensions[dim_idx];
-    t_expr = self->a_funs[dim_idx].MakeCallTo(Array<PrimExpr>(relaxed_coords), self->dimensions);
+    t_expr = self->a_funs[dim_idx].MakeCallTo(Array<PrimExpr>(relaxed_coords), self->dimensions,
+                                              dtype);
     if (print2) std::cout << "[CP]      Transitive dependent dims" << std::endl;
     for (auto dim : self->get_transitive_dependent_dims(dim_idx)) {
       if (print2) std::cout << "[CP]         " << dim << std::endl;
       handled_already.insert(dim.get());
     }
   } else {
-    t_expr = relaxed_coords[dim_idx];
+    t_expr = cast(dtype, relaxed_coords[dim_idx]);
   }
   if (print2) std::cout << "[CP]     t_expr update " << t_expr << std::endl;
 
@@ -287,8 +380,8 @@ const PrimExpr ComputeTExpr(const ModesNode* self, int dim_idx, Array<PrimExpr>
 
     if (self->has_dependent_dims(j)) {
       CHECK(self->a_funs[j].defined());
-      t_expr =
-          t_expr * self->a_funs[j].MakeCallTo(Array<PrimExpr>(relaxed_coords), self->dimensions);
+      t_expr = t_expr * self->a_funs[j].MakeCallTo(Array<PrimExpr>(relaxed_coords),
+                                                   self->dimensions, dtype);
       if (print2) std::cout << "[CP]      Transitive dependent dims" << std::endl;
       for (auto dim : self->get_transitive_dependent_dims(j)) {
         if (print2) std::cout << "[CP]         " << dim << std::endl;
@@ -296,8 +389,8 @@ const PrimExpr ComputeTExpr(const ModesNode* self, int dim_idx, Array<PrimExpr>
       }
     } else {
       CHECK(self->l_funs[j].defined());
-      t_expr =
-          t_expr * self->l_funs[j].MakeCallTo(Array<PrimExpr>(relaxed_coords), self->dimensions);
+      t_expr = t_expr * self->l_funs[j].MakeCallTo(Array<PrimExpr>(relaxed_coords),
+                                                   self->dimensions, dtype);
     }
     if (print2) std::cout << "[CP]     t_expr update " << t_expr << std::endl;
   }
@@ -315,7 +408,7 @@ const PrimExpr ModesNode::ComputePosition(std::string name, Array<PrimExpr> coor
   }
 
   // std::cout << "[CP] For " << name << std::endl;
-  PrimExpr lowered_offset = 0;
+  PrimExpr lowered_offset = make_zero(get_dtype());
 
   std::vector<PrimExpr> relaxed_coords;
   for (auto coord : coords) {
@@ -375,9 +468,10 @@ const PrimExpr ModesNode::ComputePosition(std::string name, Array<PrimExpr> coor
       return static_cast<int>(ndim());
   };
 
+  DataType dtype = get_dtype();
   auto get_width = [&](int i) {
     CHECK(!is_ragged(i));
-    return l_funs[i]->range->max_inclusive();
+    return cast(dtype, l_funs[i]->range->max_inclusive());
   };
 
   auto get_ragged_contribution = [&](int i, std::set<int> processed, int processing) {
@@ -391,9 +485,9 @@ const PrimExpr ModesNode::ComputePosition(std::string name, Array<PrimExpr> coor
         processed.end(), std::inserter(processed_dependent_dims, processed_dependent_dims.begin()));
 
     if (processed_dependent_dims.size() == 0 && !outer_dependent_dims.count(processing)) {
-      return l_funs[i].MakeCallTo(coords, relevant_dims);
+      return l_funs[i].MakeCallTo(coords, relevant_dims, dtype);
     } else if (processed_dependent_dims.size() == 0 && outer_dependent_dims.count(processing)) {
-      return a_funs[i].MakeCallTo(coords, relevant_dims);
+      return a_funs[i].MakeCallTo(coords, relevant_dims, dtype);
     } else {
       Array<PrimExpr> args;
       CHECK(a_funs[i].defined());
@@ -404,18 +498,18 @@ const PrimExpr ModesNode::ComputePosition(std::string name, Array<PrimExpr> coor
         int dim_idx = dimensions.GetIdx(in_dim);
         if (processed_dependent_dims.count(dim_idx)) {
           CHECK(!is_ragged(dim_idx));
-          args.push_back(get_width(dim_idx));
+          args.push_back(l_funs[dim_idx]->range->max_inclusive());
         } else {
           args.push_back(coords[dim_idx]);
         }
       }
 
-      return a_funs[i].MakeCallTo(args, a_funs[i]->dimensions);
+      return a_funs[i].MakeCallTo(args, a_funs[i]->dimensions, dtype);
     }
   };
 
   int num_dims = relevant_dims.size();
-  PrimExpr offset = 0;
+  PrimExpr offset = make_zero(dtype);
   std::set<int> processed;
   for (int i = num_dims - 1; i >= 0; --i) {
     Dimension i_dim = relevant_dims[i];
@@ -431,7 +525,7 @@ const PrimExpr ModesNode::ComputePosition(std::string name, Array<PrimExpr> coor
     }
 
     if (outermost_dependent_dimension == static_cast<int>(ndim())) {
-      this_offset = coords[i];
+      this_offset = cast(dtype, coords[i]);
     } else {
       this_offset = get_ragged_contribution(outermost_dependent_dimension, processed, i_idx);
       for (auto dependent_dimension : outer_to_inner_deps[i_idx]) {
@@ -470,6 +564,49 @@ const PrimExpr ModesNode::ComputePosition(std::string name, Array<PrimExpr> coor
   return UninterpFun::InlineUninterpFunCalls(offset);
 }
 
+/*! \brief A constant upper bound of e, or -1 if there is none. */
+static int64_t ConstMaxBound(const PrimExpr& e) {
+  if (auto imm = e.as<IntImmNode>()) return imm->value;
+  arith::Analyzer analyzer;
+  int64_t max_value = analyzer.const_int_bound(e)->max_value;
+  return max_value == arith::ConstIntBound::kPosInf ? -1 : max_value;
+}
+
+const DataType ModesNode::get_dtype() const {
+  if (index_bits == 0) {
+    // Multiply the dense extents in int64 as the product may well
+    // overflow the int32 constant folding would do.
+    int64_t bound = 1;
+    bool overflow = false;
+    for (size_t i = 0; i < ndim() && !overflow; ++i) {
+      PrimExpr extent = l_maxes.size() == ndim() ? l_maxes[i] : l_funs[i]->range->max_inclusive();
+      int64_t extent_max = ConstMaxBound(extent);
+      if (extent_max < 0 && l_funs[i].defined()) {
+        // The widths of the dimension are also bounded by its l_fun
+        extent_max = ConstMaxBound(Simplify(UninterpFun::InlineUninterpFunCalls(
+            UninterpFun::RelaxUninterpCallsMaxInclusive(l_funs[i]->range->max_inclusive(),
+                                                        false))));
+      }
+      if (extent_max < 0) {
+        // A symbolic bound, such as a size_var, is taken to fit its
+        // type: int32 ones keep the int32 fast path, while int64 ones
+        // opt the layout into int64 positions.
+        overflow = extent.dtype().bits() > 32 ||
+                   (l_funs[i].defined() && l_funs[i]->range->max_inclusive().dtype().bits() > 32);
+        continue;
+      }
+      if (extent_max > std::numeric_limits<int32_t>::max()) {
+        overflow = true;
+        break;
+      }
+      bound *= std::max<int64_t>(extent_max, 1);
+      overflow = bound > std::numeric_limits<int32_t>::max();
+    }
+    index_bits = overflow ? 64 : 32;
+  }
+  return DataType::Int(index_bits);
+}
+
 const PrimExpr ModesNode::GetAllocationSize() const {
   Array<PrimExpr> l_maxes;
   Array<Dimension> dims;
@@ -490,6 +627,14 @@ TVM_REGISTER_GLOBAL("tir.StorageModes")
       return ModesNode::make_storage_layout(dimensions, l_maxes, l_funs, user_a_funs);
     });
 
+TVM_REGISTER_GLOBAL("tir.PaddedStorageModes")
+    .set_body_typed([](Array<tvm::te::Dimension> dimensions, Array<PrimExpr> l_maxes,
+                       Array<UninterpFun> l_funs, Array<Integer> bucket_sizes,
+                       Map<Dimension, UninterpFun> user_a_funs) {
+      return ModesNode::make_padded_storage_layout(dimensions, l_maxes, l_funs, bucket_sizes,
+                                                   user_a_funs);
+    });
+
 TVM_REGISTER_GLOBAL("tir.LoopModes")
     .set_body_typed([](Array<tvm::te::Dimension> dimensions, Array<PrimExpr> l_maxes,
                        Array<UninterpFun> l_fun_mins, Array<UninterpFun> l_funs) {
@@ -1,10 +1,13 @@
 #include <tvm/arith/int_set.h>
+#include <tvm/arith/pattern.h>
 #include <tvm/ir/attrs.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/te/cache_info.h>
 #include <tvm/te/dimension.h>
 #include <tvm/tir/expr_equality.h>
 #include <tvm/tir/expr_functor.h>
+#include <tvm/tir/ir_pass.h>
+#include <tvm/tir/op.h>
 #include <tvm/tir/uf_equality.h>
 #include <tvm/tir/uninterp_fun.h>
 
@@ -286,7 +289,10 @@ class UninterpCallInliner : StmtExprMutator {
         arguments.push_back(this->VisitExpr(arg));
       }
       if (print) std::cout << "[IUF]  Substituting" << std::endl;
-      return ufun->substitute(arguments, op->arg_dims);
+      // Bodies may load from narrower or wider aux buffers than the
+      // type the call was made with.
+      PrimExpr ret = ufun->substitute(arguments, op->arg_dims);
+      return ret.dtype() == op->dtype ? ret : cast(op->dtype, ret);
     } else {
       if (op->custom_realize_bounds.size() > 0) {
         Array<Range> new_bounds;
@@ -356,6 +362,83 @@ const PrimExpr UninterpFun::MakeCallTo(Array<PrimExpr> args, Array<Dimension> ar
                         CallNode::UninterpFunCall, arg_dims, *this, 0);
 }
 
+PrimExpr UninterpFun::ClosedFormPrefixSum(Var var, PrimExpr weight, PrimExpr n) {
+  // Replaces floordiv(var, k) by a new variable q and floormod(var, k)
+  // by var - k * q, for a single constant k.
+  class BucketReplacer : public ExprMutator {
+   public:
+    BucketReplacer(Var var, Var q) : var_(var), q_(q) {}
+
+    PrimExpr VisitExpr_(const FloorDivNode* op) final {
+      if (Match(op->a, op->b)) return q_;
+      return ExprMutator::VisitExpr_(op);
+    }
+
+    PrimExpr VisitExpr_(const FloorModNode* op) final {
+      if (Match(op->a, op->b)) return var_ - op->b * q_;
+      return ExprMutator::VisitExpr_(op);
+    }
+
+    bool Match(const PrimExpr& a, const PrimExpr& b) {
+      auto pk = b.as<IntImmNode>();
+      if (!a.same_as(var_) || pk == nullptr || pk->value <= 0) return false;
+      if (k_ == 0) k_ = pk->value;
+      if (k_ != pk->value) failed_ = true;
+      return true;
+    }
+
+    Var var_;
+    Var q_;
+    int64_t k_{0};
+    bool failed_{false};
+  };
+
+  PrimExpr inlined = Simplify(UninterpFun::InlineUninterpFunCalls(weight));
+  Var q(var->name_hint + "_q", var.dtype());
+  BucketReplacer replacer(var, q);
+  PrimExpr replaced = replacer(inlined);
+  if (replacer.failed_) return PrimExpr();
+
+  Array<PrimExpr> coeffs = arith::DetectLinearEquation(replaced, {var, q});
+  if (coeffs.size() != 3) return PrimExpr();
+  for (auto& coeff : coeffs) {
+    coeff = Simplify(coeff);
+    if (!coeff.as<IntImmNode>()) return PrimExpr();
+  }
+
+  // sum_{i < n} i = n * (n - 1) / 2, and sum_{i < n} floordiv(i, k)
+  // = k * Q * (Q - 1) / 2 + Q * R with n = Q * k + R. The products are
+  // formed in int64 as n * (n - 1) overflows int32 long before the sum
+  // itself does.
+  DataType i64 = DataType::Int(64);
+  PrimExpr n64 = cast(i64, n);
+  PrimExpr sum = cast(i64, coeffs[2]) * n64;
+  if (!is_zero(coeffs[0])) {
+    sum = sum + cast(i64, coeffs[0]) * floordiv(n64 * (n64 - 1), 2);
+  }
+  if (!is_zero(coeffs[1])) {
+    PrimExpr k = IntImm(i64, replacer.k_);
+    PrimExpr nq = floordiv(n64, k);
+    PrimExpr nr = floormod(n64, k);
+    sum = sum + cast(i64, coeffs[1]) * (k * floordiv(nq * (nq - 1), 2) + nq * nr);
+  }
+  return Simplify(cast(weight.dtype(), sum));
+}
+
+UninterpFun UninterpFun::MakePaddedLFun(UninterpFun l_fun, int bucket_size) {
+  CHECK_GT(bucket_size, 0);
+  if (bucket_size == 1) return l_fun;
+  auto round_up = [&](PrimExpr e) {
+    return Simplify(floordiv(e + (bucket_size - 1), bucket_size) * bucket_size);
+  };
+  PrimExpr body = l_fun->body.defined() ? l_fun->body
+                                        : l_fun.MakeCallTo(l_fun->parameters, l_fun->dimensions);
+  Range range = Range::make_by_min_max_inclusive(round_up(l_fun->range->min),
+                                                 round_up(l_fun->range->max_inclusive()));
+  return UninterpFunNode::make(l_fun->fname + "_pad" + std::to_string(bucket_size), range,
+                               l_fun->dimensions, l_fun->parameters, round_up(body), l_fun->type);
+}
+
 PrimExpr UninterpFun::RelaxUninterpCallsMaxInclusive(PrimExpr expr, bool complex_only) {
   class Relaxer : public ExprMutator {
    public:
@@ -395,5 +478,10 @@ TVM_REGISTER_GLOBAL("tir.UninterpFun")
       return UninterpFunNode::make(fname, range, dims, parameters, body,
                                    static_cast<UninterpFunNode::UninterpFunType>(type));
     });
+
+TVM_REGISTER_GLOBAL("tir.UninterpFunPadded").set_body_typed(UninterpFun::MakePaddedLFun);
+
+TVM_REGISTER_GLOBAL("tir.UninterpFunClosedFormPrefixSum")
+    .set_body_typed(UninterpFun::ClosedFormPrefixSum);
 }  // namespace tir
 }  // namespace tvm
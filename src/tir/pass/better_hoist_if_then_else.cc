@@ -164,6 +164,9 @@ class IfHoister : public StmtMutator {
   }
 
   bool Hoistable(const ForNode* for_loop, const IfThenElseNode* if_stmt) {
+    // Hoisting would take the loop out of the sequence of loops it is
+    // horizontally fused with
+    if (for_loop->hfuse_group_id >= 0) return false;
     auto stored_vars = GetAllStoredVars(GetRef<Stmt>(for_loop));
     bool ret = !ReadsVariablesFromSet(if_stmt->condition, stored_vars);
     // std::cout << "[HOIST]   " << if_stmt->condition << " " << ret << std::endl;
@@ -291,6 +294,7 @@ class RedundantIfRemover : public StmtExprMutator {
 };
 
 Stmt BetterHoistIfThenElseStmt(Stmt stmt, std::string target, Array<PrimExpr> constraints) {
+  arith::Z3PassScope z3_scope("BetterHoistIfThenElse");
   // std::cout << "[STMT] Hoisting" << std::endl;
   // if (target != "cuda") return stmt;
   for (int i = 0; i < 10; ++i) {
@@ -317,6 +321,7 @@ LoweredFunc BetterHoistIfThenElse(LoweredFunc f, std::string target, Array<PrimE
 LoweredFunc RemoveRedundantIfsFromFunc(LoweredFunc f, std::string target,
                                        Array<PrimExpr> constraints) {
   // if (target != "cuda") return f;
+  arith::Z3PassScope z3_scope("RemoveRedundantIfs");
   auto n = make_object<LoweredFuncNode>(*f.operator->());
   Stmt body = f->body;
   body = RedundantIfRemover(constraints)(body);
@@ -325,6 +330,7 @@ LoweredFunc RemoveRedundantIfsFromFunc(LoweredFunc f, std::string target,
 }
 
 Stmt RemoveRedundantIfs(Stmt stmt, Array<PrimExpr> constraints) {
+  arith::Z3PassScope z3_scope("RemoveRedundantIfs");
   return RedundantIfRemover(constraints)(stmt);
 }
 }  // namespace tir
@@ -17,34 +17,62 @@
 #define COUT std::cout << "[RIfR] "
 namespace tvm {
 namespace tir {
+// A parallel_dynamic pragma directly around a thread extent asks for
+// persistent workers: on CPU targets, the threads of the pool claim
+// chunks of the thread range from a shared counter. Thread extents
+// nested in such a range are run serially by the worker that claimed
+// the enclosing chunk.
+inline bool IsPersistentThreadPragma(const AttrStmtNode* op) {
+  if (op->attr_key != std::string(attr::pragma_scope_prefix) + "parallel_dynamic") return false;
+  const AttrStmtNode* body = op->body.as<AttrStmtNode>();
+  return body != nullptr && body->attr_key == attr::thread_extent;
+}
+
 class EnvLoopsCreator : public StmtMutator {
   Stmt VisitStmt_(const AttrStmtNode* op) final {
     if (op->attr_key == attr::thread_extent) {
       Var var = Downcast<IterVar>(op->node)->var;
-      PrimExpr max = op->value;
-      Stmt ret = ForNode::make(var, 0, op->value, ForType::Parallel, DeviceAPI::None,
+      ForType for_type = in_persistent_worker_ ? ForType::Serial : ForType::Parallel;
+      Stmt ret = ForNode::make(var, 0, op->value, for_type, DeviceAPI::None,
                                StmtMutator::VisitStmt(op->body));
       return ret;
+    } else if (IsPersistentThreadPragma(op)) {
+      CHECK(!in_persistent_worker_) << "Nested persistent thread ranges";
+      in_persistent_worker_ = true;
+      Stmt body = this->VisitStmt(op->body);
+      in_persistent_worker_ = false;
+      return AttrStmtNode::make(op->node, op->attr_key, op->value, body);
     } else {
       return StmtMutator::VisitStmt_(op);
     }
   }
 
+  bool in_persistent_worker_{false};
+
  public:
   EnvLoopsCreator() {}
 };
 
+// On other targets, the threads keep the launch geometry.
+class PersistentThreadPragmaRemover : public StmtMutator {
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    if (IsPersistentThreadPragma(op)) {
+      LOG(WARNING) << "Persistent workers are only supported on CPU targets, launching "
+                   << op->node << " with its full extent instead";
+      return this->VisitStmt(op->body);
+    }
+    return StmtMutator::VisitStmt_(op);
+  }
+};
+
 LoweredFunc CreateEnvLoopsForFunc(LoweredFunc f, std::string target) {
-  if (target != "llvm" && target != "c") return f;
   auto n = make_object<LoweredFuncNode>(*f.operator->());
-  Stmt body = f->body;
-  body = EnvLoopsCreator()(body);
-  n->body = body;
+  n->body = CreateEnvLoopsForStmt(f->body, target);
   return LoweredFunc(n);
 }
 
 Stmt CreateEnvLoopsForStmt(Stmt stmt, std::string target) {
-  if (target != "llvm" && target != "c") return stmt;
+  if (target != "llvm" && target != "c") return PersistentThreadPragmaRemover()(stmt);
   Stmt ret = EnvLoopsCreator()(stmt);
   return ret;
 }
@@ -90,17 +90,17 @@ TVM_REGISTER_GLOBAL("ir_pass.StorageFlatten").set_body([](TVMArgs args, TVMRetVa
 
 TVM_REGISTER_GLOBAL("ir_pass.MakeAPIWithPrepCode").set_body([](TVMArgs args, TVMRetValue* ret) {
   *ret = MakeAPI(args[0], args[1], args[2], args[3], args[4], args[5],
-                 tvm::tir::PrepCodeMode::kWithPrepCode);
+                 tvm::tir::PrepCodeMode::kWithPrepCode, args.size() > 6 ? args[6] : false);
 });
 
 TVM_REGISTER_GLOBAL("ir_pass.MakeAPINoPrepCode").set_body([](TVMArgs args, TVMRetValue* ret) {
   *ret = MakeAPI(args[0], args[1], args[2], args[3], args[4], args[5],
-                 tvm::tir::PrepCodeMode::kNoPrepCode);
+                 tvm::tir::PrepCodeMode::kNoPrepCode, args.size() > 6 ? args[6] : false);
 });
 
 TVM_REGISTER_GLOBAL("ir_pass.MakeAPIOnlyPrepCode").set_body([](TVMArgs args, TVMRetValue* ret) {
   *ret = MakeAPI(args[0], args[1], args[2], args[3], args[4], args[5],
-                 tvm::tir::PrepCodeMode::kOnlyPrepCode);
+                 tvm::tir::PrepCodeMode::kOnlyPrepCode, args.size() > 6 ? args[6] : false);
 });
 
 TVM_REGISTER_GLOBAL("ir_pass.InlineLets").set_body([](TVMArgs args, TVMRetValue* ret) {
@@ -134,6 +134,12 @@ TVM_REGISTER_GLOBAL("ir_pass.PostOrderVisit").set_body([](TVMArgs args, TVMRetVa
   tir::PostOrderVisit(args[0], [f](const ObjectRef& n) { f(n); });
 });
 
+TVM_REGISTER_GLOBAL("ir_pass.CountNodes").set_body_typed([](const ObjectRef& node) -> int64_t {
+  int64_t count = 0;
+  tir::PostOrderVisit(node, [&count](const ObjectRef& n) { count++; });
+  return count;
+});
+
 TVM_REGISTER_GLOBAL("ir_pass.LowerStorageAccess").set_body([](TVMArgs args, TVMRetValue* ret) {
   LoweredFunc f = args[0];
   auto n = make_object<LoweredFuncNode>(*f.operator->());
@@ -167,6 +173,7 @@ REGISTER_PASS(InjectVirtualThread);
 REGISTER_PASS(InjectPrefetch);
 REGISTER_PASS(InjectDoubleBuffer);
 REGISTER_PASS(LoopPartition);
+REGISTER_PASS(RaggedLoopPartition);
 REGISTER_PASS(RemoveNoOp);
 REGISTER_PASS(LiftAttrScope);
 REGISTER_PASS(LowerThreadAllreduce);
@@ -13,6 +13,7 @@
 #include <unordered_set>
 
 #include "../ir/var_replacer.h"
+#include "ir_util.h"
 
 #define COUT std::cout << "[RIfR] "
 namespace tvm {
@@ -69,6 +70,32 @@ class HFuser : public StmtMutator {
     return new_stmt;
   }
 
+  // The cumulative cost of the fused loop, when all the loops of the
+  // group are balanced parallel loops. The cost of a loop of the group
+  // is offset by the total cost of the loops before it, so that the
+  // fused launch is still split into tasks of equal cost.
+  PrimExpr FuseBalancedCosts(const std::vector<const ForNode*>& group,
+                             const Array<PrimExpr>& cumulative_extents, const Var& new_loop_var) {
+    PrimExpr cost_before = 0;
+    std::vector<PrimExpr> offset_costs;
+    for (size_t i = 0; i < group.size(); ++i) {
+      auto attr = FindBalancedCost(group[i]->body);
+      if (!attr) return PrimExpr();
+      Var var = group[i]->loop_var;
+      offset_costs.push_back(
+          cost_before +
+          Substitute(attr->value,
+                     Map<Var, PrimExpr>({{var, new_loop_var - cumulative_extents[i]}})));
+      cost_before =
+          cost_before + Substitute(attr->value, Map<Var, PrimExpr>({{var, group[i]->extent}}));
+    }
+    PrimExpr cost = offset_costs.back();
+    for (int i = group.size() - 2; i >= 0; --i) {
+      cost = SelectNode::make(new_loop_var < cumulative_extents[i + 1], offset_costs[i], cost);
+    }
+    return cost;
+  }
+
   Stmt FuseGroupFor(std::vector<const ForNode*> group) {
     Array<Stmt> bodies;
     Array<Var> vars;
@@ -85,12 +112,26 @@ class HFuser : public StmtMutator {
     Array<PrimExpr> cumulative_extents;
     FuseGroupCommon(bodies, vars, extents, new_loop_var, &new_bodies, &cumulative_extents);
 
+    PrimExpr balanced_cost;
+    if (group[0]->for_type == ForType::Parallel) {
+      balanced_cost = FuseBalancedCosts(group, cumulative_extents, new_loop_var);
+    }
+
     Stmt new_stmt = EvaluateNode::make(0);
 
     for (int i = group.size() - 1; i >= 0; --i) {
+      Stmt body = new_bodies[i];
+      if (balanced_cost.defined()) {
+        // The cost of the fused loop replaces those of its parts
+        body = RemoveBalancedCost(body);
+      }
       new_stmt = IfThenElseNode::make(
-          new_loop_var >= cumulative_extents[i] && new_loop_var < cumulative_extents[i + 1],
-          new_bodies[i], new_stmt);
+          new_loop_var >= cumulative_extents[i] && new_loop_var < cumulative_extents[i + 1], body,
+          new_stmt);
+    }
+    if (balanced_cost.defined()) {
+      new_stmt = AttrStmtNode::make(new_loop_var, attr::parallel_balanced_cost, balanced_cost,
+                                    new_stmt);
     }
     return ForNode::make(new_loop_var, 0, cumulative_extents[group.size()], group[0]->for_type,
                          group[0]->device_api, new_stmt, -1);
@@ -195,6 +236,12 @@ class HFuser : public StmtMutator {
       CHECK(!fused_attr_iv.defined());
       // std::cout << "[FUSE] Visiting hfuse body\n" << op->body << std::endl;
       Stmt body = this->VisitStmt(op->body);
+      if (!fused_attr_iv.defined()) {
+        // The group was made of loops, such as the parallel loops of
+        // a CPU target. There is no thread extent to move local
+        // allocations under.
+        return AttrStmtNode::make(op->node, op->attr_key, op->value, body);
+      }
 
       std::unordered_set<const VarNode*> to_remove;
       for (auto it : scope_map) {
@@ -223,14 +270,11 @@ class HFuser : public StmtMutator {
       // std::cout << "[FUSE]   Present " << it.first->name_hint << " " << it.first << std::endl;
       // }
 
-      if (fused_attr_iv.defined()) {
-        auto ret =
-            AttrStmtNode::make(fused_attr_iv, attr::thread_extent, fused_iv_extent, body, -1);
-        fused_attr_iv = NullValue<IterVar>();
-        fused_iv_extent = NullValue<PrimExpr>();
-        // std::cout << "[FUSE]  Returning\n" << ret << std::endl;
-        return ret;
-      }
+      auto ret = AttrStmtNode::make(fused_attr_iv, attr::thread_extent, fused_iv_extent, body, -1);
+      fused_attr_iv = NullValue<IterVar>();
+      fused_iv_extent = NullValue<PrimExpr>();
+      // std::cout << "[FUSE]  Returning\n" << ret << std::endl;
+      return ret;
     } else if (op->attr_key == attr::storage_scope) {
       const VarNode* buf = op->node.as<VarNode>();
       scope_map[buf] = op->value;
@@ -267,6 +311,7 @@ class HFuser : public StmtMutator {
 
 LoweredFunc HorizontalFuse(LoweredFunc f) {
   // std::cout << "[HFUSE] Fusing" << std::endl;
+  arith::Z3PassScope z3_scope("HorizontalFuse");
   HFuser fuser;
   auto n = make_object<LoweredFuncNode>(*f.operator->());
   Stmt body = f->body;
@@ -93,6 +93,14 @@ Map<Buffer, Buffer> ExtractPrepCode(const Stmt& full_body, Stmt* p_prep_code, St
         return Downcast<Map<Buffer, Buffer>>(attr->node);
       }
     }
+  } else if (auto attr = full_body.as<AttrStmtNode>()) {
+    // A body consisting solely of prep code, such as the prelude of
+    // a te.SharedPrepCode.
+    if (attr->attr_key == attr::prep_code_scope) {
+      *p_prep_code = full_body;
+      *p_main_body = EvaluateNode::make(0);
+      return Downcast<Map<Buffer, Buffer>>(attr->node);
+    }
   }
 
   *p_prep_code = EvaluateNode::make(0);
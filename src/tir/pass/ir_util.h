@@ -28,6 +28,7 @@
 #include <tvm/tir/buffer.h>
 #include <tvm/tir/expr.h>
 #include <tvm/tir/op.h>
+#include <tvm/tir/stmt.h>
 
 #include <vector>
 
@@ -184,6 +185,35 @@ inline bool GetRamp1Base(PrimExpr index, int lanes, PrimExpr* base) {
   *base = r->base;
   return true;
 }
+
+/*!
+ * \brief Find the parallel_balanced_cost attribute among the
+ *  attributes at the head of the body of a parallel loop, which may
+ *  also hold prefetch or pragma attributes.
+ * \param body The body of the loop.
+ * \return The attribute, nullptr if there is none.
+ */
+inline const AttrStmtNode* FindBalancedCost(const Stmt& body) {
+  const AttrStmtNode* attr = body.as<AttrStmtNode>();
+  while (attr != nullptr && attr->attr_key != attr::parallel_balanced_cost) {
+    attr = attr->body.as<AttrStmtNode>();
+  }
+  return attr;
+}
+
+/*!
+ * \brief Remove the attribute found by FindBalancedCost from the body
+ *  of a parallel loop, keeping the other attributes.
+ * \param body The body of the loop.
+ * \return The body without the attribute.
+ */
+inline Stmt RemoveBalancedCost(const Stmt& body) {
+  const AttrStmtNode* attr = body.as<AttrStmtNode>();
+  if (attr == nullptr) return body;
+  if (attr->attr_key == attr::parallel_balanced_cost) return attr->body;
+  return AttrStmtNode::make(attr->node, attr->attr_key, attr->value,
+                            RemoveBalancedCost(attr->body), attr->hfuse_group_id);
+}
 }  // namespace tir
 }  // namespace tvm
 #endif  // TVM_TIR_PASS_IR_UTIL_H_
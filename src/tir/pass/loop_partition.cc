@@ -21,12 +21,15 @@
  * \file loop_partition.cc
  */
 #include <tvm/arith/analyzer.h>
+#include <tvm/arith/pattern.h>
 #include <tvm/tir/expr.h>
 #include <tvm/tir/ir_pass.h>
 #include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/uninterp_fun.h>
 
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "../../arith/interval_set.h"
 #include "../../runtime/thread_storage_scope.h"
@@ -591,6 +594,207 @@ Stmt RemoveLikelyTags(Stmt stmt) {
   return stmt;
 }
 
+/*!
+ * \brief A likely bound check coeff * loop_var + rest < extent inside
+ * the body of a loop, with extent invariant in the body and rest
+ * ranging over the loops between loop_var and the check.
+ */
+struct RaggedBound {
+  const CallNode* likely{nullptr};
+  PrimExpr coeff;
+  PrimExpr rest_max;
+  PrimExpr extent;
+};
+
+class RaggedBoundFinder : public StmtVisitor {
+ public:
+  RaggedBoundFinder(const ForNode* loop, const std::unordered_set<const CallNode*>& peeled)
+      : loop_var_(loop->loop_var), peeled_(peeled) {
+    defined_.insert(loop_var_.get());
+  }
+
+  bool Find(Stmt body, RaggedBound* p_bound) {
+    this->VisitStmt(body);
+    for (auto& bound : candidates_) {
+      // The extent should not be read from memory written to in the loop
+      bool invariant = true;
+      PostOrderVisit(bound.extent, [&](const ObjectRef& node) {
+        if (auto load = node.as<LoadNode>()) {
+          if (stored_.count(load->buffer_var.get())) invariant = false;
+        }
+      });
+      if (invariant) {
+        *p_bound = bound;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void VisitStmt_(const ForNode* op) final {
+    defined_.insert(op->loop_var.get());
+    dom_[op->loop_var.get()] = IntSet::range(Range::make_by_min_extent(op->min, op->extent));
+    StmtVisitor::VisitStmt_(op);
+  }
+
+  void VisitStmt_(const LetStmtNode* op) final {
+    defined_.insert(op->var.get());
+    StmtVisitor::VisitStmt_(op);
+  }
+
+  void VisitStmt_(const AllocateNode* op) final {
+    defined_.insert(op->buffer_var.get());
+    stored_.insert(op->buffer_var.get());
+    StmtVisitor::VisitStmt_(op);
+  }
+
+  void VisitStmt_(const StoreNode* op) final {
+    stored_.insert(op->buffer_var.get());
+    StmtVisitor::VisitStmt_(op);
+  }
+
+  void VisitStmt_(const IfThenElseNode* op) final {
+    VisitCondition(op->condition);
+    StmtVisitor::VisitStmt_(op);
+  }
+
+ private:
+  void VisitCondition(const PrimExpr& cond) {
+    if (auto op = cond.as<AndNode>()) {
+      VisitCondition(op->a);
+      VisitCondition(op->b);
+      return;
+    }
+    auto call = cond.as<CallNode>();
+    if (!call || !call->is_intrinsic(CallNode::likely) || peeled_.count(call)) return;
+    PrimExpr index, extent;
+    if (auto lt = call->args[0].as<LTNode>()) {
+      index = lt->a;
+      extent = lt->b;
+    } else if (auto le = call->args[0].as<LENode>()) {
+      index = le->a;
+      extent = le->b + 1;
+    } else {
+      return;
+    }
+    if (ExprUseVars(extent, defined_)) return;
+
+    Array<PrimExpr> coeffs = arith::DetectLinearEquation(index, {loop_var_});
+    if (coeffs.size() != 2) return;
+    PrimExpr coeff = Simplify(coeffs[0]);
+    auto pcoeff = coeff.as<IntImmNode>();
+    if (!pcoeff || pcoeff->value <= 0) return;
+
+    IntSet rest = EvalSet(coeffs[1], dom_);
+    if (rest.is_nothing() || arith::is_pos_inf(rest.max())) return;
+    PrimExpr rest_max = Simplify(rest.max());
+    if (ExprUseVars(rest_max, defined_)) return;
+
+    // The l_fun ranges bound ragged extents. If the check can never
+    // hold for all of rest, there is no main body to peel.
+    PrimExpr extent_max =
+        Simplify(UninterpFun::RelaxUninterpCallsMaxInclusive(extent - rest_max, false));
+    auto pextent_max = extent_max.as<IntImmNode>();
+    if (pextent_max && pextent_max->value <= 0) return;
+    candidates_.push_back({call, coeff, rest_max, extent});
+  }
+
+  Var loop_var_;
+  const std::unordered_set<const CallNode*>& peeled_;
+  std::unordered_set<const VarNode*> defined_;
+  std::unordered_set<const VarNode*> stored_;
+  std::unordered_map<const VarNode*, IntSet> dom_;
+  std::vector<RaggedBound> candidates_;
+};
+
+/*!
+ * \brief Splits a loop containing a ragged bound check into a main
+ * loop, over which the check always holds and is removed, and a tail
+ * loop keeping the check. For a loop split by a factor F over a
+ * ragged extent L, the main loop runs floordiv(L, F) times and the
+ * tail loop at most once. The check is not used again to partition
+ * the inner loops of the tail, which would grow the code for a
+ * single iteration.
+ */
+class RaggedLoopPartitioner : public StmtExprMutator {
+ public:
+  Stmt VisitStmt_(const ForNode* op) final {
+    // Outer loops are partitioned first, so that the check is
+    // removed from whole inner loops rather than each of them being
+    // partitioned with a symbolic extent.
+    RaggedBound bound;
+    if (!is_zero(op->min) || op->hfuse_group_id >= 0 ||
+        (op->for_type != ForType::Serial && op->for_type != ForType::Parallel) ||
+        !RaggedBoundFinder(op, peeled_).Find(op->body, &bound)) {
+      return StmtExprMutator::VisitStmt_(op);
+    }
+
+    // coeff * loop_var + rest_max < extent for all loop_var < main_extent
+    PrimExpr main_extent = indexdiv(bound.extent - bound.rest_max + bound.coeff - 1, bound.coeff);
+    main_extent = Simplify(min(max(main_extent, 0), op->extent));
+
+    Stmt main_body = this->VisitStmt(LikelyCheckRemover(bound.likely)(op->body));
+    TailMaker tail_maker(bound.likely, op->loop_var, op->loop_var + main_extent);
+    Stmt tail_body = tail_maker(op->body);
+    if (auto tail_likely = tail_maker.tail_likely.as<CallNode>()) {
+      peeled_.insert(tail_likely);
+      peeled_refs_.push_back(tail_maker.tail_likely);
+    }
+    tail_body = this->VisitStmt(tail_body);
+
+    Stmt main_loop = ForNode::make(op->loop_var, 0, main_extent, op->for_type, op->device_api,
+                                   main_body);
+    Stmt tail_loop = ForNode::make(op->loop_var, 0, Simplify(op->extent - main_extent),
+                                   op->for_type, op->device_api, tail_body);
+    return SeqStmt({main_loop, tail_loop});
+  }
+
+ private:
+  class LikelyCheckRemover : public StmtExprMutator {
+   public:
+    explicit LikelyCheckRemover(const CallNode* likely) : likely_(likely) {}
+
+    PrimExpr VisitExpr_(const CallNode* op) final {
+      if (op == likely_) return const_true();
+      return StmtExprMutator::VisitExpr_(op);
+    }
+
+   private:
+    const CallNode* likely_;
+  };
+
+  // Substitutes the loop var, remembering what the check became
+  class TailMaker : public StmtExprMutator {
+   public:
+    TailMaker(const CallNode* likely, Var var, PrimExpr value)
+        : likely_(likely), var_(var), value_(value) {}
+
+    PrimExpr VisitExpr_(const VarNode* op) final {
+      if (op == var_.get()) return value_;
+      return GetRef<PrimExpr>(op);
+    }
+
+    PrimExpr VisitExpr_(const CallNode* op) final {
+      PrimExpr ret = StmtExprMutator::VisitExpr_(op);
+      if (op == likely_) tail_likely = ret;
+      return ret;
+    }
+
+    PrimExpr tail_likely;
+
+   private:
+    const CallNode* likely_;
+    Var var_;
+    PrimExpr value_;
+  };
+
+  // The checks left in the tails, and references keeping them alive
+  std::unordered_set<const CallNode*> peeled_;
+  Array<PrimExpr> peeled_refs_;
+};
+
+Stmt RaggedLoopPartition(Stmt stmt) { return RaggedLoopPartitioner()(std::move(stmt)); }
+
 Stmt LoopPartition(Stmt stmt, bool split_const_loop) {
   stmt = LoopPartitioner(split_const_loop).VisitAndMutate(std::move(stmt));
   stmt = LikelyTagsRemover()(std::move(stmt));
@@ -260,9 +260,60 @@ class CopyStatementsRewriter : public StmtExprMutator {
   const Var& device_id_;
 };
 
+/*!
+ * \brief Skip prep_body when the runtime prep code cache reports that
+ *  aux_buffers already hold the results of running it on the current
+ *  length arguments. See src/runtime/prep_code_cache.cc.
+ */
+Stmt GuardPrepCodeWithCache(Stmt prep_body, Array<Buffer> aux_buffers,
+                            Array<ObjectRef> lengths_api_args) {
+  Array<PrimExpr> aux_args;
+  aux_args.push_back(IntImm(DataType::Int(32), aux_buffers.size()));
+  for (auto buf : aux_buffers) {
+    aux_args.push_back(buf->data);
+  }
+
+  Array<PrimExpr> lookup_args;
+  lookup_args.push_back(StringImmNode::make("runtime.PrepCodeCacheLookup"));
+  lookup_args.push_back_all(aux_args);
+  for (auto arg : lengths_api_args) {
+    if (auto buf_node = arg.as<BufferNode>()) {
+      PrimExpr extent = 1;
+      for (auto dim_length : buf_node->shape->get_dense_shape()) {
+        extent = extent * dim_length;
+      }
+      lookup_args.push_back(buf_node->data);
+      lookup_args.push_back(cast(DataType::Int(64), extent * buf_node->dtype.bytes()));
+    } else if (auto var_node = arg.as<VarNode>()) {
+      lookup_args.push_back(cast(DataType::Int(64), GetRef<Var>(var_node)));
+      lookup_args.push_back(IntImm(DataType::Int(64), -1));
+    } else {
+      LOG(FATAL) << "Unsupported length argument " << arg;
+    }
+  }
+
+  Array<PrimExpr> commit_args;
+  commit_args.push_back(StringImmNode::make("runtime.PrepCodeCacheCommit"));
+  commit_args.push_back_all(aux_args);
+
+  // The lookup result goes through a store of its own so that the
+  // packed call is lowered ahead of the branch reading it.
+  Var hit("prep_cache_hit", DataType::Handle());
+  PrimExpr lookup = CallNode::make(DataType::Int(32), intrinsic::tvm_call_packed, lookup_args,
+                                   CallNode::Intrinsic);
+  Stmt commit = EvaluateNode::make(CallNode::make(
+      DataType::Int(32), intrinsic::tvm_call_packed, commit_args, CallNode::Intrinsic));
+  PrimExpr miss = LoadNode::make(DataType::Int(32), hit, 0, const_true(), tir::kAll) ==
+                  make_zero(DataType::Int(32));
+  Stmt guarded = SeqStmt({StoreNode::make(hit, lookup, 0, const_true(), tir::kAll),
+                          IfThenElseNode::make(miss, SeqStmt({prep_body, commit}))});
+  return AttrStmtNode::make(hit, attr::storage_scope, StringImmNode::make("global"),
+                            AllocateNode::make(hit, DataType::Int(32), {1}, const_true(), guarded));
+}
+
 MakeAPIResult MakeAPI(Stmt body, std::string name, Array<ObjectRef> lengths_api_args,
                       Array<ObjectRef> tensor_api_args, int num_unpacked_args, bool is_restricted,
-                      PrepCodeMode prep_code_mode) {
+                      PrepCodeMode prep_code_mode, bool cache_prep_code) {
   Var device_type("dev_type"), device_id("dev_id");
   std::unordered_map<const VarNode*, PrimExpr> vmap;
   ArgBinder binder(&vmap);
@@ -336,8 +387,13 @@ MakeAPIResult MakeAPI(Stmt body, std::string name, Array<ObjectRef> lengths_api_
       // Replace the buffers in the main_body
       main_body = VarReplacer(vsub, true)(main_body);
       main_body = MergeNest(aux_data_structure_annotations, main_body);
+      Stmt prep_body = SeqStmt(l_copy_stmts);
+      if (cache_prep_code && device_intermediate_api_args.size() > 0) {
+        prep_body =
+            GuardPrepCodeWithCache(prep_body, device_intermediate_api_args, lengths_api_args);
+      }
       prep_code = AttrStmtNode::make(prep_buffer_map, prep_attr->attr_key, prep_attr->value,
-                                     SeqStmt(l_copy_stmts), prep_attr->hfuse_group_id);
+                                     prep_body, prep_attr->hfuse_group_id);
     }
 
     // Construct/rewrite prep_code
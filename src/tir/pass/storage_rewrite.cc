@@ -467,7 +467,7 @@ class StoragePlanRewriter : public StmtExprMutator {
       Stmt stmt = StmtExprMutator::VisitStmt_(op);
       op = stmt.as<ForNode>();
       return ForNode::make(op->loop_var, op->min, op->extent, op->for_type, op->device_api,
-                           MakeAttach(svec, op->body));
+                           MakeAttach(svec, op->body), op->hfuse_group_id);
     } else {
       return StmtExprMutator::VisitStmt_(op);
     }
@@ -22,8 +22,10 @@
  */
 // Loop vectorizer as in Halide pipeline.
 #include <tvm/arith/analyzer.h>
+#include <tvm/target/target.h>
 #include <tvm/tir/expr.h>
 #include <tvm/tir/ir_pass.h>
+#include <tvm/tir/op.h>
 #include <tvm/tir/stmt_functor.h>
 
 #include <unordered_map>
@@ -96,6 +98,17 @@ class Vectorizer : public StmtExprMutator {
   Vectorizer(Var var, int var_lanes) : var_(var), var_lanes_(var_lanes) {
     ramp_ = RampNode::make(0, 1, var_lanes);
   }
+  /*!
+   * \brief Vectorize with only the first active_lanes lanes enabled.
+   *  Vector loads and stores are predicated on the active lanes and
+   *  scalarized statements are guarded.
+   */
+  Vectorizer(Var var, int var_lanes, PrimExpr active_lanes)
+      : Vectorizer(var, var_lanes) {
+    active_lanes_ = active_lanes;
+    PrimExpr lane = RampNode::make(make_zero(var->dtype), make_const(var->dtype, 1), var_lanes);
+    lane_mask_ = lane < BroadcastNode::make(active_lanes, var_lanes);
+  }
 
   Stmt VisitStmt(const Stmt& stmt) final {
     CHECK(!need_scalarize_);
@@ -131,10 +144,10 @@ class Vectorizer : public StmtExprMutator {
     }
     return BinaryVec(op);
   }
-  PrimExpr VisitExpr_(const DivNode* op) final { return BinaryVec(op); }
-  PrimExpr VisitExpr_(const ModNode* op) final { return BinaryVec(op); }
-  PrimExpr VisitExpr_(const FloorDivNode* op) final { return BinaryVec(op); }
-  PrimExpr VisitExpr_(const FloorModNode* op) final { return BinaryVec(op); }
+  PrimExpr VisitExpr_(const DivNode* op) final { return DivVec(op); }
+  PrimExpr VisitExpr_(const ModNode* op) final { return DivVec(op); }
+  PrimExpr VisitExpr_(const FloorDivNode* op) final { return DivVec(op); }
+  PrimExpr VisitExpr_(const FloorModNode* op) final { return DivVec(op); }
   PrimExpr VisitExpr_(const MinNode* op) final { return BinaryVec(op); }
   PrimExpr VisitExpr_(const MaxNode* op) final { return BinaryVec(op); }
   PrimExpr VisitExpr_(const EQNode* op) final { return BinaryVec(op); }
@@ -254,8 +267,16 @@ class Vectorizer : public StmtExprMutator {
       return GetRef<PrimExpr>(op);
     } else {
       int lanes = std::max(index.dtype().lanes(), pred.dtype().lanes());
+      pred = BroadcastTo(pred, lanes);
+      if (lane_mask_.defined() && index.dtype().is_vector()) {
+        if (lanes != var_lanes_) {
+          need_scalarize_ = true;
+          return GetRef<PrimExpr>(op);
+        }
+        pred = MaskLanes(pred);
+      }
       return LoadNode::make(op->dtype.with_lanes(lanes), op->buffer_var, BroadcastTo(index, lanes),
-                            BroadcastTo(pred, lanes), op->sync_type);
+                            pred, op->sync_type);
     }
   }
   // Let
@@ -297,8 +318,15 @@ class Vectorizer : public StmtExprMutator {
     } else {
       int lanes = std::max(value.dtype().lanes(), index.dtype().lanes());
       lanes = std::max(lanes, pred.dtype().lanes());
+      pred = BroadcastTo(pred, lanes);
+      if (lane_mask_.defined() && index.dtype().is_vector()) {
+        if (lanes != var_lanes_) {
+          return Scalarize(GetRef<Stmt>(op));
+        }
+        pred = MaskLanes(pred);
+      }
       return StoreNode::make(op->buffer_var, BroadcastTo(value, lanes), BroadcastTo(index, lanes),
-                             BroadcastTo(pred, lanes), op->sync_type);
+                             pred, op->sync_type);
     }
   }
   // For
@@ -376,6 +404,9 @@ class Vectorizer : public StmtExprMutator {
     Var idx(var_->name_hint + ".s", var_->dtype);
     Map<Var, PrimExpr> values{{var_, idx}};
     stmt = Substitute(stmt, values);
+    if (active_lanes_.defined()) {
+      stmt = IfThenElseNode::make(idx < active_lanes_, stmt);
+    }
     return ForNode::make(idx, 0, var_lanes_, ForType::Serial, DeviceAPI::None, stmt);
   }
 
@@ -390,6 +421,10 @@ class Vectorizer : public StmtExprMutator {
   PrimExpr ramp_;
   // flag to mark requirment of scalarization.
   bool need_scalarize_{false};
+  // number of enabled lanes when predicating, undefined otherwise.
+  PrimExpr active_lanes_;
+  // lane < active_lanes_, the predicate of vector loads and stores.
+  PrimExpr lane_mask_;
   // The lets
   std::unordered_map<const VarNode*, PrimExpr> lets_;
   // mutate array, with given lane requirement
@@ -416,6 +451,10 @@ class Vectorizer : public StmtExprMutator {
     if (!changed) return arr;
     return Array<PrimExpr>(new_arr);
   }
+  PrimExpr MaskLanes(PrimExpr pred) {
+    if (is_one(pred)) return lane_mask_;
+    return AndNode::make(pred, lane_mask_);
+  }
   template <typename T>
   PrimExpr BinaryVec(const T* op) {
     PrimExpr a = this->VisitExpr(op->a);
@@ -427,6 +466,18 @@ class Vectorizer : public StmtExprMutator {
       return T::make(BroadcastTo(a, lanes), BroadcastTo(b, lanes));
     }
   }
+  // Disabled lanes load zeros, which would trap as integer divisors,
+  // so they divide by one instead.
+  template <typename T>
+  PrimExpr DivVec(const T* op) {
+    PrimExpr ret = BinaryVec(op);
+    const T* vec = ret.as<T>();
+    if (!lane_mask_.defined() || vec == nullptr || vec->dtype.is_float() ||
+        vec->b.dtype().lanes() != var_lanes_) {
+      return ret;
+    }
+    return T::make(vec->a, SelectNode::make(lane_mask_, vec->b, make_const(vec->b.dtype(), 1)));
+  }
   template <typename T>
   PrimExpr AddSubVec(const T* op) {
     PrimExpr a = this->VisitExpr(op->a);
@@ -459,6 +510,12 @@ class LoopVectorizer : public StmtMutator {
       CHECK(is_zero(op->min));
       int lanes = 0;
       bool succ = arith::GetConstInt(op->extent, &lanes);
+      if (!succ) {
+        int vector_lanes = BuildConfig::Current()->ragged_vector_lanes;
+        if (vector_lanes > 1) {
+          return VectorizePredicated(op, vector_lanes);
+        }
+      }
       if (!succ || lanes < 1) {
         LOG(FATAL) << "Failed to vectorize loop with extent " << op->extent;
       }
@@ -467,6 +524,34 @@ class LoopVectorizer : public StmtMutator {
       return StmtMutator::VisitStmt_(op);
     }
   }
+
+ private:
+  // Strip-mine a loop of variable extent, such as a loop over a
+  // ragged dimension, by lanes. The full chunks run as plain vector
+  // iterations, and the last partial one, if any, as a single vector
+  // iteration with its loads and stores predicated on the lanes that
+  // are within the extent. The body is duplicated, so the definitions
+  // in the copies are renamed.
+  Stmt VectorizePredicated(const ForNode* op, int lanes) {
+    DataType dtype = op->loop_var.dtype();
+    PrimExpr lanes_expr = make_const(dtype, lanes);
+    Var outer(op->loop_var->name_hint + ".o", dtype);
+    Var inner(op->loop_var->name_hint + ".v", dtype);
+    Stmt full_body = Substitute(op->body, Map<Var, PrimExpr>({{op->loop_var,
+                                                                outer * lanes_expr + inner}}));
+    full_body = Vectorizer(inner, lanes)(full_body);
+    PrimExpr num_full = indexdiv(op->extent, lanes_expr);
+    Stmt full =
+        ForNode::make(outer, make_zero(dtype), num_full, ForType::Serial, op->device_api,
+                      full_body);
+
+    Var tail_inner(op->loop_var->name_hint + ".t", dtype);
+    PrimExpr tail_base = num_full * lanes_expr;
+    Stmt tail = Substitute(op->body, Map<Var, PrimExpr>({{op->loop_var, tail_base + tail_inner}}));
+    tail = Vectorizer(tail_inner, lanes, op->extent - tail_base)(tail);
+    tail = IfThenElseNode::make(tail_base < op->extent, tail);
+    return ConvertSSA(SeqStmt({full, tail}));
+  }
 };
 
 Stmt VectorizeLoop(Stmt stmt) { return LoopVectorizer()(std::move(stmt)); }
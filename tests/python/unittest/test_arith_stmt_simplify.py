@@ -102,8 +102,74 @@ def test_complex_likely_elimination():
     stmt = tvm.lower(s, [data_ph, indices_ph, lengths_ph, Y], simple_mode=True)
     assert('if' not in str(stmt))
 
+
+def test_select_z3_budget():
+    def make_stmt():
+        ib = tvm.ir_builder.create()
+        A = ib.pointer("int32", name="A")
+        x = tvm.var("x")
+        # Distinct selects Z3 cannot simplify, which use up the budget...
+        for k in range(1, 300):
+            A[k] = tvm.tir.Select(x * x > k, x + k, x)
+        # ...before one that only Z3 can simplify.
+        A[0] = tvm.tir.Select(x * x < 0, x, x + 1)
+        return ib.get()
+
+    def last_value(stmt):
+        stores = []
+        tvm.ir_pass.PostOrderVisit(stmt, lambda n: stores.append(n)
+                                   if isinstance(n, tvm.tir.Store) else None)
+        return stores[-1].value
+
+    tvm.arith.reset_z3_stats()
+    # A budget of a single solver check, used up by the first select.
+    with tvm.build_config(z3_pass_max_solver_checks=1):
+        stmt = tvm.ir_pass.CanonicalSimplify(make_stmt())
+    # The last select skipped Z3 and fell back to the bounds of its
+    # condition, which do not decide it.
+    stats = tvm.arith.z3_stats()["Simplify"]
+    assert stats["solver_checks"] == 1 and stats["skipped"] > 0, stats
+    assert isinstance(last_value(stmt), tvm.tir.Select)
+
+    stmt = tvm.ir_pass.CanonicalSimplify(make_stmt())
+    assert not isinstance(last_value(stmt), tvm.tir.Select)
+
+
+def test_z3_query_cache():
+    def make_stmt():
+        ib = tvm.ir_builder.create()
+        A = ib.pointer("int32", name="A")
+        n = tvm.var("n")
+        x = tvm.var("x")
+        with ib.for_range(0, n, name="i") as i:
+            # Nonlinear, and only decided by Z3.
+            A[i] = tvm.tir.Select(x * x + i * i < 0, x, x + 1)
+        return ib.get()
+
+    def selects(stmt):
+        found = []
+        tvm.ir_pass.PostOrderVisit(stmt, lambda n: found.append(n)
+                                   if isinstance(n, tvm.tir.Select) else None)
+        return found
+
+    stmt = make_stmt()
+    tvm.arith.reset_z3_stats()
+    assert not selects(tvm.ir_pass.CanonicalSimplify(stmt))
+    first = tvm.arith.z3_stats()["Simplify"]
+    assert first["queries"] > 0 and first["proved"] > 0
+    assert first["queries"] >= first["cache_hits"] + first["solver_checks"] + first["skipped"]
+
+    # The same queries again, answered from the cache.
+    assert not selects(tvm.ir_pass.CanonicalSimplify(stmt))
+    second = tvm.arith.z3_stats()["Simplify"]
+    assert second["solver_checks"] == first["solver_checks"]
+    assert second["cache_hits"] - first["cache_hits"] >= first["solver_checks"] > 0
+    assert second["proved"] - first["proved"] == first["proved"]
+
 if __name__ == "__main__":
     test_stmt_simplify()
     test_thread_extent_simplify()
     test_basic_likely_elimination()
     test_complex_likely_elimination()
+    test_select_z3_budget()
+    test_z3_query_cache()
@@ -78,6 +78,35 @@ def test_curve_feature_gemm():
     # sample_n * #buffers * #curves * 2 numbers per curve
     assert len(feas) == 30 * 3 * 4 * 2
 
+def test_ragged_itervar_feature():
+    """test the extents of ragged loops are replaced by their expected value"""
+    def get_lengths(length_samples):
+        ib = tvm.ir_builder.create()
+        lens = ib.pointer("int32", name="lens")
+        A = ib.pointer("float32", name="A")
+        with ib.for_range(0, 16, name="b") as b:
+            with ib.for_range(0, lens[b], name="s") as s:
+                with ib.for_range(0, (lens[b] + 3) // 4 * 4 - s, name="x") as x:
+                    A[b * 4096 + s * 64 + x] = 0.0
+        stmt = ib.get()
+        feas = feature._get_itervar_feature(stmt, False,
+                                            feature.length_distributions(length_samples))
+        return [row[1][1].value for row in feas]
+
+    # without distributions, the ragged extents are unknown
+    assert get_lengths(None) == [16, -1, -1]
+    # s is replaced by its expected value (lens[b] - 1) / 2 in the
+    # extent of x
+    assert get_lengths({"lens": [3, 5, 7]}) == [16, 5, 5]
+    assert get_lengths({"lens": {2: 0.75, 10: 0.25}}) == [16, 4, 5]
+
+    dists = feature.length_distributions({"lens": np.arange(1, 513)}, max_points=32)
+    values, weights = dists["lens"]
+    assert len(values) == 32
+    assert abs(sum(weights) - 1) < 1e-6
+    assert abs(np.dot(values, weights) - 256.5) < 1
+
+
 def test_feature_shape():
     """test the dimensions of flatten feature are the same"""
 
@@ -130,5 +159,6 @@ def test_feature_shape():
 if __name__ == "__main__":
     test_iter_feature_gemm()
     test_curve_feature_gemm()
+    test_ragged_itervar_feature()
     test_feature_shape()
 
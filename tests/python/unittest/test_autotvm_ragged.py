@@ -0,0 +1,92 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Test the search space helpers and the measurement of ragged tuning tasks"""
+import numpy as np
+
+import tvm
+import tvm.testing
+from tvm import autotvm, te
+from tvm.autotvm.task import ragged
+from tvm.autotvm.task.space import ConfigSpace
+
+
+@autotvm.template
+def ragged_scale(batch_size, max_len, hidden):
+    """O[b, s, h] = 2 * A[b, s, h] over a ragged sequence dimension"""
+    cfg = autotvm.get_config()
+    ragged.define_bucket_size(cfg, 'bucket', [1, 2, 4])
+    bucket_size = cfg['bucket'].val
+
+    lens, A, O = tvm.testing.ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden,
+                                                bucket_size=bucket_size)
+    s = te.create_schedule([O.op])
+    if bucket_size > 1:
+        _, l, _ = O.op.axis
+        _, li = s[O].split(l, factor=bucket_size)
+        s[O].unroll(li)
+    cfg.add_flop(batch_size * max_len * hidden)
+    return s, [[lens], [A, O]]
+
+def test_hfuse_groups():
+    # the number of groupings is the Bell number of the number of loops
+    for num_loops, num_groupings in [(1, 1), (2, 2), (3, 5), (4, 15), (5, 52)]:
+        cfg = ConfigSpace()
+        ragged.define_hfuse_groups(cfg, 'groups', num_loops)
+        groupings = cfg.space_map['groups'].entities
+        assert len(groupings) == num_groupings
+        for grouping in groupings:
+            assert sorted(i for group in grouping.val for i in group) == list(range(num_loops))
+
+def test_ragged_knobs():
+    cfg = ConfigSpace()
+    ragged.define_bin_pack_split(cfg, 'split', [[], [64], [64, 32]])
+    ragged.define_bucket_size(cfg, 'bucket')
+    ragged.define_fuse_ragged(cfg, 'fuse')
+    assert len(cfg) == 3 * 6 * 2
+    assert [e.val for e in cfg.space_map['split'].entities] == [(), (64,), (64, 32)]
+
+def test_ragged_tuning():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    batch_size, max_len, hidden = 4, 8, 4
+    rng = np.random.RandomState(0)
+    batches = [rng.randint(1, max_len + 1, size=batch_size) for _ in range(3)]
+    task = autotvm.task.create_ragged(ragged_scale, (batch_size, max_len, hidden),
+                                      {"lens": batches}, target="llvm", objective="p99")
+    assert len(task.config_space) == 3
+
+    measure_option = autotvm.measure_option(
+        builder=autotvm.RaggedLocalBuilder(),
+        runner=autotvm.RaggedLocalRunner(number=2, repeat=1, cooldown_interval=0)
+    )
+    results = []
+    def _callback(tuner, measure_inputs, measure_results):
+        results.extend(measure_results)
+
+    tuner = autotvm.tuner.GridSearchTuner(task)
+    tuner.tune(n_trial=2, measure_option=measure_option, callbacks=[_callback])
+    assert len(results) == 2
+    for res in results:
+        assert res.error_no == 0, res
+        assert len(res.costs) == 1 and res.costs[0] > 0
+    assert tuner.best_flops > 0
+
+
+if __name__ == "__main__":
+    test_hfuse_groups()
+    test_ragged_knobs()
+    test_ragged_tuning()
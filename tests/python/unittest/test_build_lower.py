@@ -14,7 +14,15 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+import numpy as np
 import tvm
+import tvm.testing
 
 def test_lower_rfactor():
     n = tvm.size_var("n")
@@ -39,6 +47,98 @@ def test_dependent_output_shape():
     s = tvm.create_schedule(B.op)
     mod = tvm.build(s, [A, B, x])
 
+def test_compile_profiler():
+    n = 128
+    A = tvm.placeholder((n,), name='A')
+    B = tvm.compute((n,), lambda i: A[i] + 1, name='B')
+    s = tvm.create_schedule(B.op)
+    xo, xi = s[B].split(B.op.axis[0], factor=4)
+    with tvm.driver.CompileProfiler() as prof:
+        tvm.lower(s, [[], [A, B]], "llvm")
+    names = [ev["name"] for ev in prof.events]
+    for name in ["InferBound", "ScheduleOps", "ScheduleOps.GenerateAFunctions",
+                 "StorageFlatten", "Simplify"]:
+        assert name in names, name
+    flatten = prof.events[names.index("StorageFlatten")]
+    assert flatten["args"]["nodes_before"] > 0
+    assert flatten["args"]["nodes_after"] > 0
+    assert sum(ev["args"]["rewrite_simplify"] for ev in prof.events) > 0
+    assert "StorageFlatten" in prof.summary()
+
+    with tempfile.NamedTemporaryFile(suffix=".json") as f:
+        prof.export_chrome_trace(f.name)
+        trace = json.load(open(f.name))
+    assert all(ev["ph"] == "X" and ev["ts"] >= 0 for ev in trace["traceEvents"])
+
+    # Nothing is recorded out of the scope of a profiler.
+    tvm.lower(s, [[], [A, B]], "llvm")
+    assert len(prof.events) == len(names)
+
+def test_build_cache():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    n = 64
+    A = tvm.placeholder((n,), name='A')
+    B = tvm.compute((n,), lambda i: A[i] * 2, name='B')
+    s = tvm.create_schedule(B.op)
+    with tempfile.TemporaryDirectory() as cache_dir:
+        with tvm.build_config(build_cache_dir=cache_dir):
+            tvm.build(s, [[], [A, B]], "llvm")
+            entries = [f for _, _, files in os.walk(cache_dir) for f in files]
+            assert len(entries) == 1 and entries[0].endswith(".so")
+            with tvm.driver.CompileProfiler() as prof:
+                mod, _ = tvm.build(s, [[], [A, B]], "llvm")
+            names = [ev["name"] for ev in prof.events]
+            assert "build_cache.load" in names and "codegen.host" not in names
+            # The prep code mode is part of the key.
+            with tvm.build_config(build_cache_dir=cache_dir, prep_code_mode="no_prep_code"):
+                tvm.build(s, [[], [A, B]], "llvm")
+            entries = [f for _, _, files in os.walk(cache_dir) for f in files]
+            assert len(entries) == 2
+            # So are the arguments of build applied after lowering.
+            with tvm.driver.CompileProfiler() as prof:
+                tvm.build(s, [[], [A, B]], "llvm", constraints=[A.shape[0] > 0])
+            names = [ev["name"] for ev in prof.events]
+            assert "build_cache.load" not in names and "codegen.host" in names
+            entries = [f for _, _, files in os.walk(cache_dir) for f in files]
+            assert len(entries) == 3
+
+        a = tvm.nd.array(np.arange(n).astype(A.dtype))
+        b = tvm.nd.empty((n,), B.dtype)
+        mod(a, b)
+        np.testing.assert_allclose(b.asnumpy(), 2 * a.asnumpy())
+
+def build_ragged_into_cache(cache_dir):
+    """Build a ragged kernel, whose buffers have layouts with dependent
+    dimensions, with the build cache in cache_dir, and return the name
+    of the cache entry, which is the key of the build."""
+    from tvm import te
+    lens, A, O = tvm.testing.ragged_elementwise(lambda x: x * 2, 8, 16, 4)
+    s = te.create_schedule([O.op])
+    with tvm.build_config(build_cache_dir=cache_dir):
+        tvm.build(s, [[lens], [A, O]], "llvm")
+    entries = [f for _, _, files in os.walk(cache_dir) for f in files]
+    assert len(entries) == 1, entries
+    return entries[0]
+
+def test_build_cache_key_across_processes():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    script = ("import sys; sys.path.insert(0, %r); import test_build_lower; "
+              "print(test_build_lower.build_ragged_into_cache(sys.argv[1]))"
+              % os.path.dirname(os.path.abspath(__file__)))
+    keys = []
+    with tempfile.TemporaryDirectory() as cache_dir:
+        keys.append(build_ragged_into_cache(os.path.join(cache_dir, "local")))
+        for i in range(2):
+            out = subprocess.check_output([sys.executable, "-c", script,
+                                           os.path.join(cache_dir, str(i))])
+            keys.append(out.decode("utf-8").strip().splitlines()[-1])
+    assert keys[0] == keys[1] == keys[2], keys
+
 if __name__ == "__main__":
     test_lower_rfactor()
     test_dependent_output_shape()
+    test_compile_profiler()
+    test_build_cache()
+    test_build_cache_key_across_processes()
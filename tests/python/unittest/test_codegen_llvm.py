@@ -183,6 +183,79 @@ def test_llvm_persist_parallel():
     check_llvm()
 
 
+def test_llvm_dynamic_parallel():
+    n = 101
+    A = tvm.placeholder((n, 16), name='A')
+    B = tvm.compute(A.shape, lambda i, j: A[i, j] * 2 + 1, name='B')
+    s = tvm.create_schedule(B.op)
+    s[B].parallel(B.op.axis[0])
+    s[B].pragma(B.op.axis[0], "parallel_dynamic", 7)
+
+    def check_llvm():
+        if not tvm.runtime.enabled("llvm"):
+            return
+        f = tvm.build(s, [A, B], "llvm")
+        ctx = tvm.cpu(0)
+        a = tvm.nd.array(np.random.uniform(size=(n, 16)).astype(A.dtype), ctx)
+        b = tvm.nd.array(np.zeros((n, 16), dtype=B.dtype), ctx)
+        # The chunk counter is reset on every launch.
+        for _ in range(2):
+            f(a, b)
+            tvm.testing.assert_allclose(b.asnumpy(), a.asnumpy() * 2 + 1, rtol=1e-5)
+
+    check_llvm()
+
+
+def test_llvm_dynamic_parallel_chunk_check():
+    n = 16
+    A = tvm.placeholder((n,), name='A')
+    B = tvm.compute(A.shape, lambda i: A[i] + 1, name='B')
+    s = tvm.create_schedule(B.op)
+    for chunk in [0, -2, tvm.var("c")]:
+        try:
+            s[B].pragma(B.op.axis[0], "parallel_dynamic", chunk)
+            assert False, chunk
+        except tvm.TVMError:
+            pass
+
+    X = tvm.placeholder((n, 4), name='X')
+    C = tvm.compute(X.shape, lambda i, j: X[i, j] + 1, name='C')
+    s = tvm.create_schedule(C.op)
+    bx = tvm.te.thread_axis((0, n), "blockIdx.x")
+    s[C].bind(C.op.axis[0], bx)
+    try:
+        s.single_kernel([X], [C], [bx], "sk", persistent=True, chunk=0)
+        assert False
+    except tvm.TVMError:
+        pass
+
+
+def test_llvm_persistent_single_kernel():
+    n = 64
+    X = tvm.placeholder((n, 16), name='X')
+    B = tvm.compute(X.shape, lambda i, j: X[i, j] * 2 + 1, name='B')
+    s = tvm.create_schedule(B.op)
+    bx = tvm.te.thread_axis((0, n), "blockIdx.x")
+    s[B].bind(B.op.axis[0], bx)
+    O = s.single_kernel([X], [B], [bx], "sk", persistent=True, chunk=4)
+    # Only the persistent workers pragma is emitted around the thread
+    s[O].pragma(bx, "debug_skip_region")
+    stmt = tvm.lower(s, [X, O], "llvm", simple_mode=True)
+    pragmas = []
+    tvm.ir_pass.PostOrderVisit(stmt, lambda x: pragmas.append(x.attr_key) if isinstance(
+        x, tvm.tir.AttrStmt) and x.attr_key.startswith("pragma_") else None)
+    assert pragmas == ["pragma_parallel_dynamic"], pragmas
+
+    if not tvm.runtime.enabled("llvm"):
+        return
+    f = tvm.build(s, [X, O], "llvm")
+    ctx = tvm.cpu(0)
+    x = tvm.nd.array(np.random.uniform(size=(n, 16)).astype(X.dtype), ctx)
+    o = tvm.nd.array(np.zeros((n, 16), dtype=O.dtype), ctx)
+    f(x, o)
+    tvm.testing.assert_allclose(o.asnumpy(), x.asnumpy() * 2 + 1, rtol=1e-5)
+
+
 def test_llvm_flip_pipeline():
     def check_llvm(nn, base):
         if not tvm.runtime.enabled("llvm"):
@@ -239,6 +312,53 @@ def test_llvm_vadd_pipeline():
     check_llvm(512, 2)
 
 
+def test_llvm_predicated_vectorize():
+    def check_llvm(lanes):
+        if not tvm.runtime.enabled("llvm"):
+            return
+        n = tvm.var('n')
+        A = tvm.placeholder((n,), name='A')
+        C = tvm.compute((n,), lambda i: A[i] + 1, name='C')
+        s = tvm.create_schedule(C.op)
+        s[C].vectorize(C.op.axis[0])
+        with tvm.target.build_config(ragged_vector_lanes=lanes):
+            f = tvm.build(s, [A, C], "llvm")
+        ctx = tvm.cpu(0)
+        for m in [1, lanes - 1, lanes, 3 * lanes + 1]:
+            # The element past the end of C should be left untouched
+            # by the disabled lanes.
+            a = tvm.nd.array(np.random.uniform(size=m).astype(A.dtype), ctx)
+            c = tvm.nd.array(np.zeros(m + 1, dtype=C.dtype), ctx)
+            f(a, c.create_view((m,)))
+            c_np = c.asnumpy()
+            tvm.testing.assert_allclose(c_np[:m], a.asnumpy() + 1)
+            assert c_np[m] == 0
+    check_llvm(8)
+    check_llvm(16)
+
+
+def test_llvm_predicated_vectorize_div():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    lanes = 8
+    n = tvm.var('n')
+    A = tvm.placeholder((n,), name='A', dtype="int32")
+    B = tvm.placeholder((n,), name='B', dtype="int32")
+    C = tvm.compute((n,), lambda i: A[i] // B[i] + A[i] % B[i], name='C')
+    s = tvm.create_schedule(C.op)
+    s[C].vectorize(C.op.axis[0])
+    with tvm.target.build_config(ragged_vector_lanes=lanes):
+        f = tvm.build(s, [A, B, C], "llvm")
+    ctx = tvm.cpu(0)
+    # The disabled lanes of the last chunk read zero divisors
+    for m in [1, lanes - 1, 2 * lanes + 3]:
+        a_np = np.random.randint(-100, 100, size=m).astype("int32")
+        b_np = np.random.randint(1, 10, size=m).astype("int32")
+        c = tvm.nd.array(np.zeros(m, dtype="int32"), ctx)
+        f(tvm.nd.array(a_np, ctx), tvm.nd.array(b_np, ctx), c)
+        tvm.testing.assert_allclose(c.asnumpy(), a_np // b_np + a_np % b_np)
+
+
 def test_llvm_madd_pipeline():
     def check_llvm(nn, base, stride):
         if not tvm.runtime.enabled("llvm"):
@@ -323,6 +443,51 @@ def test_multiple_func():
     check_llvm()
 
 
+def test_parallel_build():
+    nn = 1024
+    n = tvm.convert(nn)
+    A = tvm.placeholder((n,), name='A')
+    B = tvm.placeholder((n,), name='B')
+    C = tvm.compute(A.shape, lambda *i: A(*i) + B(*i), name='C')
+    D = tvm.compute(A.shape, lambda *i: A(*i) * B(*i), name='D')
+    s = tvm.create_schedule([C.op, D.op])
+    xo, xi = s[C].split(C.op.axis[0], factor=4)
+    s[C].parallel(xo)
+    s[C].vectorize(xi)
+    def check_llvm():
+        if not tvm.runtime.enabled("llvm"):
+            return
+        funcs = [tvm.lower(s, [A, B, C], name="fadd"),
+                 tvm.lower(s, [A, B, D], name="fmul"),
+                 tvm.lower(s, [A, B, C], name="fadd2")]
+        ctx = tvm.cpu(0)
+        a = tvm.nd.array(np.random.uniform(size=nn).astype(A.dtype), ctx)
+        b = tvm.nd.array(np.random.uniform(size=nn).astype(B.dtype), ctx)
+        sources = []
+        outputs = []
+        for num_threads in [0, 1, 4]:
+            with tvm.build_config(parallel_build_threads=num_threads):
+                m = tvm.build(funcs, "llvm")
+            sources.append(m.get_source())
+            results = []
+            for name in ['fadd', 'fmul', 'fadd2']:
+                c = tvm.nd.array(np.zeros(nn, dtype=C.dtype), ctx)
+                m[name](a, b, c)
+                results.append(c.asnumpy())
+            outputs.append(results)
+        expected = [a.asnumpy() + b.asnumpy(), a.asnumpy() * b.asnumpy(),
+                    a.asnumpy() + b.asnumpy()]
+        for results in outputs:
+            for c, c_expected in zip(results, expected):
+                tvm.testing.assert_allclose(c, c_expected)
+        # The module does not depend on the number of threads
+        for results in outputs[1:]:
+            for c, c_serial in zip(results, outputs[0]):
+                np.testing.assert_array_equal(c, c_serial)
+        assert sources[0] == sources[1] == sources[2]
+    check_llvm()
+
+
 
 def test_llvm_condition():
     def check_llvm(n, offset):
@@ -671,11 +836,16 @@ if __name__ == "__main__":
     test_rank_zero_bound_checkers()
     test_llvm_bool()
     test_llvm_persist_parallel()
+    test_llvm_dynamic_parallel()
+    test_llvm_persistent_single_kernel()
     test_llvm_condition()
     test_llvm_vadd_pipeline()
+    test_llvm_predicated_vectorize()
+    test_llvm_predicated_vectorize_div()
     test_llvm_add_pipeline()
     test_llvm_intrin()
     test_multiple_func()
+    test_parallel_build()
     test_llvm_flip_pipeline()
     test_llvm_madd_pipeline()
     test_llvm_temp_space()
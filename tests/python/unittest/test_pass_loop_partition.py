@@ -445,6 +445,69 @@ def test_simple_rfactor():
     #make sure loop partition actually did something
     assert not tvm.ir_pass.Equal(stmt1.body, stmt2.body)
 
+def eval_extent(extent, values):
+    value = tvm.ir_pass.Simplify(tvm.ir_pass.Substitute(extent, values))
+    assert isinstance(value, tvm.tir.IntImm), value
+    return value.value
+
+def ragged_split_loop(ib, n, factor, body):
+    with ib.for_range(0, tvm.tir.floordiv(n + factor - 1, factor), "i") as i:
+        with ib.for_range(0, factor, "j") as j:
+            with ib.if_scope(ib.likely(i * factor + j < n)):
+                body(i * factor + j)
+
+def test_ragged_split_loop():
+    ib = tvm.ir_builder.create()
+    n = tvm.te.size_var("n")
+    A = ib.pointer("float32", name="A")
+    def body(idx):
+        A[idx] = 1.0
+    ragged_split_loop(ib, n, 4, body)
+    stmt = tvm.ir_pass.RaggedLoopPartition(ib.get())
+    stmt = tvm.ir_pass.Simplify(stmt)
+    assert isinstance(stmt, tvm.tir.SeqStmt) and len(stmt) == 2
+    main, tail = stmt[0], stmt[1]
+    assert not any(collect_visit(main, lambda x: isinstance(x, tvm.tir.IfThenElse)))
+    assert any(collect_visit(tail, lambda x: isinstance(x, tvm.tir.IfThenElse)))
+    for nv in [0, 1, 3, 4, 5, 8, 13]:
+        assert eval_extent(main.extent, {n: nv}) == nv // 4
+        assert eval_extent(tail.extent, {n: nv}) == (nv + 3) // 4 - nv // 4
+
+def test_ragged_loop_var_dependent_extent():
+    ib = tvm.ir_builder.create()
+    A = ib.pointer("float32", name="A")
+    L = ib.pointer("int32", name="L")
+    with ib.for_range(0, 8, "i") as i:
+        with ib.for_range(0, 4, "j") as j:
+            # The extent is read at the loop var
+            with ib.if_scope(ib.likely(i * 4 + j < L[i])):
+                A[i * 4 + j] = 1.0
+    stmt = tvm.ir_pass.RaggedLoopPartition(ib.get())
+    assert isinstance(stmt, tvm.tir.For)
+    assert stmt.loop_var.name == "i" and stmt.extent.value == 8
+
+def test_ragged_nested_split_loops():
+    ib = tvm.ir_builder.create()
+    n = tvm.te.size_var("n")
+    m = tvm.te.size_var("m")
+    A = ib.pointer("float32", name="A")
+    def body(row):
+        ragged_split_loop(ib, m, 2, lambda col: A.__setitem__(row * m + col, 1.0))
+    ragged_split_loop(ib, n, 4, body)
+    stmt = tvm.ir_pass.RaggedLoopPartition(ib.get())
+    stmt = tvm.ir_pass.Simplify(stmt)
+    # Both loops are split into a main and a tail loop, which makes
+    # four copies of the store, one of them free of checks.
+    stores = collect_visit(stmt, lambda x: isinstance(x, tvm.tir.Store))
+    assert sum(stores) == 4
+    main = stmt[0]
+    assert isinstance(main.body.body, tvm.tir.SeqStmt)
+    main_main = main.body.body[0]
+    assert not any(collect_visit(main_main, lambda x: isinstance(x, tvm.tir.IfThenElse)))
+    for nv, mv in [(5, 3), (8, 4), (3, 7)]:
+        assert eval_extent(main.extent, {n: nv, m: mv}) == nv // 4
+        assert eval_extent(main_main.extent, {n: nv, m: mv}) == mv // 2
+
 
 if __name__ == "__main__":
     test_basic()
@@ -467,3 +530,6 @@ if __name__ == "__main__":
     test_double_splitting_with_indivisible_factors()
     test_multilevel_splitting_with_indivisble_factors()
     test_simple_rfactor()
+    test_ragged_split_loop()
+    test_ragged_loop_var_dependent_extent()
+    test_ragged_nested_split_loops()
@@ -119,10 +119,36 @@ def test_vectorize_if_then_else():
     assert isinstance(stmt.body.value.args[2], tvm.tir.Broadcast)
 
 
+def test_vectorize_variable_extent():
+    n = tvm.var('n')
+    ib = tvm.ir_builder.create()
+    A = ib.pointer("float32", name="A")
+    with ib.for_range(0, n, for_type="vectorize") as i:
+        A[i] = A[i] + 1
+    stmt = ib.get()
+    with tvm.target.build_config(ragged_vector_lanes=8):
+        stmt = tvm.ir_pass.VectorizeLoop(stmt)
+    assert isinstance(stmt, tvm.tir.SeqStmt)
+    full, tail = stmt[0], stmt[1]
+    # Only the last partial chunk is predicated
+    assert isinstance(full, tvm.tir.For)
+    assert full.for_type == tvm.tir.For.Serial
+    assert isinstance(full.body, tvm.tir.Store)
+    assert full.body.index.dtype == "int32x8"
+    assert isinstance(full.body.predicate, tvm.tir.Broadcast)
+    assert full.body.predicate.value.value == 1
+    assert isinstance(tail, tvm.tir.IfThenElse)
+    assert isinstance(tail.then_case, tvm.tir.Store)
+    assert tail.then_case.index.dtype == "int32x8"
+    assert isinstance(tail.then_case.predicate, tvm.tir.LT)
+    assert isinstance(tail.then_case.value.a.predicate, tvm.tir.LT)
+
+
 if __name__ == "__main__":
     test_vectorize_vector()
     test_vectorize_with_if()
     test_vectorize_loop()
+    test_vectorize_variable_extent()
     test_vectorize_if_then_else()
     test_vectorize_with_le_cond()
     test_vectorize_with_ge_cond()
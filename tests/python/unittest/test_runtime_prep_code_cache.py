@@ -0,0 +1,110 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import numpy as np
+import tvm
+from tvm import te
+from tvm.runtime import module
+from tvm.testing import ragged_elementwise, ragged_buffer_shape, ragged_aux_args
+
+batch_size = 8
+max_len = 16
+hidden = 4
+
+def build_ragged_scale(factor=2):
+    lens, A, O = ragged_elementwise(lambda x: factor * x, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    with tvm.build_config(cache_prep_code=True):
+        return tvm.build(s, [[lens], [A, O]], "llvm")
+
+def check_scale(a, o, lens_np, factor=2):
+    n = int(lens_np.sum()) * hidden
+    np.testing.assert_allclose(o.asnumpy().reshape(-1)[:n], factor * a.asnumpy().reshape(-1)[:n])
+
+def test_prep_code_cache():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    mod, bufs = build_ragged_scale()
+    rng = np.random.RandomState(0)
+    lens_np = rng.randint(1, max_len + 1, size=batch_size).astype("int32")
+    a = tvm.nd.array(rng.uniform(size=(batch_size, max_len, hidden)).astype("float32"))
+    o = tvm.nd.empty((batch_size, max_len, hidden), "float32")
+    lens = tvm.nd.array(lens_np)
+    aux_args = ragged_aux_args(bufs)
+
+    def run_and_count():
+        hits, misses = module.get_prep_code_cache_stats()
+        o.copyfrom(np.zeros((batch_size, max_len, hidden), "float32"))
+        mod(a, o, lens, *aux_args)
+        check_scale(a, o, lens.asnumpy())
+        new_hits, new_misses = module.get_prep_code_cache_stats()
+        return new_hits - hits, new_misses - misses
+
+    module.clear_prep_code_cache()
+    assert run_and_count() == (0, 1)
+    # Same lengths and untouched aux buffers.
+    assert run_and_count() == (1, 0)
+    # New lengths.
+    lens.copyfrom(np.full(batch_size, max_len, "int32"))
+    assert run_and_count() == (0, 1)
+    assert run_and_count() == (1, 0)
+    # A device aux buffer, which the cache is keyed on, overwritten
+    # through the NDArray API.
+    aux = aux_args[len(bufs[0])]
+    aux.copyfrom(np.zeros(aux.shape, aux.dtype))
+    assert run_and_count() == (0, 1)
+    # Aux buffers freed and reallocated, possibly at the same addresses.
+    del aux, aux_args[:]
+    aux_args.extend(ragged_aux_args(bufs))
+    assert run_and_count() == (0, 1)
+    assert run_and_count() == (1, 0)
+
+
+def test_prep_code_cache_shared_between_kernels():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    # Two kernels over the same layout, passed the same aux buffers.
+    mod2, bufs = build_ragged_scale(2)
+    mod3, bufs3 = build_ragged_scale(3)
+    assert ([ragged_buffer_shape(b) for b in list(bufs[0]) + list(bufs[1])] ==
+            [ragged_buffer_shape(b) for b in list(bufs3[0]) + list(bufs3[1])])
+    rng = np.random.RandomState(1)
+    lens_np = rng.randint(1, max_len + 1, size=batch_size).astype("int32")
+    a = tvm.nd.array(rng.uniform(size=(batch_size, max_len, hidden)).astype("float32"))
+    o = tvm.nd.empty((batch_size, max_len, hidden), "float32")
+    lens = tvm.nd.array(lens_np)
+    aux_args = ragged_aux_args(bufs)
+
+    def run_and_count(mod, factor):
+        hits, misses = module.get_prep_code_cache_stats()
+        o.copyfrom(np.zeros((batch_size, max_len, hidden), "float32"))
+        mod(a, o, lens, *aux_args)
+        check_scale(a, o, lens.asnumpy(), factor)
+        new_hits, new_misses = module.get_prep_code_cache_stats()
+        return new_hits - hits, new_misses - misses
+
+    module.clear_prep_code_cache()
+    assert run_and_count(mod2, 2) == (0, 1)
+    # The second kernel reuses the prep code results of the first one.
+    assert run_and_count(mod3, 3) == (1, 0)
+    lens.copyfrom(np.full(batch_size, max_len, "int32"))
+    assert run_and_count(mod3, 3) == (0, 1)
+    assert run_and_count(mod2, 2) == (1, 0)
+
+
+if __name__ == "__main__":
+    test_prep_code_cache()
+    test_prep_code_cache_shared_between_kernels()
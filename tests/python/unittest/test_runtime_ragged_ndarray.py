@@ -0,0 +1,91 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import numpy as np
+import tvm
+import tvm.testing
+from tvm import te
+from tvm.runtime import ragged_ndarray
+
+def check_out_of_bounds(func, *args):
+    try:
+        func(*args)
+        assert False, "expected an out of bounds error"
+    except tvm.TVMError:
+        pass
+
+def test_ragged_ndarray_padded():
+    lens = [3, 0, 5, 1]
+    padded = np.random.uniform(size=(4, 5, 2)).astype("float32")
+    arr = ragged_ndarray.from_padded(padded, lens)
+    assert arr.shape == (4, 5, 2)
+    expected = padded.copy()
+    for i, l in enumerate(lens):
+        expected[i, l:] = 0
+    np.testing.assert_array_equal(arr.asnumpy(), expected)
+    np.testing.assert_array_equal(arr.row(2).asnumpy(), padded[2, :5])
+
+def test_ragged_ndarray_shape():
+    arr = ragged_ndarray.ragged_ndarray_empty((3, 4, 2), [1, 4, 2])
+    assert [tvm.runtime._ffi_api.RaggedNDArrayShape(arr, i) for i in range(3)] == [3, 4, 2]
+    check_out_of_bounds(tvm.runtime._ffi_api.RaggedNDArrayShape, arr, 3)
+    check_out_of_bounds(tvm.runtime._ffi_api.RaggedNDArrayShape, arr, -1)
+
+def test_ragged_ndarray_row_offset():
+    arr = ragged_ndarray.ragged_ndarray_empty((3, 4, 2), [1, 4, 2])
+    assert [arr.row_offset(i) for i in range(4)] == [0, 1, 5, 7]
+    check_out_of_bounds(arr.row_offset, 4)
+    check_out_of_bounds(arr.row_offset, -1)
+    check_out_of_bounds(arr.row, 3)
+
+def test_ragged_ndarray_copies_lengths():
+    lens = tvm.nd.array(np.array([1, 4, 2], "int32"))
+    arr = ragged_ndarray.ragged_ndarray_empty((3, 4, 2), lens)
+    lens.copyfrom(np.array([4, 4, 4], "int32"))
+    np.testing.assert_array_equal(arr.lengths.asnumpy(), [1, 4, 2])
+    assert [arr.row_offset(i) for i in range(4)] == [0, 1, 5, 7]
+
+def test_kernel_args():
+    batch_size, max_len, hidden = 4, 5, 2
+    lens, A, O = tvm.testing.ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    if not tvm.runtime.enabled("llvm"):
+        return
+    mod, bufs = tvm.build(s, [[lens], [A, O]], "llvm")
+
+    lens_np = [3, 1, 5, 2]
+    padded = np.random.uniform(size=(batch_size, max_len, hidden)).astype("float32")
+    a = ragged_ndarray.from_padded(padded, lens_np)
+    o = ragged_ndarray.ragged_ndarray_empty((batch_size, max_len, hidden), lens_np)
+    aux = tvm.testing.ragged_aux_args(bufs)
+    args = ragged_ndarray.kernel_args([a, o], aux)
+    # The two arrays hold equal lengths, passed once.
+    assert len(args) == 3 + len(aux)
+    assert args[0].same_as(a.data) and args[1].same_as(o.data)
+    np.testing.assert_array_equal(args[2].asnumpy(), lens_np)
+    mod(*args)
+    expected = 2 * padded
+    for i, l in enumerate(lens_np):
+        expected[i, l:] = 0
+    tvm.testing.assert_allclose(o.asnumpy(), expected, rtol=1e-5)
+
+
+if __name__ == "__main__":
+    test_ragged_ndarray_padded()
+    test_ragged_ndarray_shape()
+    test_ragged_ndarray_row_offset()
+    test_ragged_ndarray_copies_lengths()
+    test_kernel_args()
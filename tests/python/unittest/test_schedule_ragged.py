@@ -0,0 +1,571 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Test the schedules of ragged operators built for the CPU"""
+import re
+
+import numpy as np
+import tvm
+from tvm import te
+from tvm.testing import ragged_elementwise, ragged_buffer_shape, ragged_aux_args
+from tvm.tir import UninterpFun as Uf
+
+batch_size = 8
+max_len = 16
+hidden = 4
+
+def sample_lengths(seed=0):
+    rng = np.random.RandomState(seed)
+    return rng.randint(1, max_len + 1, size=batch_size).astype("int32")
+
+def run_elementwise(mod, lens_np, aux_args, fnumpy, stored_lens_np=None):
+    a = tvm.nd.array(np.random.uniform(size=(batch_size, max_len, hidden)).astype("float32"))
+    o = tvm.nd.array(np.zeros((batch_size, max_len, hidden), "float32"))
+    mod(a, o, tvm.nd.array(lens_np), *aux_args)
+    # A and O share their ragged layout, whose first sum(lens) * hidden
+    # elements are the valid ones.
+    if stored_lens_np is None:
+        stored_lens_np = lens_np
+    n = int(stored_lens_np.sum()) * hidden
+    tvm.testing.assert_allclose(o.asnumpy().reshape(-1)[:n],
+                                fnumpy(a.asnumpy().reshape(-1)[:n]), rtol=1e-5)
+    return o.asnumpy().reshape(-1), n
+
+def test_shared_prep_code():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    def build_kernels(num_kernels):
+        shared = te.SharedPrepCode()
+        lens = te.placeholder((batch_size,), name="lens", dtype="int32")
+        kernels = []
+        for i, (fte, fnp) in enumerate([(lambda x: x * 2, lambda x: x * 2),
+                                        (lambda x: x + 1, lambda x: x + 1)][:num_kernels]):
+            _, A, O = ragged_elementwise(fte, batch_size, max_len, hidden, lens,
+                                         name="O%d" % i)
+            s = te.create_schedule([O.op])
+            s.share_prep_code(shared)
+            mod, bufs = tvm.build(s, [[lens], [A, O]], "llvm", name="kernel%d" % i)
+            kernels.append((mod, bufs, fnp, O))
+        prelude, prelude_bufs = tvm.build(shared, [[lens], []], "llvm", name="prelude")
+        return kernels, prelude, prelude_bufs
+
+    # Both kernels have the same lengths, so their aux buffers are only
+    # computed once: the prelude of the two kernels is the one of a
+    # single kernel. This holds although the kernels are created
+    # separately, with their own dimensions and l_funs.
+    _, _, single_bufs = build_kernels(1)
+    kernels, prelude, prelude_bufs = build_kernels(2)
+    dims = [k[3].op.loop_layout_object.dimensions for k in kernels]
+    assert not any(d0.same_as(d1) for d0, d1 in zip(*dims))
+    assert ([ragged_buffer_shape(b) for b in prelude_bufs[0]] ==
+            [ragged_buffer_shape(b) for b in single_bufs[0]])
+
+    lens_np = sample_lengths()
+    prelude_args = ragged_aux_args(prelude_bufs)
+    prelude(tvm.nd.array(lens_np), *prelude_args)
+    known = list(zip(list(prelude_bufs[0]) + list(prelude_bufs[1]), prelude_args))
+    for mod, bufs, fnumpy, _ in kernels:
+        run_elementwise(mod, lens_np, ragged_aux_args(bufs, known), fnumpy)
+
+def parallel_loops(stmt):
+    loops = []
+    def visit(x):
+        if isinstance(x, tvm.tir.For) and x.for_type == tvm.tir.For.Parallel:
+            loops.append(x)
+    tvm.tir.ir_pass.PostOrderVisit(stmt, visit)
+    return loops
+
+def test_balanced_parallel_with_prefetch():
+    lens, A, O = ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    b = O.op.axis[0]
+    s[O].balanced_parallel(b)
+    s[O].prefetch(A, b, 1)
+    # The cost is the first attribute in the body of the loop, ahead of
+    # the prefetch.
+    stmt = tvm.lower(s, [[lens], [A, O]], "llvm", simple_mode=True)
+    loops = parallel_loops(stmt)
+    assert len(loops) == 1
+    assert isinstance(loops[0].body, tvm.tir.AttrStmt)
+    assert loops[0].body.attr_key == "parallel_balanced_cost"
+
+    if not tvm.runtime.enabled("llvm"):
+        return
+    mod, bufs = tvm.build(s, [[lens], [A, O]], "llvm")
+    # The tasks search their bounds in the cumulative cost.
+    assert "cost_search" in mod.get_source("ll")
+    run_elementwise(mod, sample_lengths(), ragged_aux_args(bufs), lambda x: x * 2)
+
+def test_padded_storage():
+    bucket_size = 4
+    lens, A, O = ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden,
+                                    bucket_size=bucket_size)
+    s = te.create_schedule([O.op])
+    _, l, _ = O.op.axis
+    _, li = s[O].split(l, factor=bucket_size)
+    # The padded lengths are multiples of the split factor, so the
+    # inner loop needs no tail predicate.
+    stmt = tvm.lower(s, [[lens], [A, O]], "llvm", simple_mode=True)
+    cond_vars = set()
+    def visit(x):
+        if isinstance(x, tvm.tir.IfThenElse):
+            tvm.tir.ir_pass.PostOrderVisit(
+                x.condition,
+                lambda v: cond_vars.add(v.name) if isinstance(v, tvm.tir.Var) else None)
+    tvm.tir.ir_pass.PostOrderVisit(stmt, visit)
+    assert li.var.name not in cond_vars, stmt
+    s[O].unroll(li)
+
+    if not tvm.runtime.enabled("llvm"):
+        return
+    mod, bufs = tvm.build(s, [[lens], [A, O]], "llvm")
+    lens_np = sample_lengths()
+    padded_np = (lens_np + bucket_size - 1) // bucket_size * bucket_size
+    # Every row is stored and computed up to its padded length, and
+    # nothing is written past the padded rows.
+    o, n = run_elementwise(mod, lens_np, ragged_aux_args(bufs), lambda x: x * 2, padded_np)
+    assert n > int(lens_np.sum()) * hidden
+    assert not o[n:].any()
+
+def test_storage_align_ragged_rows():
+    factor = 32
+    lens, A, O = ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    s[O].storage_align_dim(1, factor, 0)
+    args = [[lens], [A, O]]
+
+    # The prefix sums over the batch, of the packed rows of A and of
+    # the aligned rows of O, as (aggregate name, dtype, offset) in the
+    # aux buffers.
+    afuns = []
+    def visit(x):
+        if isinstance(x, tvm.tir.For) and re.match(r"bd_af[0-9]+_i$", x.loop_var.name):
+            def visit_store(y):
+                if isinstance(y, tvm.tir.Store) and not y.buffer_var.name.endswith("ctr"):
+                    zero = {x.loop_var: tvm.tir.const(0, x.loop_var.dtype)}
+                    offset = tvm.tir.ir_pass.Simplify(tvm.tir.ir_pass.Substitute(y.index, zero))
+                    afuns.append((y.buffer_var.name, y.value.dtype, int(offset)))
+            tvm.tir.ir_pass.PostOrderVisit(x.body, visit_store)
+    tvm.tir.ir_pass.PostOrderVisit(tvm.lower(s, args, "llvm", simple_mode=True), visit)
+    assert len(afuns) == 2, afuns
+
+    if not tvm.runtime.enabled("llvm"):
+        return
+    mod, bufs = tvm.build(s, args, "llvm")
+    lens_np = sample_lengths()
+    a = tvm.nd.array(np.random.uniform(size=(batch_size, max_len, hidden)).astype("float32"))
+    o = tvm.nd.array(np.zeros((batch_size, max_len, hidden), "float32"))
+    aux_args = ragged_aux_args(bufs)
+    mod(a, o, tvm.nd.array(lens_np), *aux_args)
+    a_np = a.asnumpy().reshape(-1)
+    o_np = o.asnumpy().reshape(-1)
+
+    # Read the prefix sums back from the aux buffers the kernel filled
+    aux_by_name = {b.data.name: arr for b, arr in zip(bufs[0], aux_args)}
+    offsets = [aux_by_name[name].asnumpy().view(dtype)[offset:offset + batch_size + 1]
+               .astype("int64") * hidden for name, dtype, offset in afuns]
+    a_offsets = np.concatenate([[0], np.cumsum(lens_np * hidden)])
+    packed = [off for off in offsets if np.array_equal(off, a_offsets)]
+    aligned = [off for off in offsets if not np.array_equal(off, a_offsets)]
+    assert len(packed) == 1 and len(aligned) == 1, offsets
+    # The rows of O start at a multiple of factor elements, while A
+    # stays packed.
+    o_offsets = aligned[0]
+    assert not (o_offsets % factor).any(), o_offsets
+    for b in range(batch_size):
+        row = lens_np[b] * hidden
+        assert o_offsets[b + 1] - o_offsets[b] >= row
+        tvm.testing.assert_allclose(o_np[o_offsets[b]:o_offsets[b] + row],
+                                    a_np[a_offsets[b]:a_offsets[b] + row] * 2, rtol=1e-5)
+        assert not o_np[o_offsets[b] + row:o_offsets[b + 1]].any()
+    assert not o_np[o_offsets[-1]:].any()
+
+def test_index_dtype():
+    def layout(num_rows, row_max, row_bound=None):
+        bd = te.RangeDimension("bd")
+        s1 = te.RangeDimension("s1")
+        lens = te.placeholder((num_rows,), name="lens", dtype="int32")
+        ufs = [Uf.from_constant("bd", num_rows, "l"),
+               Uf("s1", "l", (1, row_bound or row_max), [bd], lambda b: lens[b])]
+        return tvm.tir.Modes.storage_layout([bd, s1], [num_rows, row_max], ufs, {})
+
+    assert layout(1024, 1024).index_dtype() == "int32"
+    # More than 2^31 elements
+    assert layout(65536, 65536).index_dtype() == "int64"
+    # A symbolic row bound is taken to fit its type
+    assert layout(65536, te.size_var("m"), te.size_var("m_max")).index_dtype() == "int32"
+    assert layout(65536, te.size_var("m", "int64"),
+                  te.size_var("m_max", "int64")).index_dtype() == "int64"
+    # A symbolic row bound below the constant range of the rows
+    assert layout(1024, te.size_var("m"), 1024).index_dtype() == "int32"
+
+def test_index_dtype_lowered():
+    # A layout of up to 2^32 elements
+    lens, A, O = ragged_elementwise(lambda x: x + 1, 65536, 65536, 1)
+    s = te.create_schedule([O.op])
+    stmt = tvm.lower(s, [[lens], [A, O]], "llvm", simple_mode=True)
+    loads, stores = [], []
+    def visit(x):
+        if isinstance(x, tvm.tir.Load):
+            loads.append(x)
+        elif isinstance(x, tvm.tir.Store):
+            stores.append(x)
+    tvm.tir.ir_pass.PostOrderVisit(stmt, visit)
+
+    data_indices = ([l.index for l in loads if l.buffer_var.name == "A"] +
+                    [st.index for st in stores if st.buffer_var.name == "O"])
+    assert data_indices
+    assert all(i.dtype == "int64" for i in data_indices), data_indices
+    # The row offsets are prefix sums computed into and read from
+    # int64 a_fun buffers.
+    aux_stores = [st for st in stores if st.buffer_var.name not in ["A", "O"]]
+    aux_loads = [l for l in loads if l.buffer_var.name not in ["A", "O", "lens"]]
+    assert aux_stores and all(st.value.dtype == "int64" for st in aux_stores), aux_stores
+    assert aux_loads and all(l.dtype == "int64" for l in aux_loads), aux_loads
+
+def test_bin_pack_split_points():
+    bd = te.RangeDimension("bd")
+    l_fun = Uf("s1", "l", (1, 40), [bd], lambda b: b + 1)
+    points = te.bin_pack_split_points(l_fun, [16, 4])
+    assert len(points) == 2
+    for point, factor in zip(points, [16, 4]):
+        for b in range(40):
+            value = tvm.tir.ir_pass.Simplify(
+                tvm.tir.ir_pass.Substitute(point.body, {point.paramters[0]: b}))
+            assert value.value == (b + 1) // factor * factor
+
+def test_bin_pack_split_extents():
+    lens, A, O = ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    l_fun = O.op.loop_layout_object.l_funs[1]
+    points = te.bin_pack_split_points(l_fun, [8, 4])
+    tiers = s.split_for_bin_packing([A], O, {O.op.axis[1]: points}, include_inputs=False)
+    assert len(tiers) == 3
+    outputs = [ops[-1] for ops in tiers]
+
+    names = [iv.var.name for o in outputs for iv in o.op.axis]
+    assert len(set(names)) == len(names), names
+    assert outputs[0].op.axis[1].var.name == "iv1_1"
+    # Tier t starts at the split point t - 1 and ends at the split
+    # point t, if any.
+    for t, o in enumerate(outputs):
+        dom = o.op.axis[1].dom
+        if t > 0:
+            assert dom.min.func.same_as(points[t - 1])
+        if t < len(points):
+            end = tvm.tir.ir_pass.Simplify(dom.min + dom.extent)
+            assert end.func.same_as(points[t])
+
+    # The extents of all the tiers but the last are multiples of their
+    # tile factor, so their inner loops have no tail condition.
+    inner_names = []
+    for o, factor in zip(outputs, [8, 4]):
+        _, inner = s[o].split(o.op.axis[1], factor=factor)
+        inner_names.append(inner.var.name)
+    stmt = tvm.lower(s, [[lens], [A] + outputs], "llvm", simple_mode=True)
+    cond_vars = set()
+    def visit(x):
+        if isinstance(x, tvm.tir.IfThenElse):
+            tvm.tir.ir_pass.PostOrderVisit(
+                x.condition,
+                lambda v: cond_vars.add(v.name) if isinstance(v, tvm.tir.Var) else None)
+    tvm.tir.ir_pass.PostOrderVisit(stmt, visit)
+    for name in inner_names:
+        assert name not in cond_vars, (name, stmt)
+
+    if not tvm.runtime.enabled("llvm"):
+        return
+    mod, bufs = tvm.build(s, [[lens], [A] + outputs], "llvm")
+    lens_np = sample_lengths()
+    a = tvm.nd.array(np.random.uniform(size=(batch_size, max_len, hidden)).astype("float32"))
+    os = [tvm.nd.array(np.zeros((batch_size, max_len, hidden), "float32")) for _ in outputs]
+    mod(a, *os, tvm.nd.array(lens_np), *ragged_aux_args(bufs))
+    # The tiers cover each row exactly once between them.
+    n = int(lens_np.sum()) * hidden
+    total = sum(o.asnumpy().reshape(-1) for o in os)
+    tvm.testing.assert_allclose(total[:n], 2 * a.asnumpy().reshape(-1)[:n], rtol=1e-5)
+
+def test_sort_by_length():
+    lens, A, O = ragged_elementwise(lambda x: x + 1, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    b = O.op.axis[0]
+    s[O].sort_by_length(b)
+    stmt = tvm.lower(s, [[lens], [A, O]], "llvm", simple_mode=True)
+    loop_vars = []
+    tvm.tir.ir_pass.PostOrderVisit(
+        stmt, lambda x: loop_vars.append(x.loop_var.name) if isinstance(x, tvm.tir.For) else None)
+    assert b.var.name + ".sorted" in loop_vars, loop_vars
+
+    # Only leaves can be sorted
+    s = te.create_schedule([O.op])
+    s[O].split(O.op.axis[0], factor=2)
+    try:
+        s[O].sort_by_length(O.op.axis[0])
+        assert False, "expected an error on a split iter var"
+    except tvm.TVMError:
+        pass
+
+    # The cumulative cost of balanced_parallel is not monotonic over
+    # the sorted positions
+    s = te.create_schedule([O.op])
+    s[O].balanced_parallel(O.op.axis[0])
+    s[O].sort_by_length(O.op.axis[0])
+    try:
+        tvm.lower(s, [[lens], [A, O]], "llvm", simple_mode=True)
+        assert False, "expected an error on a balanced sorted loop"
+    except tvm.TVMError:
+        pass
+
+    if not tvm.runtime.enabled("llvm"):
+        return
+    s = te.create_schedule([O.op])
+    s[O].sort_by_length(O.op.axis[0])
+    mod, bufs = tvm.build(s, [[lens], [A, O]], "llvm")
+    # The rows are visited in another order but stored in the same one
+    lens_np = sample_lengths()
+    aux_args = ragged_aux_args(bufs)
+    run_elementwise(mod, lens_np, aux_args, lambda x: x + 1)
+
+    # The counting sort is stable, so rows of equal lengths keep their
+    # relative order.
+    expected = sorted(range(batch_size), key=lambda r: -lens_np[r])
+    assert all(lens_np[p] >= lens_np[q] for p, q in zip(expected, expected[1:]))
+    def holds_permutation(arr):
+        flat = arr.asnumpy().reshape(-1)
+        return any(list(flat[i:i + batch_size]) == expected
+                   for i in range(len(flat) - batch_size + 1))
+    assert any(holds_permutation(arg) for arg in aux_args), lens_np
+
+def test_hfuse_parallel_loops():
+    lens = te.placeholder((batch_size,), name="lens", dtype="int32")
+    _, A1, O1 = ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden, lens,
+                                   name="O1")
+    _, A2, O2 = ragged_elementwise(lambda x: x + 1, batch_size, max_len, hidden, lens,
+                                   name="O2")
+    s = te.create_schedule([O1.op, O2.op])
+    b1, b2 = O1.op.axis[0], O2.op.axis[0]
+    s[O1].parallel(b1)
+    s[O2].parallel(b2)
+    s.hfuse([(O1.op, b1), (O2.op, b2)])
+    args = [[lens], [A1, O1, A2, O2]]
+
+    if not tvm.runtime.enabled("llvm"):
+        return
+    mod, bufs = tvm.build(s, args, "llvm")
+    # The two operations share a single parallel launch
+    lambdas = [l for l in mod.get_source("ll").split("\n")
+               if l.startswith("define") and "__tvm_parallel_lambda" in l]
+    assert len(lambdas) == 1, lambdas
+    lens_np = sample_lengths()
+    shape = (batch_size, max_len, hidden)
+    a1, a2 = [tvm.nd.array(np.random.uniform(size=shape).astype("float32")) for _ in range(2)]
+    o1, o2 = [tvm.nd.array(np.zeros(shape, "float32")) for _ in range(2)]
+    mod(a1, o1, a2, o2, tvm.nd.array(lens_np), *ragged_aux_args(bufs))
+    n = int(lens_np.sum()) * hidden
+    tvm.testing.assert_allclose(o1.asnumpy().reshape(-1)[:n], 2 * a1.asnumpy().reshape(-1)[:n],
+                                rtol=1e-5)
+    tvm.testing.assert_allclose(o2.asnumpy().reshape(-1)[:n], a2.asnumpy().reshape(-1)[:n] + 1,
+                                rtol=1e-5)
+
+def test_hfuse_balanced_parallel_loops():
+    lens = te.placeholder((batch_size,), name="lens", dtype="int32")
+    _, A1, O1 = ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden, lens,
+                                   name="O1")
+    _, A2, O2 = ragged_elementwise(lambda x: x + 1, batch_size, max_len, hidden, lens,
+                                   name="O2")
+    s = te.create_schedule([O1.op, O2.op])
+    b1, b2 = O1.op.axis[0], O2.op.axis[0]
+    s[O1].balanced_parallel(b1)
+    s[O2].balanced_parallel(b2)
+    s.hfuse([(O1.op, b1), (O2.op, b2)])
+    args = [[lens], [A1, O1, A2, O2]]
+
+    funcs = tvm.lower(s, args, "llvm").function
+    func = funcs if isinstance(funcs, tvm.tir.LoweredFunc) else funcs[0]
+    func = tvm.tir.ir_pass.HorizontalFuse(tvm.tir.ir_pass.RemoveProducerConsumerNodes(func))
+    loops = parallel_loops(func.body)
+    assert len(loops) == 1, func.body
+    costs = []
+    tvm.tir.ir_pass.PostOrderVisit(
+        func.body, lambda x: costs.append(x) if isinstance(x, tvm.tir.AttrStmt) and
+        x.attr_key == "parallel_balanced_cost" else None)
+    # The cost of the fused loop replaces those of its parts. It picks
+    # the offset cost of a part by the position of the fused loop var.
+    assert len(costs) == 1, func.body
+    cost = costs[0]
+    assert cost.node.same_as(loops[0].loop_var)
+    assert isinstance(cost.value, tvm.tir.Select), cost.value
+    cond_vars = []
+    tvm.tir.ir_pass.PostOrderVisit(
+        cost.value.condition, lambda x: cond_vars.append(x) if isinstance(x, tvm.tir.Var) else None)
+    assert any(v.same_as(loops[0].loop_var) for v in cond_vars), cost.value
+
+    if not tvm.runtime.enabled("llvm"):
+        return
+    mod, bufs = tvm.build(s, args, "llvm")
+    assert "cost_search" in mod.get_source("ll")
+    lens_np = sample_lengths()
+    shape = (batch_size, max_len, hidden)
+    a1, a2 = [tvm.nd.array(np.random.uniform(size=shape).astype("float32")) for _ in range(2)]
+    o1, o2 = [tvm.nd.array(np.zeros(shape, "float32")) for _ in range(2)]
+    mod(a1, o1, a2, o2, tvm.nd.array(lens_np), *ragged_aux_args(bufs))
+    n = int(lens_np.sum()) * hidden
+    tvm.testing.assert_allclose(o1.asnumpy().reshape(-1)[:n], 2 * a1.asnumpy().reshape(-1)[:n],
+                                rtol=1e-5)
+    tvm.testing.assert_allclose(o2.asnumpy().reshape(-1)[:n], a2.asnumpy().reshape(-1)[:n] + 1,
+                                rtol=1e-5)
+
+def test_incremental_fused_lookups_tail():
+    lens, A, O = ragged_elementwise(lambda x: x * 3, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    b, l, _ = O.op.axis
+    fused = s[O].fuse(b, l)
+    # None of the fused extents below is a multiple of 5, so the last
+    # tile is partial.
+    s[O].split(fused, factor=5)
+
+    with tvm.target.build_config(incremental_fused_lookups=True):
+        stmt = tvm.lower(s, [[lens], [A, O]], "llvm", simple_mode=True)
+        if not tvm.runtime.enabled("llvm"):
+            return
+        mod, bufs = tvm.build(s, [[lens], [A, O]], "llvm")
+    names = []
+    tvm.tir.ir_pass.PostOrderVisit(
+        stmt, lambda x: names.append(x.buffer_var.name) if isinstance(x, tvm.tir.Allocate)
+        else None)
+    assert len(set(names)) == len(names), names
+    # The lookups of the inner loop of the tiles were strength reduced
+    # to a running (outer, inner, row end) state.
+    state = [n for n in names if re.search(r"_f[0-9]+_[oie]$", n)]
+    assert len(state) >= 3 and len(state) % 3 == 0, names
+
+    # With full rows, the positions past the last one are also past
+    # the end of the fusion buffers.
+    for lens_list in [[3, 1, 16, 5, 2, 9, 4, 6], [1, 2, 3, 4, 5, 6, 7, 8], [max_len] * batch_size]:
+        lens_np = np.array(lens_list, "int32")
+        run_elementwise(mod, lens_np, ragged_aux_args(bufs), lambda x: x * 3)
+
+def test_compact_fusion_buffers():
+    # More rows than uint8 can index
+    num_rows, row_max = 300, 4
+    lens, A, O = ragged_elementwise(lambda x: x + 2, num_rows, row_max, 1)
+    s = te.create_schedule([O.op])
+    b, l, _ = O.op.axis
+    s[O].fuse(b, l)
+    args = [[lens], [A, O]]
+
+    def aux_dtypes(stmt):
+        dtypes = set()
+        def visit(x):
+            if isinstance(x, tvm.tir.Store) and x.buffer_var.name not in ["A", "O"]:
+                dtypes.add(x.value.dtype)
+            elif isinstance(x, tvm.tir.Load) and x.buffer_var.name not in ["A", "O", "lens"]:
+                dtypes.add(x.dtype)
+        tvm.tir.ir_pass.PostOrderVisit(stmt, visit)
+        return dtypes
+
+    assert "uint16" not in aux_dtypes(tvm.lower(s, args, "llvm", simple_mode=True))
+    with tvm.target.build_config(compact_fusion_buffers=True):
+        # Only the fused_to_outer buffer is compacted, to uint16. The
+        # other aux buffers stay int32.
+        dtypes = aux_dtypes(tvm.lower(s, args, "llvm", simple_mode=True))
+        assert "uint16" in dtypes and "uint8" not in dtypes, dtypes
+        if not tvm.runtime.enabled("llvm"):
+            return
+        mod, bufs = tvm.build(s, args, "llvm")
+
+    rng = np.random.RandomState(0)
+    lens_np = rng.randint(1, row_max + 1, size=num_rows).astype("int32")
+    a = tvm.nd.array(rng.uniform(size=(num_rows, row_max, 1)).astype("float32"))
+    o = tvm.nd.array(np.zeros((num_rows, row_max, 1), "float32"))
+    mod(a, o, tvm.nd.array(lens_np), *ragged_aux_args(bufs))
+    n = int(lens_np.sum())
+    tvm.testing.assert_allclose(o.asnumpy().reshape(-1)[:n], a.asnumpy().reshape(-1)[:n] + 2,
+                                rtol=1e-5)
+
+def test_narrow_aux_buffers():
+    lens, A, O = ragged_elementwise(lambda x: x - 1, batch_size, max_len, hidden)
+    s = te.create_schedule([O.op])
+    b, l, _ = O.op.axis
+    s[O].fuse(b, l)
+    args = [[lens], [A, O]]
+    for config in [{"narrow_aux_buffers": True}, {"compact_fusion_buffers": True},
+                   {"narrow_aux_buffers": True, "incremental_fused_lookups": True}]:
+        with tvm.target.build_config(**config):
+            # The batch and the lengths fit in 8 bits
+            stmt = tvm.lower(s, args, "llvm", simple_mode=True)
+            assert "uint8" in str(stmt), config
+            if not tvm.runtime.enabled("llvm"):
+                continue
+            mod, bufs = tvm.build(s, args, "llvm")
+        # The aux values are stored narrowed and read back widened
+        run_elementwise(mod, sample_lengths(), ragged_aux_args(bufs), lambda x: x - 1)
+
+def test_parallel_prep_code():
+    if not tvm.runtime.enabled("llvm"):
+        return
+    def build(num_blocks):
+        lens, A, O = ragged_elementwise(lambda x: x * 2, batch_size, max_len, hidden)
+        s = te.create_schedule([O.op])
+        b, l, _ = O.op.axis
+        # The fusion buffers are filled by MakeParallelFusionLoops and
+        # the a_fun offsets by the blocked scan of MakePrefixSum.
+        s[O].fuse(b, l)
+        if num_blocks > 0:
+            s.parallel_prep_code(num_blocks)
+        return tvm.build(s, [[lens], [A, O]], "llvm")
+
+    def run(mod, bufs, lens_np, a_np):
+        aux_args = ragged_aux_args(bufs)
+        for arg in aux_args:
+            arg.copyfrom(np.zeros(arg.shape, arg.dtype))
+        o = tvm.nd.array(np.zeros((batch_size, max_len, hidden), "float32"))
+        mod(tvm.nd.array(a_np), o, tvm.nd.array(lens_np), *aux_args)
+        return [arg.asnumpy() for arg in aux_args], o.asnumpy()
+
+    serial_mod, serial_bufs = build(0)
+    a_np = np.random.uniform(size=(batch_size, max_len, hidden)).astype("float32")
+    # None of the block counts but the last divides the batch size, and
+    # the last one leaves some blocks empty.
+    for num_blocks in [3, 5, 16]:
+        mod, bufs = build(num_blocks)
+        assert [ragged_buffer_shape(b) for b in list(bufs[0]) + list(bufs[1])] == \
+            [ragged_buffer_shape(b) for b in list(serial_bufs[0]) + list(serial_bufs[1])]
+        for lens_np in [sample_lengths(), np.full(batch_size, max_len, "int32")]:
+            serial_aux, serial_o = run(serial_mod, serial_bufs, lens_np, a_np)
+            aux, o = run(mod, bufs, lens_np, a_np)
+            for expected, actual in zip(serial_aux, aux):
+                np.testing.assert_array_equal(actual, expected)
+            np.testing.assert_array_equal(o, serial_o)
+            n = int(lens_np.sum()) * hidden
+            tvm.testing.assert_allclose(o.reshape(-1)[:n], 2 * a_np.reshape(-1)[:n], rtol=1e-5)
+
+if __name__ == "__main__":
+    test_shared_prep_code()
+    test_balanced_parallel_with_prefetch()
+    test_padded_storage()
+    test_storage_align_ragged_rows()
+    test_index_dtype()
+    test_index_dtype_lowered()
+    test_bin_pack_split_points()
+    test_bin_pack_split_extents()
+    test_sort_by_length()
+    test_hfuse_parallel_loops()
+    test_hfuse_balanced_parallel_loops()
+    test_incremental_fused_lookups_tail()
+    test_compact_fusion_buffers()
+    test_narrow_aux_buffers()
+    test_parallel_prep_code()
@@ -0,0 +1,76 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import tvm
+from tvm import te
+from tvm.tir import UninterpFun as Uf
+
+def check_prefix_sum(weight_fn, ns, py_fn=None):
+    i = te.var("i")
+    n = te.var("n")
+    closed = Uf.closed_form_prefix_sum(i, weight_fn(i), n)
+    assert closed is not None
+    for nv in ns:
+        value = tvm.ir_pass.Simplify(tvm.ir_pass.Substitute(closed, {n: nv}))
+        assert isinstance(value, tvm.tir.IntImm), value
+        expected = sum((py_fn or weight_fn)(iv) for iv in range(nv))
+        assert value.value == expected, (nv, value.value, expected)
+
+def test_closed_form_prefix_sum_affine():
+    check_prefix_sum(lambda i: 3 * i + 2, [0, 1, 2, 7, 100])
+    check_prefix_sum(lambda i: 5, [0, 1, 13])
+
+def test_closed_form_prefix_sum_floordiv():
+    check_prefix_sum(lambda i: tvm.tir.floordiv(i, 4) + 1, [0, 1, 3, 4, 5, 17, 64],
+                     lambda i: i // 4 + 1)
+    check_prefix_sum(lambda i: 2 * i + 3 * tvm.tir.floordiv(i, 8), [0, 7, 8, 9, 31],
+                     lambda i: 2 * i + 3 * (i // 8))
+
+def test_closed_form_prefix_sum_large():
+    # n * (n - 1) overflows int32 although the sum itself fits.
+    n = 50000
+    i = te.var("i")
+    closed = Uf.closed_form_prefix_sum(i, i, tvm.tir.const(n, "int32"))
+    assert closed.dtype == "int32"
+    assert closed.value == n * (n - 1) // 2
+    closed = Uf.closed_form_prefix_sum(i, tvm.tir.floordiv(i, 2), tvm.tir.const(80000, "int32"))
+    assert closed.value == sum(v // 2 for v in range(80000))
+
+def test_closed_form_prefix_sum_none():
+    i = te.var("i")
+    assert Uf.closed_form_prefix_sum(i, i * i, te.var("n")) is None
+    assert Uf.closed_form_prefix_sum(
+        i, tvm.tir.floordiv(i, 2) + tvm.tir.floordiv(i, 3), te.var("n")) is None
+
+def test_padded_lfun():
+    bd = te.RangeDimension("bd")
+    uf = Uf("s1", "l", (1, 13), [bd], lambda b: b + 1)
+    padded = Uf.padded(uf, 4)
+    assert padded.range.min.value == 4
+    # [4, 16], the range [1, 13] rounded up
+    assert padded.range.extent.value == 13
+    for b in range(13):
+        value = tvm.ir_pass.Simplify(
+            tvm.ir_pass.Substitute(padded.body, {padded.paramters[0]: b}))
+        assert value.value == (b + 4) // 4 * 4
+    assert Uf.padded(uf, 1).same_as(uf)
+
+if __name__ == "__main__":
+    test_closed_form_prefix_sum_affine()
+    test_closed_form_prefix_sum_floordiv()
+    test_closed_form_prefix_sum_large()
+    test_closed_form_prefix_sum_none()
+    test_padded_lfun()